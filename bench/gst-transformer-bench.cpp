@@ -0,0 +1,407 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#include <gst/gst.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <nlohmann/json.hpp>
+
+#include <grpc/grpc.h>
+#include <grpc++/channel.h>
+#include <grpc++/server.h>
+#include <grpc++/create_channel.h>
+#include <grpc++/server_builder.h>
+#include <grpc++/security/credentials.h>
+#include <grpc++/security/server_credentials.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+#include "dynamicpipeline.h"
+#include "serviceparams.h"
+#include "server/async/asyncserviceimpl.h"
+#include "client/transformstream.h"
+
+using namespace gst_transformer::service;
+using json = nlohmann::json;
+
+static const size_t CHUNK_SIZE = 4096;
+
+// fixtures by pipeline id prefix, {0} = audio buffers, {1} = video frames, {2} = location
+static const std::vector<std::pair<std::string, std::string>> FIXTURES = {
+    { "ogg_vorbis", "audiotestsrc num-buffers={0} samplesperbuffer=1024 wave=pink-noise ! audio/x-raw,rate=44100,channels=2 ! audioconvert ! vorbisenc ! oggmux ! filesink location={2}" },
+    { "flac", "audiotestsrc num-buffers={0} samplesperbuffer=1024 wave=pink-noise ! audio/x-raw,rate=44100,channels=2 ! audioconvert ! flacenc ! filesink location={2}" },
+    { "audio", "audiotestsrc num-buffers={0} samplesperbuffer=1024 wave=pink-noise ! audio/x-raw,rate=44100,channels=2 ! audioconvert ! vorbisenc ! oggmux ! filesink location={2}" },
+    { "video", "videotestsrc num-buffers={1} ! video/x-raw,width=320,height=240,framerate=25/1 ! theoraenc ! oggmux ! filesink location={2}" },
+};
+
+std::string configurationFile;
+std::string outputFileName;
+std::string fixturesDirectory;
+unsigned int fixtureSeconds = 10;
+std::vector<unsigned int> concurrencies = { 1, 8, 64, 256 };
+std::vector<std::string> paths = { "library", "inproc", "unix" };
+
+std::shared_ptr<spdlog::logger> logger;
+std::atomic<unsigned long> streamCounter(0);
+
+struct StreamResult
+{
+    bool ok;
+    double ttfb;
+    double mediaTime;
+    unsigned long outputBytes;
+    std::string reason;
+};
+
+static std::string generateFixture(const std::string &kind, const std::string &launch)
+{
+    auto location = fmt::format("{0}/gsttransformer-bench-{1}-{2}s.fixture", fixturesDirectory, kind, fixtureSeconds);
+    std::ifstream existing(location, std::ios::binary);
+    if (existing.fail()) {
+        auto desc = fmt::format(launch, fixtureSeconds * 44100 / 1024, fixtureSeconds * 25, location);
+        logger->info("generating fixture {0}: {1}", kind, desc);
+
+        GError *error = NULL;
+        auto pipeline = gst_parse_launch(desc.c_str(), &error);
+        if (!pipeline) {
+            auto message = fmt::format("unable to generate fixture {0}: {1}", kind, error->message);
+            g_error_free(error);
+            throw std::runtime_error(message);
+        }
+        gst_element_set_state(pipeline, GST_STATE_PLAYING);
+        auto bus = gst_element_get_bus(pipeline);
+        auto message = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE, (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        auto failed = GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR;
+        gst_message_unref(message);
+        gst_object_unref(bus);
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+        if (failed)
+            throw std::runtime_error(fmt::format("unable to generate fixture {0}", kind));
+
+        existing.open(location, std::ios::binary);
+    }
+
+    std::stringstream data;
+    data << existing.rdbuf();
+    return data.str();
+}
+
+static StreamResult runLibraryStream(const std::string &specs, const std::string &data)
+{
+    StreamResult result = { false, -1, 0, 0, "" };
+
+    PipelineParameters params;
+    params.setRate(-1);
+    std::unique_ptr<DynamicPipeline> pipeline(DynamicPipeline::createFromSpecs(
+        params,
+        fmt::format("bench-library-{0}", streamCounter++),
+        specs));
+
+    auto start = std::chrono::steady_clock::now();
+    std::mutex outputMutex;
+    auto drain = [&] {
+        std::unique_lock<std::mutex> lock(outputMutex);
+        std::vector<std::string> samples;
+        do {
+            samples = pipeline->getPendingSample(64);
+            for(auto &sample : samples)
+                result.outputBytes += sample.size();
+            if (result.ttfb < 0 && result.outputBytes > 0)
+                result.ttfb = elapsedSince(start);
+        } while (!samples.empty());
+    };
+    pipeline->setSampleAvailableCallback(drain);
+    pipeline->setNeedDataCallback([] {});
+    pipeline->setEnoughDataCallback([] {});
+    pipeline->setEOSCallback([] {});
+    pipeline->start([] (bool force) {});
+
+    for(size_t offset=0; offset<data.size(); offset += CHUNK_SIZE) {
+        auto size = std::min(CHUNK_SIZE, data.size() - offset);
+        if (pipeline->addData(data.data() + offset, size) == -1)
+            break;
+    }
+    pipeline->endData();
+    pipeline->waitUntilCompleted();
+    drain();
+
+    result.mediaTime = pipeline->getProcessedTime();
+    result.reason = TerminationReason_Name((TerminationReason)pipeline->getTerminationReason());
+    result.ok = pipeline->getTerminationReason() == PipelineTerminationReason::END_OF_STREAM;
+
+    return result;
+}
+
+static StreamResult runRpcStream(std::shared_ptr<::grpc::Channel> channel, const std::string &pipelineName, const std::string &data)
+{
+    StreamResult result = { false, -1, 0, 0, "" };
+
+    TransformConfig config;
+    config.set_pipeline_name(pipelineName);
+    config.mutable_pipeline_parameters()->set_rate(-1);
+    size_t offset = 0;
+    auto stream = runTransformStream(channel, fmt::format("bench-rpc-{0}", streamCounter++), config, [&] (TransformRequest &request) {
+        if (offset >= data.size())
+            return false;
+        auto size = std::min(CHUNK_SIZE, data.size() - offset);
+        request.mutable_payload()->add_data(data.data() + offset, size);
+        offset += size;
+        return true;
+    });
+
+    result.ttfb = stream.ttfb;
+    result.outputBytes = stream.outputBytes;
+    result.mediaTime = stream.completed.processed_time();
+    if (stream.status.ok()) {
+        result.reason = TerminationReason_Name(stream.completed.termination_reason());
+        result.ok = stream.completed.termination_reason() == TerminationReason::END_OF_STREAM;
+    }
+    else {
+        result.reason = fmt::format("status {0}", (int)stream.status.error_code());
+    }
+
+    return result;
+}
+
+static double cpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static unsigned long maxRssBytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss * 1024ul;
+}
+
+static json runScenario(
+    const std::string &path,
+    unsigned int streams,
+    const std::string &pipelineName,
+    const std::string &specs,
+    const std::string &data,
+    std::shared_ptr<::grpc::Channel> channel)
+{
+    logger->info("running {0} with {1} streams over {2}", pipelineName, streams, path);
+
+    std::vector<StreamResult> results(streams);
+    std::vector<std::thread> threads;
+    auto cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned int i=0; i<streams; i++) {
+        threads.push_back(std::thread([&, i] {
+            try {
+                if (path == "library")
+                    results[i] = runLibraryStream(specs, data);
+                else
+                    results[i] = runRpcStream(channel, pipelineName, data);
+            }
+            catch(std::exception &e) {
+                results[i] = { false, -1, 0, 0, e.what() };
+            }
+        }));
+    }
+    for(auto &thread : threads)
+        thread.join();
+    auto wall = elapsedSince(start);
+    auto cpu = cpuSeconds() - cpuStart;
+
+    double mediaTime = 0;
+    unsigned long outputBytes = 0;
+    unsigned int failures = 0;
+    std::vector<double> ttfbs;
+    json reasons = json::object();
+    for(auto &result : results) {
+        mediaTime += result.mediaTime;
+        outputBytes += result.outputBytes;
+        if (!result.ok)
+            failures++;
+        if (result.ttfb >= 0)
+            ttfbs.push_back(result.ttfb);
+        reasons[result.reason] = reasons.value(result.reason, 0) + 1;
+    }
+
+    json entry;
+    entry["pipeline"] = pipelineName;
+    entry["path"] = path;
+    entry["streams"] = streams;
+    entry["wallSeconds"] = wall;
+    entry["mediaSecondsPerSecond"] = wall > 0 ? mediaTime / wall : 0;
+    entry["outputBytes"] = outputBytes;
+    entry["ttfbP50Millis"] = percentile(ttfbs, 0.5) * 1000;
+    entry["ttfbP99Millis"] = percentile(ttfbs, 0.99) * 1000;
+    entry["cpuSecondsPerStream"] = cpu / streams;
+    entry["maxRssBytes"] = maxRssBytes();
+    entry["failures"] = failures;
+    entry["terminationReasons"] = reasons;
+    logger->info("{0}", entry.dump());
+
+    return entry;
+}
+
+static std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+        values.push_back(value);
+
+    return values;
+}
+
+static int parse_opt(int argc, char **argv)
+{
+    int key;
+    while ((key = getopt(argc, argv, "c:o:f:d:n:p:")) != -1) {
+        switch (key) {
+            case 'c':
+                configurationFile = optarg;
+                break;
+            case 'o':
+                outputFileName = optarg;
+                break;
+            case 'f':
+                fixturesDirectory = optarg;
+                break;
+            case 'd':
+                fixtureSeconds = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                concurrencies.clear();
+                for(auto &value : splitList(optarg))
+                    concurrencies.push_back(strtoul(value.c_str(), NULL, 10));
+                break;
+            case 'p':
+                paths = splitList(optarg);
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    if (configurationFile.empty() || fixtureSeconds == 0)
+        return -1;
+    for(auto &path : paths) {
+        if (path != "library" && path != "inproc" && path != "unix") {
+            std::cerr << "Invalid path " << path << std::endl;
+            return -1;
+        }
+    }
+    if (fixturesDirectory.empty())
+        fixturesDirectory = g_get_tmp_dir();
+
+    return 0;
+}
+
+static void usage()
+{
+    std::cerr << "Usage: gsttransformer_bench [OPTION...]" << std::endl;
+    std::cerr << "  -c FILE\tjson configuration file with pipelines to run, required." << std::endl;
+    std::cerr << "  -d SECONDS\tFixture media duration. Default 10." << std::endl;
+    std::cerr << "  -f DIR\tFixtures directory. Default system temp directory." << std::endl;
+    std::cerr << "  -n LIST\tConcurrent streams. Default 1,8,64,256." << std::endl;
+    std::cerr << "  -o FILE\tJSON results file. Default stdout." << std::endl;
+    std::cerr << "  -p LIST\tPaths {library,inproc,unix}. Default all." << std::endl;
+
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    gst_init(&argc, &argv);
+
+    if (parse_opt(argc, argv))
+        usage();
+
+    logger = spdlog::stderr_logger_mt("bench");
+    spdlog::set_level(spdlog::level::warn);
+    logger->set_level(spdlog::level::info);
+
+    ServiceParams params;
+    params.loadFromJsonFile(configurationFile);
+    // benchmark runs unthrottled
+    params.set_allow_dynamic_pipelines(true);
+    params.set_max_rate(0);
+
+    auto socketPath = fmt::format("{0}/gsttransformer-bench-{1}.sock", g_get_tmp_dir(), getpid());
+    GstTransformer::AsyncService service;
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort(fmt::format("unix:{0}", socketPath), grpc::InsecureServerCredentials());
+    builder.RegisterService(&service);
+    auto completionQueue = builder.AddCompletionQueue();
+    auto server = builder.BuildAndStart();
+    AsyncServiceImpl asyncService(&service, nullptr, completionQueue.get(), nullptr, params);
+    std::thread serviceThread([&] {
+        asyncService.start();
+    });
+
+    auto inprocChannel = server->InProcessChannel(::grpc::ChannelArguments());
+    auto unixChannel = ::grpc::CreateChannel(fmt::format("unix:{0}", socketPath), grpc::InsecureChannelCredentials());
+
+    json report;
+    report["fixtureSeconds"] = fixtureSeconds;
+    report["hardwareConcurrency"] = std::thread::hardware_concurrency();
+    report["results"] = json::array();
+
+    for(auto &entry : params.pipelines()) {
+        auto &pipeline = entry.second;
+        auto kind = pipeline.id().substr(0, pipeline.id().find('/'));
+        auto fixture = std::find_if(FIXTURES.begin(), FIXTURES.end(), [&] (const std::pair<std::string, std::string> &f) {
+            return f.first == kind;
+        });
+        if (fixture == FIXTURES.end()) {
+            logger->warn("no fixture for pipeline {0}, skipping", pipeline.id());
+            continue;
+        }
+
+        auto data = generateFixture(fixture->first, fixture->second);
+        for(auto &path : paths) {
+            auto channel = path == "inproc" ? inprocChannel : unixChannel;
+            for(auto streams : concurrencies)
+                report["results"].push_back(runScenario(path, streams, pipeline.id(), pipeline.specs(), data, channel));
+        }
+    }
+
+    server->Shutdown();
+    asyncService.stop();
+    serviceThread.join();
+    unlink(socketPath.c_str());
+
+    if (outputFileName.empty()) {
+        std::cout << report.dump(4) << std::endl;
+    }
+    else {
+        std::ofstream of(outputFileName);
+        of << report.dump(4) << std::endl;
+    }
+}
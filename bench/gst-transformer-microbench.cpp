@@ -0,0 +1,231 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#include <gst/gst.h>
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dynamicpipeline.h"
+#include "server/grunloop.h"
+#include "gsttransformer.pb.h"
+
+using namespace gst_transformer::service;
+
+// same bounds as AsyncTransformImpl::pullSample
+static const unsigned int MAX_RESPONSE_BYTES = 1024 * 1024;
+static const int MAX_PULL_SAMPLES = 64;
+
+static std::atomic<unsigned long> pipelineCounter(0);
+
+/**
+ * Passthrough pipeline with sample notifications counted.
+ */
+class PassthroughFixture
+{
+public:
+    PassthroughFixture(bool drainOnSample)
+    {
+        PipelineParameters params;
+        params.setRate(-1);
+        this->pipeline.reset(DynamicPipeline::createFromSpecs(
+            params,
+            fmt::format("microbench-{0}", pipelineCounter++),
+            "identity"));
+
+        this->available = 0;
+        this->pipeline->setSampleAvailableCallback([this, drainOnSample] {
+            if (drainOnSample) {
+                this->pipeline->getPendingSample(MAX_PULL_SAMPLES);
+                return;
+            }
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->available++;
+            this->cond.notify_all();
+        });
+        this->pipeline->setNeedDataCallback([] {});
+        this->pipeline->setEnoughDataCallback([] {});
+        this->pipeline->setEOSCallback([] {});
+        this->pipeline->start([] (bool force) {});
+    }
+
+    ~PassthroughFixture()
+    {
+        this->pipeline->endData();
+        this->pipeline->waitUntilCompleted();
+    }
+
+    void waitForSamples(int count)
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (this->available < count)
+            this->cond.wait(lock);
+        this->available -= count;
+    }
+
+    std::unique_ptr<DynamicPipeline> pipeline;
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    int available;
+};
+
+static void BM_AddData(benchmark::State &state)
+{
+    PassthroughFixture fixture(true);
+    std::string data(state.range(0), 'x');
+
+    for (auto _ : state)
+        fixture.pipeline->addData(data.data(), data.size());
+
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_AddData)->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+
+static void BM_GetPendingSample(benchmark::State &state)
+{
+    PassthroughFixture fixture(false);
+    std::string data(state.range(0), 'x');
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        for(int i=0; i<MAX_PULL_SAMPLES; i++)
+            fixture.pipeline->addData(data.data(), data.size());
+        fixture.waitForSamples(MAX_PULL_SAMPLES);
+        state.ResumeTiming();
+
+        int pulled = 0;
+        while (pulled < MAX_PULL_SAMPLES)
+            pulled += fixture.pipeline->getPendingSample(MAX_PULL_SAMPLES).size();
+    }
+
+    state.SetItemsProcessed(state.iterations() * MAX_PULL_SAMPLES);
+    state.SetBytesProcessed(state.iterations() * MAX_PULL_SAMPLES * data.size());
+}
+BENCHMARK(BM_GetPendingSample)->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+
+static void BM_RunLoopExecuteOffLoop(benchmark::State &state)
+{
+    auto runloop = GRunLoop::main();
+    std::atomic<long> executed(0);
+    long submitted = 0;
+
+    for (auto _ : state) {
+        runloop->execute([&] { executed++; });
+        submitted++;
+    }
+    while (executed < submitted)
+        std::this_thread::yield();
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RunLoopExecuteOffLoop)->Threads(1)->Threads(4);
+
+static void BM_RunLoopExecuteOnLoop(benchmark::State &state)
+{
+    static const int BATCH = 1000;
+    auto runloop = GRunLoop::main();
+
+    for (auto _ : state) {
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool done = false;
+        std::chrono::duration<double> elapsed;
+
+        runloop->execute([&] {
+            auto start = std::chrono::steady_clock::now();
+            long executed = 0;
+            for(int i=0; i<BATCH; i++)
+                runloop->execute([&] { executed++; });
+            elapsed = std::chrono::steady_clock::now() - start;
+            benchmark::DoNotOptimize(executed);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done = true;
+            cond.notify_all();
+        });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done)
+            cond.wait(lock);
+        state.SetIterationTime(elapsed.count());
+    }
+
+    state.SetItemsProcessed(state.iterations() * BATCH);
+}
+BENCHMARK(BM_RunLoopExecuteOnLoop)->UseManualTime();
+
+static void BM_ResponseBuilding(benchmark::State &state)
+{
+    std::string sample(state.range(0), 'x');
+    unsigned long bytes = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<std::string> samples(MAX_PULL_SAMPLES, sample);
+        state.ResumeTiming();
+
+        TransformResponse response;
+        unsigned int buffered = 0;
+        for(auto &data : samples) {
+            if (buffered > MAX_RESPONSE_BYTES)
+                break;
+            buffered += data.length();
+            response.mutable_payload()->add_data(std::move(data));
+        }
+        benchmark::DoNotOptimize(response);
+        bytes += buffered;
+    }
+
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ResponseBuilding)->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+
+static void BM_ResponseSerialization(benchmark::State &state)
+{
+    TransformResponse response;
+    response.mutable_payload()->add_data(std::string(state.range(0), 'x'));
+    std::string serialized;
+
+    for (auto _ : state) {
+        response.SerializeToString(&serialized);
+        benchmark::DoNotOptimize(serialized);
+    }
+
+    state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK(BM_ResponseSerialization)->RangeMultiplier(4)->Range(1 << 10, 1 << 20);
+
+int main(int argc, char **argv)
+{
+    gst_init(&argc, &argv);
+    spdlog::set_level(spdlog::level::warn);
+
+    ::benchmark::Initialize(&argc, argv);
+    if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    ::benchmark::RunSpecifiedBenchmarks();
+}
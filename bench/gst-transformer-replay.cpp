@@ -0,0 +1,343 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#include <getopt.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <nlohmann/json.hpp>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
+#include <grpc/grpc.h>
+#include <grpc++/channel.h>
+#include <grpc++/create_channel.h>
+#include <grpc++/security/credentials.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "trafficcapture.h"
+#include "gsttransformer.grpc.pb.h"
+#include "client/transformstream.h"
+
+using namespace gst_transformer::service;
+using json = nlohmann::json;
+
+std::string captureFileName;
+std::string inputFileName;
+std::string outputFileName;
+std::string onlyRequestId;
+double timeScale = 1.0;
+std::string endpoint;
+
+std::shared_ptr<spdlog::logger> logger;
+std::atomic<unsigned long> streamCounter(0);
+
+struct CapturedRequest
+{
+    std::string requestId;
+    unsigned long startMicros;
+    TransformConfig config;
+    std::vector<std::pair<unsigned long, CapturePayload>> payloads;
+    bool hasCompleted;
+    unsigned long completedMicros;
+    CaptureCompleted completed;
+    bool sizesOnly;
+};
+
+struct ReplayResult
+{
+    std::string requestId;
+    bool outputCompared;
+    bool outputMatched;
+    bool reasonMatched;
+    std::string reason;
+    // replayed duration over captured duration, scaled
+    double durationRatio;
+};
+
+static std::vector<CapturedRequest> loadCapture(const std::string &fileName)
+{
+    std::ifstream ifs(fileName, std::ios::binary);
+    if (ifs.fail())
+        throw std::invalid_argument(fmt::format("unable to open capture file {0}", fileName));
+
+    google::protobuf::io::IstreamInputStream input(&ifs);
+    std::map<std::string, CapturedRequest> requests;
+    CaptureRecord record;
+    bool cleanEof = false;
+    while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(&record, &input, &cleanEof)) {
+        if (!onlyRequestId.empty() && record.request_id() != onlyRequestId)
+            continue;
+
+        auto &request = requests[record.request_id()];
+        switch (record.record_case()) {
+            case CaptureRecord::kStarted:
+                request.requestId = record.request_id();
+                request.startMicros = record.started().start_micros();
+                request.config = record.started().config();
+                request.hasCompleted = false;
+                request.sizesOnly = false;
+                break;
+            case CaptureRecord::kPayload:
+                request.payloads.push_back(std::make_pair(record.offset_micros(), record.payload()));
+                if (record.payload().size() != record.payload().data().size())
+                    request.sizesOnly = true;
+                break;
+            case CaptureRecord::kCompleted:
+                request.hasCompleted = true;
+                request.completedMicros = record.offset_micros();
+                request.completed = record.completed();
+                break;
+            default:
+                break;
+        }
+    }
+    if (!cleanEof)
+        logger->warn("capture file {0} is truncated", fileName);
+
+    std::vector<CapturedRequest> captured;
+    for(auto &entry : requests) {
+        // requests that were not captured in full cannot be replayed faithfully
+        if (entry.second.requestId.empty() || !entry.second.hasCompleted) {
+            logger->debug("skipping incomplete request {0}", entry.first);
+            continue;
+        }
+        captured.push_back(std::move(entry.second));
+    }
+    std::sort(captured.begin(), captured.end(), [] (const CapturedRequest &a, const CapturedRequest &b) {
+        return a.startMicros < b.startMicros;
+    });
+
+    return captured;
+}
+
+static std::chrono::steady_clock::duration scaled(unsigned long micros)
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::micro>(micros * timeScale));
+}
+
+static ReplayResult replay(std::shared_ptr<::grpc::Channel> channel, const CapturedRequest &captured, const std::string &substitute)
+{
+    ReplayResult result = { captured.requestId, false, false, false, "", 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    auto outputHash = TrafficCapture::FNV_OFFSET_BASIS;
+    auto payload = captured.payloads.begin();
+    size_t substituteOffset = 0;
+    auto stream = runTransformStream(
+        channel,
+        fmt::format("replay-{0}-{1}", streamCounter++, captured.requestId),
+        captured.config,
+        [&] (TransformRequest &request) {
+            if (payload == captured.payloads.end())
+                return false;
+            if (timeScale > 0)
+                std::this_thread::sleep_until(start + scaled(payload->first));
+
+            if (captured.sizesOnly) {
+                // same chunking and timing, bytes taken from the substitute input
+                std::string data;
+                while (data.size() < payload->second.size()) {
+                    auto size = std::min<size_t>(payload->second.size() - data.size(), substitute.size() - substituteOffset);
+                    data.append(substitute, substituteOffset, size);
+                    substituteOffset = (substituteOffset + size) % substitute.size();
+                }
+                request.mutable_payload()->add_data(data);
+            }
+            else {
+                request.mutable_payload()->add_data(payload->second.data());
+            }
+            payload++;
+            return true;
+        },
+        [&] (const std::string &data) {
+            outputHash = TrafficCapture::hash(outputHash, data);
+        });
+
+    auto &completed = stream.completed;
+    auto capturedDuration = std::chrono::duration<double>(scaled(captured.completedMicros)).count();
+    result.durationRatio = capturedDuration > 0 ? stream.duration / capturedDuration : 0;
+    if (stream.status.ok()) {
+        result.reason = TerminationReason_Name(completed.termination_reason());
+        result.reasonMatched = completed.termination_reason() == captured.completed.termination_reason();
+    }
+    else {
+        result.reason = fmt::format("status {0}", (int)stream.status.error_code());
+    }
+    // output is only comparable when the original input bytes were replayed
+    result.outputCompared = !captured.sizesOnly && stream.status.ok();
+    result.outputMatched = result.outputCompared &&
+        stream.outputBytes == captured.completed.output_bytes() &&
+        outputHash == captured.completed.output_hash();
+
+    if (!result.reasonMatched || (result.outputCompared && !result.outputMatched)) {
+        logger->warn("request {0}: captured {1} with {2} output bytes, replayed {3} with {4} output bytes",
+            captured.requestId,
+            TerminationReason_Name(captured.completed.termination_reason()),
+            captured.completed.output_bytes(),
+            result.reason,
+            stream.outputBytes);
+    }
+
+    return result;
+}
+
+static int parse_opt(int argc, char **argv)
+{
+    int key;
+    while ((key = getopt(argc, argv, "f:i:o:r:t:")) != -1) {
+        switch (key) {
+            case 'f':
+                captureFileName = optarg;
+                break;
+            case 'i':
+                inputFileName = optarg;
+                break;
+            case 'o':
+                outputFileName = optarg;
+                break;
+            case 'r':
+                onlyRequestId = optarg;
+                break;
+            case 't':
+                timeScale = strtod(optarg, NULL);
+                if (timeScale < 0) {
+                    std::cerr << "Invalid time scale " << optarg << std::endl;
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    if (captureFileName.empty() || optind != argc - 1)
+        return -1;
+    endpoint = argv[optind];
+
+    return 0;
+}
+
+static void usage()
+{
+    std::cerr << "Usage: gsttransformer_replay [OPTION...] ENDPOINT" << std::endl;
+    std::cerr << "  -f FILE\tCapture file to replay, required." << std::endl;
+    std::cerr << "  -i FILE\tInput media for captures of payload sizes only." << std::endl;
+    std::cerr << "  -o FILE\tJSON results file. Default stdout." << std::endl;
+    std::cerr << "  -r ID\tReplay a single captured request." << std::endl;
+    std::cerr << "  -t SCALE\tTime scale, 0.5 replays twice as fast, 0 without pacing. Default 1.0." << std::endl;
+    std::cerr << "ENDPOINT: gRPC endpoint, unix:// or host:port." << std::endl;
+
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    if (parse_opt(argc, argv))
+        usage();
+
+    logger = spdlog::stderr_logger_mt("replay");
+    logger->set_level(spdlog::level::info);
+
+    auto captured = loadCapture(captureFileName);
+    if (captured.empty()) {
+        logger->error("no complete requests in {0}", captureFileName);
+        return 1;
+    }
+
+    std::string substitute;
+    if (!inputFileName.empty()) {
+        std::ifstream ifs(inputFileName, std::ios::binary);
+        std::stringstream input;
+        input << ifs.rdbuf();
+        substitute = input.str();
+    }
+    for(auto &request : captured) {
+        if (request.sizesOnly && substitute.empty()) {
+            logger->error("request {0} was captured without payload bytes, input media is required", request.requestId);
+            return 1;
+        }
+    }
+    logger->info("replaying {0} requests at time scale {1}", captured.size(), timeScale);
+
+    auto channel = ::grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials());
+    std::mutex resultsMutex;
+    std::vector<ReplayResult> results;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for(auto &request : captured) {
+        // keep the original arrival spacing
+        if (timeScale > 0)
+            std::this_thread::sleep_until(start + scaled(request.startMicros - captured.front().startMicros));
+        threads.push_back(std::thread([&, channel] {
+            auto result = replay(channel, request, substitute);
+            std::unique_lock<std::mutex> lock(resultsMutex);
+            results.push_back(result);
+        }));
+    }
+    for(auto &thread : threads)
+        thread.join();
+
+    unsigned int compared = 0;
+    unsigned int outputMismatches = 0;
+    unsigned int reasonMismatches = 0;
+    std::vector<double> durationRatios;
+    json reasons = json::object();
+    for(auto &result : results) {
+        if (result.outputCompared) {
+            compared++;
+            if (!result.outputMatched)
+                outputMismatches++;
+        }
+        if (!result.reasonMatched)
+            reasonMismatches++;
+        if (result.durationRatio > 0)
+            durationRatios.push_back(result.durationRatio);
+        reasons[result.reason] = reasons.value(result.reason, 0) + 1;
+    }
+
+    json report;
+    report["requests"] = results.size();
+    report["timeScale"] = timeScale;
+    report["outputsCompared"] = compared;
+    report["outputMismatches"] = outputMismatches;
+    report["terminationReasonMismatches"] = reasonMismatches;
+    report["durationRatioP50"] = percentile(durationRatios, 0.5);
+    report["durationRatioP90"] = percentile(durationRatios, 0.9);
+    report["durationRatioP99"] = percentile(durationRatios, 0.99);
+    report["terminationReasons"] = reasons;
+
+    if (outputFileName.empty()) {
+        std::cout << report.dump(4) << std::endl;
+    }
+    else {
+        std::ofstream ofs(outputFileName);
+        ofs << report.dump(4) << std::endl;
+    }
+
+    return outputMismatches || reasonMismatches ? 2 : 0;
+}
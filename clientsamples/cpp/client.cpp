@@ -72,10 +72,10 @@ void transform(
     bool writeStreamClosed = false;
     while(!readStreamClosed && !writeStreamClosed && !inf.eof()) {
         request.clear_payload();
-        char buffer[4096];
-        inf.read(buffer, sizeof(buffer));
+        std::vector<char> buffer(chunkSize);
+        inf.read(buffer.data(), buffer.size());
         auto payload = request.mutable_payload();
-        payload->add_data(std::string(buffer, inf.gcount()));
+        payload->add_data(std::string(buffer.data(), inf.gcount()));
         writeStreamClosed = !requestStream->Write(request);
         totalWrite += inf.gcount();
         logger->trace("written {0}, {1} so far", inf.gcount(), totalWrite);
@@ -3,8 +3,10 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include "gsttransformer.grpc.pb.h"
+#include "loadgen.h"
 using namespace gst_transformer::service;
 
 TransformConfig transformConfig;
@@ -15,13 +17,15 @@ std::ofstream outputFileStream;
 std::string endpoint;
 int writeDelay = 0;
 bool randomizeWriteDelay = false;
+unsigned int chunkSize = 4096;
+LoadOptions loadOptions = { 0, 0, 0, 0, {} };
 
 int parse_opt(int argc, char **argv, bool requiresEndpoint)
 {
 	auto pipelineConfig = transformConfig.mutable_pipeline_parameters();
 
 	int key;
-	while ((key = getopt(argc, argv, "+e:r:w:l:b:i:o:s:p:")) != -1) {
+	while ((key = getopt(argc, argv, "+e:f:r:w:l:b:i:o:s:p:n:a:c:m:P:")) != -1) {
 		switch (key) {
 			case 'e':
 				if (!strcmp(optarg, "block"))
@@ -33,6 +37,16 @@ int parse_opt(int argc, char **argv, bool requiresEndpoint)
 					return -1;
 				}
 				break;
+			case 'f':
+				if (!strcmp(optarg, "buffer"))
+					pipelineConfig->set_output_overflow_policy(OutputOverflowPolicy::BUFFER);
+				else if (!strcmp(optarg, "spill"))
+					pipelineConfig->set_output_overflow_policy(OutputOverflowPolicy::SPILL);
+				else {
+					std::cerr << "Invalid output overflow policy " << optarg << std::endl;
+					return -1;
+				}
+				break;
 			case 'r':
 			{
 				double rate = strtod(optarg, NULL);
@@ -74,6 +88,34 @@ int parse_opt(int argc, char **argv, bool requiresEndpoint)
 			case 'p':
 				transformConfig.set_pipeline_name(optarg);
 				break;
+			case 'n':
+				loadOptions.streams = strtoul(optarg, NULL, 10);
+				break;
+			case 'a':
+				loadOptions.arrivalRate = strtod(optarg, NULL);
+				if (loadOptions.arrivalRate < 0) {
+					std::cerr << "Invalid arrival rate " << optarg << std::endl;
+					return -1;
+				}
+				break;
+			case 'c':
+				chunkSize = strtoul(optarg, NULL, 10);
+				if (chunkSize == 0) {
+					std::cerr << "Invalid chunk size " << optarg << std::endl;
+					return -1;
+				}
+				break;
+			case 'm':
+				loadOptions.inputMediaMillis = strtoul(optarg, NULL, 10);
+				break;
+			case 'P':
+			{
+				std::stringstream names(optarg);
+				std::string name;
+				while (std::getline(names, name, ','))
+					loadOptions.pipelineNames.push_back(name);
+				break;
+			}
 		}
 	}
 
@@ -83,7 +125,9 @@ int parse_opt(int argc, char **argv, bool requiresEndpoint)
 		endpoint = argv[optind];
 	}
 
-	if (transformConfig.pipeline().empty() && transformConfig.pipeline_name().empty()) {
+	loadOptions.chunkSize = chunkSize;
+
+	if (transformConfig.pipeline().empty() && transformConfig.pipeline_name().empty() && loadOptions.pipelineNames.empty()) {
 		std::cerr << "Pipeline specs (-s) or name (-p) is required." << std::endl;
 		return -1;
 	}
@@ -110,12 +154,18 @@ int parse_opt(int argc, char **argv, bool requiresEndpoint)
 void usage()
 {
 	std::cerr << "Usage: gsttransformerclient [OPTION...] [<endpoint>]" << std::endl;
+	std::cerr << "  -a RATE\tLoad mode stream arrivals per second, 0 starts all at once. Default 0." << std::endl;
 	std::cerr << "  -b BUFFER\tSet pipeline output buffer size. Default 0 (no buffering)." << std::endl;
+	std::cerr << "  -c BYTES\tInput chunk size per request message. Default 4096." << std::endl;
 	std::cerr << "  -e MODE\tRate enforcement mode {BLOCK|ERROR}. Default BLOCK." << std::endl;
+	std::cerr << "  -f MODE\tOutput overflow policy {buffer|spill}. Default buffer." << std::endl;
 	std::cerr << "  -i FILE\tInput file. Default stdin." << std::endl;
 	std::cerr << "  -l LEN\tSet maximum audio duration in milliseconds, 0 unlimited. Default 0." << std::endl;
+	std::cerr << "  -m MS\tInput media duration, paces input in realtime. Default 0 (as fast as possible)." << std::endl;
+	std::cerr << "  -n STREAMS\tLoad mode: run STREAMS concurrent streams and report statistics." << std::endl;
 	std::cerr << "  -o FILE\tOutput file. Default stout." << std::endl;
 	std::cerr << "  -p PIPELINE\tExisting pipeline name as defined on the server." << std::endl;
+	std::cerr << "  -P LIST\tLoad mode comma separated pipeline names picked at random per stream." << std::endl;
 	std::cerr << "  -r RATE\tTransformation rate in double: 1.0 = RT, -1 passthrough. Default 1.0." << std::endl;
 	std::cerr << "  -s SPECS\tGStream pipeline specs." << std::endl;
 	std::cerr << "  -w MS\tWrite delay in ms, 0 none, <0ms random up to |MS|" << std::endl;
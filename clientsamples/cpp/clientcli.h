@@ -18,6 +18,7 @@ all copies or substantial portions of the Software.
 #define __CLIENTCLI_H__
 
 #include "gsttransformer.grpc.pb.h"
+#include "loadgen.h"
 
 using namespace gst_transformer::service;
 
@@ -27,6 +28,8 @@ extern std::ofstream outputFileStream;
 extern int writeDelay;
 extern bool randomizeWriteDelay;
 extern std::string endpoint;
+extern unsigned int chunkSize;
+extern LoadOptions loadOptions;
 
 int parse_opt(int argc, char **argv, bool);
 void usage();
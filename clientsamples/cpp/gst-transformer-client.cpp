@@ -15,6 +15,7 @@ all copies or substantial portions of the Software.
 
 */
 
+#include <sstream>
 #include <grpc/grpc.h>
 #include <grpc++/channel.h>
 #include <grpc++/client_context.h>
@@ -38,7 +39,14 @@ int main(int argc, char **argv)
     spdlog::set_level(spdlog::level::trace);
 
     auto channel = ::grpc::CreateChannel(endpoint, grpc::InsecureChannelCredentials());
-    transform(logger, channel, inputFileStream, outputFileStream, transformConfig);
+    if (loadOptions.streams > 0) {
+        std::stringstream input;
+        input << inputFileStream.rdbuf();
+        runLoad(logger, channel, input.str(), transformConfig, loadOptions);
+    }
+    else {
+        transform(logger, channel, inputFileStream, outputFileStream, transformConfig);
+    }
 
     logger->info("all done, exiting.");
 }
@@ -15,6 +15,7 @@ all copies or substantial portions of the Software.
 */
 
 #include <gst/gst.h>
+#include <sstream>
 #include <grpc/grpc.h>
 #include <grpc++/channel.h>
 #include <grpc++/server.h>
@@ -58,13 +59,20 @@ int main(int argc, char **argv)
     std::unique_ptr<::grpc::ServerCompletionQueue> completionQueue = builder.AddCompletionQueue();
     auto server = builder.BuildAndStart();
     auto channel = server->InProcessChannel(::grpc::ChannelArguments());
-    AsyncServiceImpl asyncService(&service, completionQueue.get(), params);
+    AsyncServiceImpl asyncService(&service, nullptr, completionQueue.get(), nullptr, params);
     
     std::thread serviceThread([&] {
         asyncService.start();
     });
 
-    transform(logger, channel, inputFileStream, outputFileStream, transformConfig);
+    if (loadOptions.streams > 0) {
+        std::stringstream input;
+        input << inputFileStream.rdbuf();
+        runLoad(logger, channel, input.str(), transformConfig, loadOptions);
+    }
+    else {
+        transform(logger, channel, inputFileStream, outputFileStream, transformConfig);
+    }
 
     logger->info("all done, exiting.");
 
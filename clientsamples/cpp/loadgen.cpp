@@ -0,0 +1,186 @@
+#include <grpc/grpc.h>
+#include <grpc++/channel.h>
+#include <uuid/uuid.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "loadgen.h"
+#include "client/transformstream.h"
+
+using namespace gst_transformer::service;
+
+struct StreamStats
+{
+    std::string pipelineName;
+    // seconds from stream start to first output byte, -1 if none
+    double ttfb;
+    // seconds from stream start to completion
+    double duration;
+    double processedTime;
+    unsigned long inputBytes;
+    unsigned long outputBytes;
+    std::string completion;
+};
+
+static std::string generateRequestId()
+{
+    uuid_t requestIdUuid;
+    uuid_generate(requestIdUuid);
+    char buffer[64];
+    uuid_unparse(requestIdUuid, buffer);
+    return std::string(buffer);
+}
+
+static StreamStats runStream(
+    std::shared_ptr<::grpc::Channel> &channel,
+    const std::string &input,
+    const TransformConfig &config,
+    const LoadOptions &options)
+{
+    StreamStats stats = { config.pipeline_name(), -1, 0, 0, 0, 0, "" };
+
+    auto start = std::chrono::steady_clock::now();
+    // bytes per second of input media when paced in realtime
+    auto inputRate = options.inputMediaMillis ? input.size() * 1000.0 / options.inputMediaMillis : 0;
+    size_t offset = 0;
+    auto result = runTransformStream(channel, generateRequestId(), config, [&] (TransformRequest &request) {
+        if (offset >= input.size())
+            return false;
+        if (inputRate > 0)
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(offset / inputRate));
+
+        auto size = std::min<size_t>(options.chunkSize, input.size() - offset);
+        request.mutable_payload()->add_data(input.data() + offset, size);
+        offset += size;
+        return true;
+    });
+
+    stats.ttfb = result.ttfb;
+    stats.duration = result.duration;
+    stats.processedTime = result.completed.processed_time();
+    stats.inputBytes = result.inputBytes;
+    stats.outputBytes = result.outputBytes;
+    if (result.status.ok())
+        stats.completion = TerminationReason_Name(result.completed.termination_reason());
+    else
+        stats.completion = fmt::format("status {0}", (int)result.status.error_code());
+
+    return stats;
+}
+
+static void reportDistribution(std::shared_ptr<spdlog::logger> &logger, const std::string &name, const std::vector<double> &values)
+{
+    if (values.empty()) {
+        logger->info("{0}: no samples", name);
+        return;
+    }
+
+    logger->info("{0}: count {1}, p50 {2:.1f}ms, p90 {3:.1f}ms, p99 {4:.1f}ms, max {5:.1f}ms",
+        name,
+        values.size(),
+        percentile(values, 0.5) * 1000,
+        percentile(values, 0.9) * 1000,
+        percentile(values, 0.99) * 1000,
+        percentile(values, 1.0) * 1000);
+
+    // power of two millisecond buckets
+    std::map<unsigned long, unsigned int> histogram;
+    for(auto value : values) {
+        unsigned long bucket = 1;
+        while (bucket < value * 1000)
+            bucket <<= 1;
+        histogram[bucket]++;
+    }
+    for(auto &bucket : histogram)
+        logger->info("  <= {0}ms: {1}", bucket.first, bucket.second);
+}
+
+void runLoad(
+    std::shared_ptr<spdlog::logger> &logger,
+    std::shared_ptr<::grpc::Channel> &channel,
+    const std::string &input,
+    const TransformConfig &config,
+    const LoadOptions &options)
+{
+    std::random_device randomDevice;
+    std::default_random_engine randomSource(randomDevice());
+    std::exponential_distribution<double> arrivals(options.arrivalRate > 0 ? options.arrivalRate : 1);
+    std::uniform_int_distribution<size_t> pipelinePicker(0, options.pipelineNames.empty() ? 0 : options.pipelineNames.size() - 1);
+
+    logger->info("starting {0} streams, arrival rate {1}/s, chunk size {2}, input media {3}ms",
+        options.streams, options.arrivalRate, options.chunkSize, options.inputMediaMillis);
+
+    std::mutex statsMutex;
+    std::vector<StreamStats> allStats;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    auto nextArrival = start;
+    for(unsigned int i=0; i<options.streams; i++) {
+        // open loop: arrivals do not wait for earlier streams to complete
+        if (options.arrivalRate > 0) {
+            std::this_thread::sleep_until(nextArrival);
+            nextArrival += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(arrivals(randomSource)));
+        }
+
+        TransformConfig streamConfig(config);
+        if (!options.pipelineNames.empty()) {
+            streamConfig.clear_pipeline();
+            streamConfig.set_pipeline_name(options.pipelineNames[pipelinePicker(randomSource)]);
+        }
+
+        threads.push_back(std::thread([&, streamConfig] {
+            auto stats = runStream(channel, input, streamConfig, options);
+            logger->debug("stream {0}: ttfb {1:.1f}ms, duration {2:.1f}ms, throughput {3:.2f}xRT, {4} bytes in, {5} bytes out, {6}",
+                stats.pipelineName,
+                stats.ttfb * 1000,
+                stats.duration * 1000,
+                stats.duration > 0 ? stats.processedTime / stats.duration : 0,
+                stats.inputBytes,
+                stats.outputBytes,
+                stats.completion);
+
+            std::unique_lock<std::mutex> lock(statsMutex);
+            allStats.push_back(stats);
+        }));
+    }
+    for(auto &thread : threads)
+        thread.join();
+    auto wall = elapsedSince(start);
+
+    std::vector<double> ttfbs;
+    std::vector<double> durations;
+    std::vector<double> throughputs;
+    std::map<std::string, unsigned int> completions;
+    double processedTime = 0;
+    unsigned long outputBytes = 0;
+    for(auto &stats : allStats) {
+        if (stats.ttfb >= 0)
+            ttfbs.push_back(stats.ttfb);
+        durations.push_back(stats.duration);
+        if (stats.duration > 0)
+            throughputs.push_back(stats.processedTime / stats.duration);
+        completions[stats.completion]++;
+        processedTime += stats.processedTime;
+        outputBytes += stats.outputBytes;
+    }
+
+    logger->info("completed {0} streams in {1:.2f}s, {2:.2f} media seconds per second, {3} output bytes",
+        allStats.size(), wall, wall > 0 ? processedTime / wall : 0, outputBytes);
+    for(auto &completion : completions)
+        logger->info("completion {0}: {1}", completion.first, completion.second);
+    if (!throughputs.empty()) {
+        logger->info("per stream throughput: p50 {0:.2f}xRT, p10 {1:.2f}xRT, min {2:.2f}xRT",
+            percentile(throughputs, 0.5),
+            percentile(throughputs, 0.1),
+            percentile(throughputs, 0));
+    }
+    reportDistribution(logger, "time to first byte", ttfbs);
+    reportDistribution(logger, "stream duration", durations);
+}
@@ -0,0 +1,59 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __LOADGEN_H__
+#define __LOADGEN_H__
+
+#include <grpc/grpc.h>
+#include <grpc++/channel.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+#include "gsttransformer.grpc.pb.h"
+
+struct LoadOptions
+{
+    // number of streams to run
+    unsigned int streams;
+    // stream arrivals per second, 0 to start all streams at once
+    double arrivalRate;
+    // bytes per request message
+    unsigned int chunkSize;
+    // media duration of the input used to pace writes in realtime, 0 as fast as possible
+    unsigned int inputMediaMillis;
+    // pipeline names picked at random for each stream, empty to use the config as is
+    std::vector<std::string> pipelineNames;
+};
+
+/**
+ * Run many concurrent transform streams of the same input and report
+ * latency and throughput statistics.
+ *
+ * \param logger logger to report to.
+ * \param channel channel to the service.
+ * \param input input media.
+ * \param config base transform config for all streams.
+ * \param options load options.
+ */
+void runLoad(
+    std::shared_ptr<spdlog::logger> &logger,
+    std::shared_ptr<::grpc::Channel> &channel,
+    const std::string &input,
+    const gst_transformer::service::TransformConfig &config,
+    const LoadOptions &options);
+
+#endif
@@ -0,0 +1,269 @@
+#include "asynctransformclient.h"
+
+#include <algorithm>
+
+namespace gst_transformer {
+namespace service {
+
+const size_t AsyncTransformClient::DEFAULT_PAYLOAD_SIZE = 64 * 1024;
+
+// written requests kept per call for reuse of their buffers
+static const size_t MAX_FREE_REQUESTS = 4;
+
+AsyncTransformCall::AsyncTransformCall(::grpc::CompletionQueue *completionQueue, const AsyncTransformCallbacks &callbacks, size_t payloadSize)
+{
+    this->completionQueue = completionQueue;
+    this->callbacks = callbacks;
+    this->payloadSize = payloadSize;
+    this->started = false;
+    this->writing = false;
+    this->writesDoneRequested = false;
+    this->writesDoneSent = false;
+    this->readsDone = false;
+    this->finishing = false;
+    this->pendingBytes = 0;
+
+    this->startFunction = [&] (bool ok) {
+        std::unique_lock<std::mutex> lock(this->lock);
+        if (!ok) {
+            this->readsDone = true;
+            this->finishing = true;
+            this->stream->Finish(&this->status, &this->finishFunction);
+            return;
+        }
+
+        this->started = true;
+        this->stream->Read(&this->response, &this->readDoneFunction);
+        this->writeNext();
+    };
+
+    this->writeDoneFunction = [&] (bool ok) {
+        std::unique_lock<std::mutex> lock(this->lock);
+        this->writing = false;
+        if (this->inFlight) {
+            if (this->inFlight->has_payload()) {
+                auto data = this->inFlight->mutable_payload()->mutable_data(0);
+                this->pendingBytes -= data->size();
+                if (this->freeRequests.size() < MAX_FREE_REQUESTS) {
+                    data->clear();
+                    this->freeRequests.push_back(std::move(this->inFlight));
+                }
+            }
+            this->inFlight.reset();
+        }
+
+        if (ok) {
+            this->writeNext();
+        }
+        else {
+            // stream is broken, remaining input cannot be sent
+            this->queue.clear();
+            this->filling.reset();
+            this->pendingBytes = 0;
+            this->writesDoneSent = true;
+        }
+
+        auto drained = ok && !this->writing && this->queue.empty() && this->callbacks.drained;
+        if (this->readsDone && !this->writing && !this->finishing) {
+            this->finishing = true;
+            this->stream->Finish(&this->status, &this->finishFunction);
+        }
+        lock.unlock();
+
+        if (drained)
+            this->callbacks.drained();
+    };
+
+    this->readDoneFunction = [&] (bool ok) {
+        if (ok) {
+            // single read in flight, response is not shared
+            if (this->response.has_payload()) {
+                if (this->callbacks.output) {
+                    for(auto &data : this->response.payload().data())
+                        this->callbacks.output(data);
+                }
+                // keeps payload buffers allocated for the next read
+                this->response.mutable_payload()->Clear();
+            }
+            else if (this->response.has_transform_completed()) {
+                this->completed.CopyFrom(this->response.transform_completed());
+            }
+            this->stream->Read(&this->response, &this->readDoneFunction);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(this->lock);
+        this->readsDone = true;
+        if (!this->writing && !this->finishing) {
+            this->finishing = true;
+            this->stream->Finish(&this->status, &this->finishFunction);
+        }
+    };
+
+    this->finishFunction = [&] (bool ok) {
+        if (this->callbacks.completed)
+            this->callbacks.completed(this->status, this->completed);
+
+        std::shared_ptr<AsyncTransformCall> self;
+        {
+            std::unique_lock<std::mutex> lock(this->lock);
+            self.swap(this->self);
+        }
+    };
+}
+
+AsyncTransformCall::~AsyncTransformCall()
+{
+}
+
+void AsyncTransformCall::start(GstTransformer::Stub *stub, const std::string &requestId, const TransformConfig &config)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    this->self = shared_from_this();
+
+    std::unique_ptr<TransformRequest> request(new TransformRequest());
+    request->mutable_config()->CopyFrom(config);
+    this->queue.push_back(std::move(request));
+
+    this->context.AddMetadata(ClientMetadata_Name(ClientMetadata::requestid), requestId);
+    this->stream = stub->AsyncTransform(&this->context, this->completionQueue, &this->startFunction);
+}
+
+bool AsyncTransformCall::write(const char *data, size_t size)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->writesDoneRequested || this->readsDone || this->finishing)
+        return false;
+
+    this->pendingBytes += size;
+    while (size > 0) {
+        if (!this->filling)
+            this->filling = this->newRequest();
+
+        auto buffer = this->filling->mutable_payload()->mutable_data(0);
+        auto length = std::min(this->payloadSize - buffer->size(), size);
+        buffer->append(data, length);
+        data += length;
+        size -= length;
+        if (buffer->size() >= this->payloadSize)
+            this->queueFilling();
+    }
+    this->writeNext();
+
+    return true;
+}
+
+void AsyncTransformCall::flush()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->filling)
+        this->queueFilling();
+    this->writeNext();
+}
+
+void AsyncTransformCall::writesDone()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->filling)
+        this->queueFilling();
+    this->writesDoneRequested = true;
+    this->writeNext();
+}
+
+void AsyncTransformCall::cancel()
+{
+    this->context.TryCancel();
+}
+
+size_t AsyncTransformCall::getPendingBytes()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->pendingBytes;
+}
+
+std::unique_ptr<TransformRequest> AsyncTransformCall::newRequest()
+{
+    std::unique_ptr<TransformRequest> request;
+    if (!this->freeRequests.empty()) {
+        request = std::move(this->freeRequests.back());
+        this->freeRequests.pop_back();
+    }
+    else {
+        request.reset(new TransformRequest());
+        request->mutable_payload()->add_data()->reserve(this->payloadSize);
+    }
+
+    return request;
+}
+
+void AsyncTransformCall::queueFilling()
+{
+    this->queue.push_back(std::move(this->filling));
+}
+
+void AsyncTransformCall::writeNext()
+{
+    // called locked
+    if (!this->started || this->writing || this->writesDoneSent)
+        return;
+
+    if (!this->queue.empty()) {
+        this->inFlight = std::move(this->queue.front());
+        this->queue.pop_front();
+        this->writing = true;
+        this->stream->Write(*this->inFlight, &this->writeDoneFunction);
+    }
+    else if (this->writesDoneRequested) {
+        this->writesDoneSent = true;
+        this->writing = true;
+        this->stream->WritesDone(&this->writeDoneFunction);
+    }
+}
+
+AsyncTransformClient::AsyncTransformClient(std::shared_ptr<::grpc::Channel> channel, unsigned int threads)
+{
+    this->stub = GstTransformer::NewStub(channel);
+    this->nextQueue = 0;
+
+    for(unsigned int i=0; i<std::max(threads, 1u); i++) {
+        auto completionQueue = new ::grpc::CompletionQueue();
+        this->completionQueues.push_back(std::unique_ptr<::grpc::CompletionQueue>(completionQueue));
+        this->threads.push_back(std::thread([completionQueue] {
+            void *tag;
+            bool ok;
+            while (completionQueue->Next(&tag, &ok)) {
+                auto func = *static_cast<std::function<void(bool)>*>(tag);
+                func(ok);
+            }
+        }));
+    }
+}
+
+AsyncTransformClient::~AsyncTransformClient()
+{
+    for(auto &completionQueue : this->completionQueues)
+        completionQueue->Shutdown();
+    for(auto &thread : this->threads)
+        thread.join();
+}
+
+std::shared_ptr<AsyncTransformCall> AsyncTransformClient::transform(
+    const std::string &requestId,
+    const TransformConfig &config,
+    const AsyncTransformCallbacks &callbacks,
+    size_t payloadSize)
+{
+    ::grpc::CompletionQueue *completionQueue;
+    {
+        std::unique_lock<std::mutex> lock(this->lock);
+        completionQueue = this->completionQueues[this->nextQueue++ % this->completionQueues.size()].get();
+    }
+
+    std::shared_ptr<AsyncTransformCall> call(new AsyncTransformCall(completionQueue, callbacks, std::max(payloadSize, (size_t)1)));
+    call->start(this->stub.get(), requestId, config);
+
+    return call;
+}
+
+}
+}
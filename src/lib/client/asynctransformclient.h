@@ -0,0 +1,173 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCTRANSFORMCLIENT_H__
+#define __ASYNCTRANSFORMCLIENT_H__
+
+#include <grpc++/grpc++.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gsttransformer.grpc.pb.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Callbacks of a transform call. Invoked from completion queue threads,
+ * never concurrently for the same call.
+ */
+struct AsyncTransformCallbacks
+{
+    // output data. only valid during the callback, its buffer is reused.
+    std::function<void(const std::string &data)> output;
+    // all queued input has been written, optional.
+    std::function<void()> drained;
+    // call finished. completed is empty if the service did not send it.
+    std::function<void(const ::grpc::Status &status, const TransformCompleted &completed)> completed;
+};
+
+/**
+ * A single transform call started from AsyncTransformClient.
+ *
+ * Input is coalesced into payload messages of a fixed size before being
+ * sent, with at most one write in flight. Methods are thread safe.
+ */
+class AsyncTransformCall : public std::enable_shared_from_this<AsyncTransformCall>
+{
+public:
+    ~AsyncTransformCall();
+
+    /**
+     * Queue input data.
+     *
+     * \param data input data.
+     * \param size size of data.
+     * \return false if the call is finished or writes are done.
+     */
+    bool write(const char *data, size_t size);
+    /**
+     * Send partially coalesced input without waiting for a full payload.
+     */
+    void flush();
+    /**
+     * Flush and signal end of input.
+     */
+    void writesDone();
+    /**
+     * Cancel the call.
+     */
+    void cancel();
+    /**
+     * Get input bytes queued but not yet written.
+     *
+     * \return number of bytes.
+     */
+    size_t getPendingBytes();
+
+private:
+    friend class AsyncTransformClient;
+
+    std::mutex lock;
+    ::grpc::ClientContext context;
+    ::grpc::CompletionQueue *completionQueue;
+    std::unique_ptr<::grpc::ClientAsyncReaderWriter<TransformRequest, TransformResponse>> stream;
+    AsyncTransformCallbacks callbacks;
+    size_t payloadSize;
+
+    std::function<void(bool)> startFunction;
+    std::function<void(bool)> writeDoneFunction;
+    std::function<void(bool)> readDoneFunction;
+    std::function<void(bool)> finishFunction;
+
+    // held while operations are in flight
+    std::shared_ptr<AsyncTransformCall> self;
+    bool started;
+    bool writing;
+    bool writesDoneRequested;
+    bool writesDoneSent;
+    bool readsDone;
+    bool finishing;
+    std::unique_ptr<TransformRequest> filling;
+    std::deque<std::unique_ptr<TransformRequest>> queue;
+    // written requests kept for their buffers
+    std::vector<std::unique_ptr<TransformRequest>> freeRequests;
+    std::unique_ptr<TransformRequest> inFlight;
+    size_t pendingBytes;
+    TransformResponse response;
+    TransformCompleted completed;
+    ::grpc::Status status;
+
+    AsyncTransformCall(::grpc::CompletionQueue *completionQueue, const AsyncTransformCallbacks &callbacks, size_t payloadSize);
+    void start(GstTransformer::Stub *stub, const std::string &requestId, const TransformConfig &config);
+    std::unique_ptr<TransformRequest> newRequest();
+    void queueFilling();
+    void writeNext();
+};
+
+/**
+ * Client for many concurrent transform calls over a single channel,
+ * driven by a shared set of completion queue threads.
+ */
+class AsyncTransformClient
+{
+public:
+    static const size_t DEFAULT_PAYLOAD_SIZE;
+
+    /**
+     * Construct a new client.
+     *
+     * \param channel channel to the service.
+     * \param threads number of completion queue threads.
+     */
+    AsyncTransformClient(std::shared_ptr<::grpc::Channel> channel, unsigned int threads = 1);
+    /**
+     * Shutdown completion queues. All calls must have completed.
+     */
+    ~AsyncTransformClient();
+
+    /**
+     * Start a new transform call.
+     *
+     * \param requestId request ID.
+     * \param config transform config.
+     * \param callbacks call callbacks.
+     * \param payloadSize size of input payload messages.
+     * \return new call.
+     */
+    std::shared_ptr<AsyncTransformCall> transform(
+        const std::string &requestId,
+        const TransformConfig &config,
+        const AsyncTransformCallbacks &callbacks,
+        size_t payloadSize = DEFAULT_PAYLOAD_SIZE);
+
+private:
+    std::unique_ptr<GstTransformer::Stub> stub;
+    std::vector<std::unique_ptr<::grpc::CompletionQueue>> completionQueues;
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    size_t nextQueue;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "transformstream.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace gst_transformer {
+namespace service {
+
+TransformStreamResult runTransformStream(
+    const std::shared_ptr<::grpc::Channel> &channel,
+    const std::string &requestId,
+    const TransformConfig &config,
+    const std::function<bool(TransformRequest &request)> &nextInput,
+    const std::function<void(const std::string &data)> &output)
+{
+    TransformStreamResult result;
+    result.ttfb = -1;
+    result.duration = 0;
+    result.inputBytes = 0;
+    result.outputBytes = 0;
+
+    auto client = GstTransformer::NewStub(channel);
+    ::grpc::ClientContext context;
+    context.AddMetadata(ClientMetadata_Name(ClientMetadata::requestid), requestId);
+
+    auto start = std::chrono::steady_clock::now();
+    auto stream = client->Transform(&context);
+
+    TransformRequest request;
+    request.mutable_config()->CopyFrom(config);
+    stream->Write(request);
+
+    std::thread reader([&] {
+        TransformResponse response;
+        while (stream->Read(&response)) {
+            if (response.has_payload()) {
+                for(auto &data : response.payload().data()) {
+                    result.outputBytes += data.size();
+                    if (output)
+                        output(data);
+                }
+                if (result.ttfb < 0 && result.outputBytes > 0)
+                    result.ttfb = elapsedSince(start);
+            }
+            else if (response.has_transform_completed()) {
+                result.completed.CopyFrom(response.transform_completed());
+            }
+        }
+    });
+
+    while (true) {
+        request.Clear();
+        if (!nextInput(request))
+            break;
+        if (!stream->Write(request))
+            break;
+        for(auto &data : request.payload().data())
+            result.inputBytes += data.size();
+    }
+    stream->WritesDone();
+    reader.join();
+
+    result.status = stream->Finish();
+    result.duration = elapsedSince(start);
+
+    return result;
+}
+
+double elapsedSince(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(std::vector<double> values, double q)
+{
+    if (values.empty())
+        return -1;
+
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(q * values.size()))];
+}
+
+}
+}
@@ -0,0 +1,87 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __TRANSFORMSTREAM_H__
+#define __TRANSFORMSTREAM_H__
+
+#include <grpc++/grpc++.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "gsttransformer.grpc.pb.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Outcome of a transform stream driven by runTransformStream.
+ */
+struct TransformStreamResult
+{
+    ::grpc::Status status;
+    // empty if the service did not send it
+    TransformCompleted completed;
+    // seconds from stream start to first output byte, -1 if none
+    double ttfb;
+    // seconds from stream start to completion
+    double duration;
+    unsigned long inputBytes;
+    unsigned long outputBytes;
+};
+
+/**
+ * Run a blocking transform stream: send the config, then input until
+ * there is no more, while output is read on a separate thread.
+ *
+ * \param channel channel to the service.
+ * \param requestId request ID sent in the call metadata.
+ * \param config transform config.
+ * \param nextInput fills the payload of the next request, may block to pace
+ * input. returns false when there is no more input.
+ * \param output called with each output buffer from the reading thread, optional.
+ * \return stream result.
+ */
+TransformStreamResult runTransformStream(
+    const std::shared_ptr<::grpc::Channel> &channel,
+    const std::string &requestId,
+    const TransformConfig &config,
+    const std::function<bool(TransformRequest &request)> &nextInput,
+    const std::function<void(const std::string &data)> &output = nullptr);
+
+/**
+ * Seconds elapsed since a point in time.
+ *
+ * \param start start time.
+ * \return elapsed seconds.
+ */
+double elapsedSince(const std::chrono::steady_clock::time_point &start);
+
+/**
+ * Nearest rank percentile of a set of values.
+ *
+ * \param values values, in any order.
+ * \param q quantile between 0 and 1.
+ * \return percentile value, -1 if values is empty.
+ */
+double percentile(std::vector<double> values, double q);
+
+}
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "cpuaffinity.h"
+
+#include <fmt/format.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// from linux/mempolicy.h
+static const int MEMORY_POLICY_PREFERRED = 1;
+
+std::vector<int> CpuAffinity::parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        if (range.empty())
+            continue;
+
+        try {
+            auto dash = range.find('-');
+            auto first = std::stoi(range.substr(0, dash));
+            auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            if (first < 0 || last < first)
+                throw std::invalid_argument(range);
+            for(int cpu=first; cpu<=last; cpu++)
+                cpus.push_back(cpu);
+        }
+        catch(std::logic_error &e) {
+            throw std::invalid_argument(fmt::format("invalid cpu list {0}", list));
+        }
+    }
+
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+    return cpus;
+}
+
+std::string CpuAffinity::formatCpuList(const std::vector<int> &cpus)
+{
+    std::string list;
+    for(size_t i=0; i<cpus.size(); i++) {
+        auto last = i;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+            last++;
+
+        if (!list.empty())
+            list += ",";
+        if (last == i)
+            list += std::to_string(cpus[i]);
+        else
+            list += fmt::format("{0}-{1}", cpus[i], cpus[last]);
+        i = last;
+    }
+
+    return list;
+}
+
+std::map<int, std::vector<int>> CpuAffinity::getNumaNodes()
+{
+    std::map<int, std::vector<int>> nodes;
+    // node IDs need not be contiguous, e.g. with sockets offline
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string onlineList;
+    if (!online.fail())
+        std::getline(online, onlineList);
+
+    for(auto node : parseCpuList(onlineList)) {
+        std::ifstream ifs(fmt::format("/sys/devices/system/node/node{0}/cpulist", node));
+        if (ifs.fail())
+            continue;
+
+        std::string list;
+        std::getline(ifs, list);
+        auto cpus = parseCpuList(list);
+        // memory-only nodes have nothing to place pipelines on
+        if (!cpus.empty())
+            nodes[node] = cpus;
+    }
+
+    if (nodes.empty()) {
+        std::vector<int> cpus;
+        auto count = sysconf(_SC_NPROCESSORS_ONLN);
+        for(int cpu=0; cpu<count; cpu++)
+            cpus.push_back(cpu);
+        nodes[0] = cpus;
+    }
+
+    return nodes;
+}
+
+bool CpuAffinity::setThreadAffinity(const std::vector<int> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool CpuAffinity::setThreadMemoryNode(int node)
+{
+    unsigned long mask = 0;
+    if (node < 0 || node >= (int)sizeof(mask) * 8)
+        return false;
+    mask = 1UL << node;
+
+    return syscall(SYS_set_mempolicy, MEMORY_POLICY_PREFERRED, &mask, sizeof(mask) * 8 + 1) == 0;
+}
@@ -0,0 +1,68 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __CPUAFFINITY_H__
+#define __CPUAFFINITY_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Helpers to query CPU topology and bind threads to CPUs and memory nodes.
+ */
+class CpuAffinity
+{
+public:
+    /**
+     * Parse a CPU list such as "0-3,8,10-11".
+     *
+     * \param list CPU list string.
+     * \return CPU numbers.
+     */
+    static std::vector<int> parseCpuList(const std::string &list);
+    /**
+     * Format CPU numbers as a CPU list string.
+     *
+     * \param cpus CPU numbers.
+     * \return CPU list string.
+     */
+    static std::string formatCpuList(const std::vector<int> &cpus);
+    /**
+     * Get CPUs of each online NUMA node in the system. Node IDs may be sparse,
+     * and memory-only nodes without CPUs are left out. A system without NUMA
+     * information is reported as a single node 0 with all CPUs.
+     *
+     * \return CPU numbers by node ID.
+     */
+    static std::map<int, std::vector<int>> getNumaNodes();
+    /**
+     * Bind the calling thread to a set of CPUs.
+     *
+     * \param cpus CPU numbers.
+     * \return true on success.
+     */
+    static bool setThreadAffinity(const std::vector<int> &cpus);
+    /**
+     * Make memory allocated by the calling thread prefer a NUMA node.
+     *
+     * \param node NUMA node.
+     * \return true on success.
+     */
+    static bool setThreadMemoryNode(int node);
+};
+
+#endif
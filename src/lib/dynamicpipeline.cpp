@@ -1,15 +1,19 @@
 #include "dynamicpipeline.h"
 
-#include <spdlog/sinks/stdout_sinks.h>
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
 #include <unistd.h>
+#include <algorithm>
 #include <iostream>
 
 #include "server/grunloop.h"
+#include "requestlogger.h"
 
 const std::string DynamicPipeline::SOURCE_NAME = "psource";
 const std::string DynamicPipeline::SINK_NAME = "psink";
+const guint64 DynamicPipeline::MIN_INPUT_BUFFER_BYTES = 4096;
+const gint64 DynamicPipeline::INPUT_BUFFER_ADJUST_INTERVAL = 100 * GST_MSECOND;
+const guint DynamicPipeline::EXTERNAL_PACING_MAX_BUFFERS = 32;
 
 DynamicPipeline::~DynamicPipeline()
 {
@@ -19,7 +23,7 @@ DynamicPipeline::~DynamicPipeline()
     }
 
     if (this->bus) {
-        gst_bus_remove_watch(this->bus);
+        gst_bus_set_sync_handler(this->bus, NULL, NULL, NULL);
         gst_object_unref(this->bus);
     }
     if (this->source)
@@ -60,14 +64,34 @@ void DynamicPipeline::start(
     this->done = false;
     this->terminationReason = PipelineTerminationReason::NONE;
     this->terminationMessage.clear();
-    this->terminationCallback = termination;
+    {
+        std::lock_guard<std::mutex> lock(this->callbackMutex);
+        this->terminationCallback = termination;
+        this->callbacksDisabled = false;
+    }
     this->totalBytesRead = 0;
     this->totalBytesWritten = 0;
     this->processedTime = 0;
+    this->lastInputBufferAdjustTime = 0;
     this->lastWriteTime = std::chrono::steady_clock::now();
 
-    gst_element_set_state(this->pipeline, GST_STATE_PLAYING);
-    if (this->parameters.getRate() > 0) {
+    if (this->flushing) {
+        // rewound pipeline is still PLAYING, resume streaming and announce a new stream
+        gst_element_send_event(GST_ELEMENT(this->source), gst_event_new_flush_stop(TRUE));
+        auto sourcePad = gst_element_get_static_pad(GST_ELEMENT(this->source), "src");
+        auto streamId = gst_pad_create_stream_id(sourcePad, GST_ELEMENT(this->source), NULL);
+        auto event = gst_event_new_stream_start(streamId);
+        gst_event_set_group_id(event, gst_util_group_id_next());
+        gst_pad_push_event(sourcePad, event);
+        g_free(streamId);
+        gst_object_unref(sourcePad);
+        this->flushing = false;
+    }
+    else {
+        gst_element_set_state(this->pipeline, GST_STATE_PLAYING);
+    }
+    // stepping is cancelled by flushes so it is sent for every stream
+    if (this->parameters.getRate() > 0 && !this->parameters.getExternalPacing()) {
         auto event = gst_event_new_step(GST_FORMAT_PERCENT, 100, this->parameters.getRate(), FALSE, FALSE);
         gst_element_send_event(GST_ELEMENT(this->sink), event);
     }
@@ -106,27 +130,167 @@ void DynamicPipeline::waitUntilCompleted()
 }
 
 std::vector<std::string> DynamicPipeline::getPendingSample(int count)
+{
+    double endTime;
+    return this->getPendingSample(count, -1, endTime);
+}
+
+std::vector<std::string> DynamicPipeline::getPendingSample(int count, double maxTime, double &endTime)
 {
     std::vector<std::string> sampleBuffers;
 
     for(int i=0; i<count; i++) {
-        GstSample *sample = NULL;
-        g_signal_emit_by_name(this->sink, "pull-sample", &sample);
-        if (sample) {
-            auto buffer = gst_sample_get_buffer(sample);
-            GstMapInfo info;
-            gst_buffer_map(buffer, &info, GST_MAP_READ);
-            sampleBuffers.emplace_back((const char *)info.data, info.size);
-            gst_buffer_unmap(buffer, &info);
-            gst_sample_unref(sample);
-
-            this->totalBytesWritten += info.size;
-        }
+        if (!this->holdNextSample())
+            break;
+        if (maxTime >= 0 && this->heldSample.endTime > maxTime * GST_SECOND)
+            break;
+
+        endTime = (double)this->heldSample.endTime / GST_SECOND;
+        this->totalBytesWritten += this->heldSample.data.size();
+        sampleBuffers.emplace_back(std::move(this->heldSample.data));
+        this->hasHeldSample = false;
     }
 
     return sampleBuffers;
 }
 
+double DynamicPipeline::getNextSampleTime()
+{
+    if (!this->holdNextSample())
+        return -1;
+
+    return (double)this->heldSample.endTime / GST_SECOND;
+}
+
+bool DynamicPipeline::holdNextSample()
+{
+    if (this->hasHeldSample)
+        return true;
+
+    if (this->parameters.getOutputOverflowPolicy() == OutputOverflowPolicy::SPILL) {
+        std::string error;
+        {
+            std::lock_guard<std::mutex> lock(this->outputMutex);
+            // spilled samples are always newer than the ones in memory
+            if (!this->outputQueue.empty()) {
+                this->heldSample = std::move(this->outputQueue.front());
+                this->outputQueue.pop_front();
+                this->outputQueueBytes -= this->heldSample.data.size();
+            }
+            else if (this->spill && !this->spill->empty()) {
+                try {
+                    this->spill->read(this->heldSample.data, &this->heldSample.endTime);
+                }
+                catch(std::exception &e) {
+                    error = e.what();
+                }
+            }
+            else {
+                return false;
+            }
+        }
+        if (!error.empty()) {
+            this->logger->error("unable to read spilled output: {0}", error);
+            this->terminatePipeline(PipelineTerminationReason::INTERNAL_ERROR, error, true);
+            return false;
+        }
+    }
+    else {
+        auto sample = gst_app_sink_try_pull_sample(this->sink, 0);
+        if (!sample)
+            return false;
+
+        auto buffer = gst_sample_get_buffer(sample);
+        GstMapInfo info;
+        gst_buffer_map(buffer, &info, GST_MAP_READ);
+        this->heldSample.data.assign((const char *)info.data, info.size);
+        this->heldSample.endTime = this->getSampleEndTime(sample);
+        gst_buffer_unmap(buffer, &info);
+        gst_sample_unref(sample);
+    }
+
+    this->hasHeldSample = true;
+    this->countSampleTaken();
+
+    return true;
+}
+
+bool DynamicPipeline::countSampleQueued()
+{
+    // in batched mode only notify when the consumer has drained all samples.
+    // consumer may pull a sample before it is counted here, so count can be
+    // transiently negative.
+    if (!this->parameters.getBatchedSampleNotifications())
+        return true;
+    return this->pendingSamples.fetch_add(1) == 0;
+}
+
+void DynamicPipeline::countSampleTaken()
+{
+    // count down as each sample is taken, not once per batch. a sample queued
+    // after the last pull must see the count reach zero and notify, otherwise
+    // the consumer waits for a notification that never comes.
+    if (this->parameters.getBatchedSampleNotifications())
+        this->pendingSamples.fetch_sub(1);
+}
+
+gint64 DynamicPipeline::getSampleEndTime(GstSample *sample)
+{
+    auto time = getStreamEndTime(gst_sample_get_buffer(sample), gst_sample_get_segment(sample));
+    // untimestamped output is released as the pipeline progresses
+    return time == -1 ? this->processedTime.load() : time;
+}
+
+bool DynamicPipeline::spoolSample()
+{
+    auto sample = gst_app_sink_pull_sample(this->sink);
+    if (!sample)
+        return false;
+
+    auto buffer = gst_sample_get_buffer(sample);
+    GstMapInfo info;
+    gst_buffer_map(buffer, &info, GST_MAP_READ);
+    auto spooled = true;
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(this->outputMutex);
+        if ((this->spill && !this->spill->empty()) ||
+            this->outputQueueBytes + info.size > this->parameters.getSpillThresholdBytes()) {
+            try {
+                if (!this->spill) {
+                    this->logger->debug("output exceeded {0} bytes, spilling to disk", this->parameters.getSpillThresholdBytes());
+                    this->spill.reset(new SpillBuffer(this->parameters.getSpillDirectory(), this->parameters.getSpillQuotaBytes()));
+                }
+                spooled = this->spill->append((const char *)info.data, info.size, this->getSampleEndTime(sample));
+            }
+            catch(std::exception &e) {
+                error = e.what();
+                spooled = false;
+            }
+        }
+        else {
+            this->outputQueue.emplace_back();
+            this->outputQueue.back().data.assign((const char *)info.data, info.size);
+            this->outputQueue.back().endTime = this->getSampleEndTime(sample);
+            this->outputQueueBytes += info.size;
+        }
+    }
+    gst_buffer_unmap(buffer, &info);
+    gst_sample_unref(sample);
+
+    if (!error.empty()) {
+        this->logger->error("unable to spill output: {0}", error);
+        this->terminatePipeline(PipelineTerminationReason::INTERNAL_ERROR, error);
+    }
+    else if (!spooled) {
+        this->terminatePipeline(
+            PipelineTerminationReason::OUTPUT_QUOTA_EXCEEDED,
+            fmt::format("output spill quota exceeded: {0} bytes", this->parameters.getSpillQuotaBytes()));
+    }
+
+    return spooled;
+}
+
 PipelineTerminationReason DynamicPipeline::getTerminationReason() const
 {
     return this->terminationReason;
@@ -173,6 +337,69 @@ double DynamicPipeline::getProcessedTime() const
     return (double)this->processedTime / GST_SECOND;
 }
 
+unsigned long DynamicPipeline::getInputLevelBytes() const
+{
+    return gst_app_src_get_current_level_bytes(this->source);
+}
+
+bool DynamicPipeline::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->doneMutex);
+        if (!this->parameters.getReusable() || !this->done ||
+            this->terminationReason != PipelineTerminationReason::END_OF_STREAM)
+            return false;
+    }
+
+    this->logger->debug("resetting pipeline");
+    if (this->lastWriteTimer) {
+        g_source_remove(this->lastWriteTimer);
+        this->lastWriteTimer = 0;
+    }
+
+    // discards anything left in the elements and appsink and clears EOS.
+    // streaming stays paused until flush stop on the next start.
+    gst_element_send_event(GST_ELEMENT(this->source), gst_event_new_flush_start());
+
+    // flushing does not wait for streaming threads, which may be in a callback right now
+    {
+        std::unique_lock<std::mutex> lock(this->callbackMutex);
+        this->callbacksDisabled = true;
+        while (this->activeCallbacks > 0)
+            this->callbackCond.wait(lock);
+        this->terminationCallback = nullptr;
+        this->sampleAvailableCallback = nullptr;
+        this->enoughDataCallback = nullptr;
+        this->needDataCallback = nullptr;
+        this->eosCallback = nullptr;
+    }
+    // tasks queued by earlier callbacks reference the previous owner, run them before it is gone
+    if (!GRunLoop::main()->isOnLoop()) {
+        std::unique_lock<std::mutex> lock(drainedMutex);
+        g_idle_add(&drain, this);
+        this->drained = false;
+        while(!this->drained)
+            this->drainedCond.wait(lock);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->outputMutex);
+        this->outputQueue.clear();
+        this->outputQueueBytes = 0;
+        this->spill.reset();
+    }
+    this->pendingSamples = 0;
+    this->hasHeldSample = false;
+    gst_segment_init(&this->outputSegment, GST_FORMAT_UNDEFINED);
+    this->flushing = true;
+
+    return true;
+}
+
+void DynamicPipeline::setLogger(const std::shared_ptr<spdlog::logger> &logger)
+{
+    this->logger = logger;
+}
+
 void DynamicPipeline::stop()
 {
     this->logger->debug("stopping");  
@@ -183,7 +410,9 @@ void DynamicPipeline::stop()
 
 int DynamicPipeline::addData(const char *buffer, int size)
 {
-    auto gbuffer = gst_buffer_new_and_alloc(size);
+    auto gbuffer = this->parameters.getPooledInputBuffers() ?
+        IngestBufferPool::shared()->acquire(size) :
+        gst_buffer_new_and_alloc(size);
     GstMapInfo info; 
     gst_buffer_map(gbuffer, &info, GST_MAP_WRITE);
     memcpy(info.data, buffer, size);
@@ -219,13 +448,33 @@ void DynamicPipeline::terminatePipeline(PipelineTerminationReason reason, const
         g_idle_add(gstTerminateIdleCallback, this);
     }
 
-    this->terminationCallback(force);
+    if (this->enterCallback()) {
+        if (this->terminationCallback)
+            this->terminationCallback(force);
+        this->leaveCallback();
+    }
+}
+
+bool DynamicPipeline::enterCallback()
+{
+    std::lock_guard<std::mutex> lock(this->callbackMutex);
+    if (this->callbacksDisabled)
+        return false;
+
+    this->activeCallbacks++;
+    return true;
+}
+
+void DynamicPipeline::leaveCallback()
+{
+    std::lock_guard<std::mutex> lock(this->callbackMutex);
+    if (--this->activeCallbacks == 0)
+        this->callbackCond.notify_all();
 }
 
 DynamicPipeline * DynamicPipeline::createFromSpecs(const PipelineParameters &parameters, const std::string &pipelineId, const std::string &specs)
 {
-    // TODO: not ideal but convenient. global lock.
-    auto logger = spdlog::stderr_logger_mt(fmt::format("dynamicpipeline/{0}", pipelineId));
+    auto logger = RequestLogger::shared()->get("dynamicpipeline", pipelineId);
 
     auto desc = fmt::format("appsrc name={0} ! {1} ! appsink name={2}", SOURCE_NAME, specs, SINK_NAME);
     logger->debug("spec: {0}", desc);
@@ -251,9 +500,16 @@ DynamicPipeline::DynamicPipeline(std::shared_ptr<spdlog::logger> &logger, const
     this->pipelineId = pipelineId;
     this->pipeline = pipeline;
     this->lastWriteTimer = 0;
-
+    this->outputQueueBytes = 0;
+    this->pendingSamples = 0;
+    this->hasHeldSample = false;
+    this->flushing = false;
+    this->callbacksDisabled = false;
+    this->activeCallbacks = 0;
+
+    // messages are filtered on the posting thread, only the ones acted upon reach the runloop
     this->bus = gst_pipeline_get_bus(GST_PIPELINE(this->pipeline));
-    gst_bus_add_watch(this->bus, (GstBusFunc) gstBusMessage, this);
+    gst_bus_set_sync_handler(this->bus, gstBusSyncMessage, this, NULL);
 
     this->source = GST_APP_SRC(gst_bin_get_by_name(GST_BIN(this->pipeline), SOURCE_NAME.c_str()));
     if (!this->source)
@@ -275,22 +531,115 @@ DynamicPipeline::DynamicPipeline(std::shared_ptr<spdlog::logger> &logger, const
         "block", FALSE, 
         "emit-signals", TRUE,
         NULL);
-    g_object_set(this->sink, 
-        "emit-signals", TRUE, 
-        "sync", (this->parameters.getRate() <= 0 ? FALSE : TRUE),
-        NULL);
+    if (this->parameters.getExternalPacing()) {
+        // output is released by the consumer, bound appsink so the pipeline
+        // blocks instead of running ahead unbounded
+        g_object_set(this->sink, 
+            "emit-signals", TRUE, 
+            "sync", FALSE,
+            "max-buffers", EXTERNAL_PACING_MAX_BUFFERS,
+            NULL);
+    }
+    else {
+        g_object_set(this->sink, 
+            "emit-signals", TRUE, 
+            "sync", (this->parameters.getRate() <= 0 ? FALSE : TRUE),
+            NULL);
+    }
     g_signal_connect(this->sink, "new-sample", G_CALLBACK(gstNewSample), this);
+
+    // track processed media time from output timestamps on the streaming thread
+    gst_segment_init(&this->outputSegment, GST_FORMAT_UNDEFINED);
+    auto sinkPad = gst_element_get_static_pad(GST_ELEMENT(this->sink), "sink");
+    gst_pad_add_probe(
+        sinkPad,
+        (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+        gstSinkPadProbe,
+        this,
+        NULL);
+    gst_object_unref(sinkPad);
     g_signal_connect(this->source, "enough-data", G_CALLBACK(gstEnoughData), this);
     g_signal_connect(this->source, "need-data", G_CALLBACK(gstNeedData), this);
 
     this->logger->info("created pipeline");
 }
 
-gboolean DynamicPipeline::gstBusMessage(GstBus * bus, GstMessage * message, gpointer user_data)
+GstBusSyncReply DynamicPipeline::gstBusSyncMessage(GstBus * bus, GstMessage * message, gpointer user_data)
 {
     auto p = static_cast<DynamicPipeline *>(user_data);
 
-    p->logger->debug("bus got message {0}", gst_message_type_get_name(GST_MESSAGE_TYPE(message)));
+    switch(GST_MESSAGE_TYPE(message)) {
+        case GST_MESSAGE_ERROR:
+        case GST_MESSAGE_WARNING:
+        case GST_MESSAGE_EOS:
+            p->forwardBusMessage(message);
+            break;
+
+        case GST_MESSAGE_APPLICATION:
+        case GST_MESSAGE_ELEMENT:
+        {
+            auto structure = gst_message_get_structure(message);
+            if (structure && p->messageHandlers.find(gst_structure_get_name(structure)) != p->messageHandlers.end())
+                p->forwardBusMessage(message);
+            break;
+        }
+
+        case GST_MESSAGE_STREAM_STATUS:
+        {
+            GstStreamStatusType type;
+            GstElement *owner;
+            gst_message_parse_stream_status(message, &type, &owner);
+            SPDLOG_LOGGER_TRACE(p->logger, "status type is {0} from {1}", type, GST_OBJECT_NAME(owner));
+            // called on the thread creating the task, before it is started
+            if (type == GST_STREAM_STATUS_TYPE_CREATE && p->parameters.getSharedTaskPool()) {
+                auto value = gst_message_get_stream_status_object(message);
+                if (value && G_VALUE_HOLDS_OBJECT(value) && GST_IS_TASK(g_value_get_object(value)))
+                    gst_task_set_pool(GST_TASK(g_value_get_object(value)), SharedTaskPool::shared()->getTaskPool());
+            }
+            // called on the streaming thread itself, which may be a reused pool thread
+            if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+                auto cpus = p->parameters.getCpuAffinity();
+                if (!cpus.empty() && !CpuAffinity::setThreadAffinity(cpus))
+                    p->logger->warn("unable to set streaming thread affinity for {0}", GST_OBJECT_NAME(owner));
+                if (p->parameters.getNumaNode() >= 0 && !CpuAffinity::setThreadMemoryNode(p->parameters.getNumaNode()))
+                    p->logger->warn("unable to set streaming thread memory node for {0}", GST_OBJECT_NAME(owner));
+            }
+            break;
+        }
+
+        default:
+            SPDLOG_LOGGER_TRACE(p->logger, "dropping bus message {0} from {1}",
+                gst_message_type_get_name(GST_MESSAGE_TYPE(message)),
+                GST_OBJECT_NAME(message->src));
+            break;
+    }
+
+    // there is no bus watch, anything passed would pile up on the bus
+    return GST_BUS_DROP;
+}
+
+void DynamicPipeline::forwardBusMessage(GstMessage *message)
+{
+    auto forwarded = new ForwardedMessage();
+    forwarded->pipeline = this;
+    forwarded->message = gst_message_ref(message);
+    // same priority as a bus watch, ahead of idle callbacks such as drain
+    g_idle_add_full(G_PRIORITY_DEFAULT, gstBusIdleCallback, forwarded, NULL);
+}
+
+gboolean DynamicPipeline::gstBusIdleCallback(gpointer user_data)
+{
+    auto forwarded = static_cast<ForwardedMessage *>(user_data);
+    forwarded->pipeline->handleBusMessage(forwarded->message);
+    gst_message_unref(forwarded->message);
+    delete forwarded;
+
+    return G_SOURCE_REMOVE;
+}
+
+void DynamicPipeline::handleBusMessage(GstMessage *message)
+{
+    this->logger->debug("bus got message {0}", gst_message_type_get_name(GST_MESSAGE_TYPE(message)));
 
     switch(GST_MESSAGE_TYPE(message)) {
         case GST_MESSAGE_ERROR: {
@@ -298,77 +647,153 @@ gboolean DynamicPipeline::gstBusMessage(GstBus * bus, GstMessage * message, gpoi
             gchar *dbg_info = NULL;
 
             gst_message_parse_error(message, &err, &dbg_info);
-            p->logger->error("error from element {0}: {1}", GST_OBJECT_NAME(message->src), err->message);
-            p->logger->error("debugging info: {0}", (dbg_info) ? dbg_info : "none");
+            this->logger->error("error from element {0}: {1}", GST_OBJECT_NAME(message->src), err->message);
+            this->logger->error("debugging info: {0}", (dbg_info) ? dbg_info : "none");
             g_error_free(err);
             g_free(dbg_info);
     
-            p->terminationReason = PipelineTerminationReason::INTERNAL_ERROR;
-            gst_element_set_state(p->pipeline, GST_STATE_NULL);
+            this->terminationReason = PipelineTerminationReason::INTERNAL_ERROR;
+            gst_element_set_state(this->pipeline, GST_STATE_NULL);
     
             break;
         }
 
-        case GST_MESSAGE_EOS:
-        {
-            if (p->eosCallback)
-                p->eosCallback();
-            std::lock_guard<std::mutex> lock(p->doneMutex);
-            p->done = true;
-            p->doneCond.notify_one();
-            break;
-        }
+        case GST_MESSAGE_WARNING: {
+            GError *err = NULL;
+            gchar *dbg_info = NULL;
+
+            gst_message_parse_warning(message, &err, &dbg_info);
+            this->logger->warn("warning from element {0}: {1}", GST_OBJECT_NAME(message->src), err->message);
+            g_error_free(err);
+            g_free(dbg_info);
 
-        case GST_MESSAGE_STATE_CHANGED: 
-        {
-            GstState old_state, new_state;
-            gst_message_parse_state_changed(message, &old_state, &new_state, NULL);
-            p->logger->debug("element {0} changed state from {1} to {2}",
-                GST_OBJECT_NAME (message->src),
-                gst_element_state_get_name (old_state),
-                gst_element_state_get_name (new_state));
             break;
         }
 
-        case GST_MESSAGE_STREAM_STATUS:
+        case GST_MESSAGE_EOS:
         {
-            GstStreamStatusType type;
-            GstElement *owner;
-            gst_message_parse_stream_status(message, &type, &owner);
-            p->logger->debug("status type is {0} from {1}", type, GST_OBJECT_NAME(owner));
+            // the pipeline does not post EOS again after a flush, reusable
+            // pipelines pick it up from the sink pad instead
+            if (!this->parameters.getReusable())
+                this->handleEOS();
             break;
         }
 
-        case GST_MESSAGE_STREAM_START:
+        case GST_MESSAGE_APPLICATION:
+        case GST_MESSAGE_ELEMENT:
         {
-            p->logger->debug("stream start from {0}", GST_OBJECT_NAME(message->src));
+            auto iterator = this->messageHandlers.find(gst_structure_get_name(gst_message_get_structure(message)));
+            if (iterator != this->messageHandlers.end())
+                iterator->second(message);
             break;
         }
 
         default:
             break;
     }
+}
+
+void DynamicPipeline::addMessageHandler(const std::string &name, const std::function<void(GstMessage *)> &handler)
+{
+    this->messageHandlers[name] = handler;
+}
 
-    return TRUE;
+void DynamicPipeline::handleEOS()
+{
+    if (this->enterCallback()) {
+        if (this->eosCallback)
+            this->eosCallback();
+        this->leaveCallback();
+    }
+    std::lock_guard<std::mutex> lock(this->doneMutex);
+    this->done = true;
+    this->doneCond.notify_one();
+
+    if (this->parameters.getOutputOverflowPolicy() == OutputOverflowPolicy::SPILL && !this->parameters.getReusable()) {
+        // all output is spooled, release pipeline resources without waiting for the consumer
+        this->logger->debug("output spooled, stopping pipeline");
+        gst_element_set_state(this->pipeline, GST_STATE_NULL);
+    }
 }
 
 void DynamicPipeline::gstNewSample(GstElement *sink, gpointer user_data)
 {
     auto p = static_cast<DynamicPipeline *>(user_data);
-    if (p->sampleAvailableCallback)
-        p->sampleAvailableCallback();
-
-    gint64 pos;
-    auto r = gst_element_query_position(p->pipeline, GST_FORMAT_TIME, &pos);
-    if (!r)
-        p->logger->warn("unable to query position");
-    if (pos > p->processedTime)
-        p->processedTime = pos;
-    if (p->parameters.getLengthLimit() > 0 ) {
-        if (p->processedTime >= p->parameters.getLengthLimit() * GST_MSECOND) {
-                p->terminatePipeline(
+    if (p->parameters.getOutputOverflowPolicy() == OutputOverflowPolicy::SPILL) {
+        if (!p->spoolSample())
+            return;
+    }
+    if (p->countSampleQueued() && p->enterCallback()) {
+        if (p->sampleAvailableCallback)
+            p->sampleAvailableCallback();
+        p->leaveCallback();
+    }
+}
+
+GstPadProbeReturn DynamicPipeline::gstSinkPadProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+    auto p = static_cast<DynamicPipeline *>(user_data);
+
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        auto event = GST_PAD_PROBE_INFO_EVENT(info);
+        if (GST_EVENT_TYPE(event) == GST_EVENT_SEGMENT)
+            gst_event_copy_segment(event, &p->outputSegment);
+        // all samples of the stream have been signalled by now
+        else if (GST_EVENT_TYPE(event) == GST_EVENT_EOS && p->parameters.getReusable())
+            g_idle_add(gstEOSIdleCallback, p);
+    }
+    else if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        p->updateProcessedTime(GST_PAD_PROBE_INFO_BUFFER(info));
+    }
+    else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        auto list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        auto length = gst_buffer_list_length(list);
+        if (length > 0)
+            p->updateProcessedTime(gst_buffer_list_get(list, length - 1));
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+gint64 DynamicPipeline::getStreamEndTime(GstBuffer *buffer, const GstSegment *segment)
+{
+    if (!buffer || !segment || !GST_BUFFER_PTS_IS_VALID(buffer) || segment->format != GST_FORMAT_TIME)
+        return -1;
+
+    auto end = GST_BUFFER_PTS(buffer);
+    if (GST_BUFFER_DURATION_IS_VALID(buffer))
+        end += GST_BUFFER_DURATION(buffer);
+    if (GST_CLOCK_TIME_IS_VALID(segment->stop) && end > segment->stop)
+        end = segment->stop;
+    auto streamTime = gst_segment_to_stream_time(segment, GST_FORMAT_TIME, end);
+
+    return GST_CLOCK_TIME_IS_VALID(streamTime) ? (gint64)streamTime : -1;
+}
+
+void DynamicPipeline::updateProcessedTime(GstBuffer *buffer)
+{
+    auto pos = getStreamEndTime(buffer, &this->outputSegment);
+    if (pos == -1) {
+        // output without timestamps, fall back to querying the pipeline
+        if (!gst_element_query_position(this->pipeline, GST_FORMAT_TIME, &pos)) {
+            this->logger->warn("unable to query position");
+            return;
+        }
+    }
+
+    if (pos > this->processedTime)
+        this->processedTime = pos;
+    if (this->parameters.getInputBufferTimeMilliseconds() > 0 &&
+        this->processedTime - this->lastInputBufferAdjustTime >= INPUT_BUFFER_ADJUST_INTERVAL) {
+        this->lastInputBufferAdjustTime = this->processedTime;
+        this->adjustInputBuffer();
+    }
+    if (this->parameters.getLengthLimit() > 0 &&
+        this->terminationReason != PipelineTerminationReason::ALLOWED_DURATION_EXCEEDED) {
+        if (this->processedTime >= this->parameters.getLengthLimit() * GST_MSECOND) {
+                this->terminatePipeline(
                     PipelineTerminationReason::ALLOWED_DURATION_EXCEEDED, 
-                    fmt::format("max duration exceeded: {0}ms", p->parameters.getLengthLimit()));
+                    fmt::format("max duration exceeded: {0}ms", this->parameters.getLengthLimit()));
         }
     }
 }
@@ -383,16 +808,22 @@ void DynamicPipeline::gstEnoughData(GstElement * pipeline, guint size, gpointer
             fmt::format("rate exceeded: {0}rt", p->parameters.getRate()));
     }
     else {
-        if (p->enoughDataCallback)
-            p->enoughDataCallback();
+        if (p->enterCallback()) {
+            if (p->enoughDataCallback)
+                p->enoughDataCallback();
+            p->leaveCallback();
+        }
     }
 }
 
 void DynamicPipeline::gstNeedData(GstElement * pipeline, guint size, gpointer user_data)
 {
     auto p = static_cast<DynamicPipeline *>(user_data);
-    if (p->needDataCallback)
-        p->needDataCallback();
+    if (p->enterCallback()) {
+        if (p->needDataCallback)
+            p->needDataCallback();
+        p->leaveCallback();
+    }
 }
 
 gboolean DynamicPipeline::gstTerminateIdleCallback(gpointer user_data)
@@ -408,13 +839,46 @@ gboolean DynamicPipeline::gstTerminateIdleCallback(gpointer user_data)
     return G_SOURCE_REMOVE;
 }
 
+gboolean DynamicPipeline::gstEOSIdleCallback(gpointer user_data)
+{
+    auto p = static_cast<DynamicPipeline *>(user_data);
+    p->logger->debug("end of stream");
+    p->handleEOS();
+
+    return G_SOURCE_REMOVE;
+}
+
+void DynamicPipeline::adjustInputBuffer()
+{
+    // input is untimestamped bytes, so measure its media bitrate from what has
+    // left appsrc versus the media time that came out of the pipeline.
+    guint64 level = gst_app_src_get_current_level_bytes(this->source);
+    gint64 processedTime = this->processedTime;
+    guint64 totalBytesRead = this->totalBytesRead;
+    if (processedTime <= 0 || totalBytesRead <= level)
+        return;
+
+    auto consumedBytes = totalBytesRead - level;
+    auto bytesPerSecond = gst_util_uint64_scale(consumedBytes, GST_SECOND, processedTime);
+    auto maxBytes = std::max(
+        MIN_INPUT_BUFFER_BYTES,
+        gst_util_uint64_scale(bytesPerSecond, this->parameters.getInputBufferTimeMilliseconds(), 1000));
+    if (maxBytes != gst_app_src_get_max_bytes(this->source)) {
+        SPDLOG_LOGGER_TRACE(this->logger, "adjusting appsrc max bytes to {0} for {1}ms at {2}B/s",
+            maxBytes,
+            this->parameters.getInputBufferTimeMilliseconds(),
+            bytesPerSecond);
+        gst_app_src_set_max_bytes(this->source, maxBytes);
+    }
+}
+
 gboolean DynamicPipeline::writeTimeoutCallback(gpointer user_data)
 {
     auto p = static_cast<DynamicPipeline *>(user_data);
     
     auto timeNow = std::chrono::steady_clock::now();
     auto diffMillis = std::chrono::duration_cast<std::chrono::milliseconds>(timeNow - p->lastWriteTime).count();
-    p->logger->trace("writeTimeoutCallback: delta {0}/{1}ms", diffMillis, p->parameters.getReadTimeoutMilliseconds());
+    SPDLOG_LOGGER_TRACE(p->logger, "writeTimeoutCallback: delta {0}/{1}ms", diffMillis, p->parameters.getReadTimeoutMilliseconds());
     if (diffMillis > p->parameters.getReadTimeoutMilliseconds()) {
         p->terminatePipeline(
             PipelineTerminationReason::READ_TIMEOUT,
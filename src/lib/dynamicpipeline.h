@@ -23,6 +23,10 @@ all copies or substantial portions of the Software.
 #include <glib.h>
 
 #include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <atomic>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -31,6 +35,10 @@ all copies or substantial portions of the Software.
 
 #include "pipelineparameters.h"
 #include "pipeline.h"
+#include "spillbuffer.h"
+#include "sharedtaskpool.h"
+#include "cpuaffinity.h"
+#include "ingestbufferpool.h"
 
 /**
  * An implementation of a media pipeline that uses gst launch syntax for pipeline
@@ -38,7 +46,8 @@ all copies or substantial portions of the Software.
  * 
  * It works by prepending an appsrc and appending an appsink to drive the pipeline.
  * 
- * \notice this type of pipelines can only be used once.
+ * \notice this type of pipelines can only be used once, unless its parameters
+ * make it reusable in which case reset() rewinds it for the next stream.
  */
 class DynamicPipeline : public Pipeline
 {
@@ -96,6 +105,8 @@ public:
      * Set callback function when there are samples to consume.
      * 
      * The callback will be called multiple times whenever a sample is ready.
+     * With batched sample notifications, it is only called when a sample becomes
+     * ready after all previously ready samples have been consumed.
      * 
      * \param callback callback function
      */
@@ -119,14 +130,33 @@ public:
      */
     void setEOSCallback(const std::function<void()> &callback) override;
     /**
-     * Gets pending samples.
+     * Gets pending samples without blocking.
      * 
-     * Caller must have kept track of SampleAvailableCallbacks.
+     * Caller must have kept track of SampleAvailableCallbacks. With batched
+     * sample notifications, caller should keep pulling until fewer than count
+     * samples are returned.
      * 
-     * \param count get this number of samples
+     * \param count maximum number of samples to get
      * \return vector of samples
      */
     std::vector<std::string> getPendingSample(int count) override;
+    /**
+     * Gets pending samples that end at or before a media time without blocking.
+     * 
+     * Used by consumers that pace output themselves.
+     * 
+     * \param count maximum number of samples to get
+     * \param maxTime maximum sample end time in seconds, -1 for any
+     * \param endTime receives end time in seconds of the last returned sample
+     * \return vector of samples
+     */
+    std::vector<std::string> getPendingSample(int count, double maxTime, double &endTime) override;
+    /**
+     * Get end time of the next pending sample.
+     * 
+     * \return end time in seconds of the next sample, -1 if none is pending.
+     */
+    double getNextSampleTime() override;
 
     /**
      * Get how many bytes have been processed by the pipeline.
@@ -148,6 +178,43 @@ public:
      * \return seconds of stream media time processed.
      */
     double getProcessedTime() const override;
+    /**
+     * Get how many input bytes are queued in appsrc.
+     * 
+     * \return number of queued input bytes.
+     */
+    unsigned long getInputLevelBytes() const override;
+
+    /**
+     * Rewind a reusable pipeline that ended normally so it can process a new
+     * stream without leaving PLAYING state.
+     * 
+     * Pending output and callbacks are discarded. Callbacks still running on
+     * streaming threads are waited for, and tasks they queued on the main
+     * loop have run when this returns. The new stream begins with the next
+     * call to start().
+     * 
+     * \return true if the pipeline was rewound, false if it cannot be reused.
+     */
+    bool reset();
+    /**
+     * Replace the logger, e.g. with the one of the request leasing a pooled pipeline.
+     * Only called while the pipeline is idle.
+     *
+     * \param logger new logger.
+     */
+    void setLogger(const std::shared_ptr<spdlog::logger> &logger);
+
+    /**
+     * Forward application and element messages with a structure name to the
+     * runloop. Other such messages are dropped on the posting thread.
+     * 
+     * Must be called before the pipeline is started.
+     * 
+     * \param name structure name of the messages.
+     * \param handler function called on the runloop with the message.
+     */
+    void addMessageHandler(const std::string &name, const std::function<void(GstMessage *)> &handler);
 
     /**
      * Create a new pipeline instances from gst specs.
@@ -162,6 +229,21 @@ public:
 private:
     static const std::string SOURCE_NAME;
     static const std::string SINK_NAME;
+    static const guint64 MIN_INPUT_BUFFER_BYTES;
+    static const gint64 INPUT_BUFFER_ADJUST_INTERVAL;
+    static const guint EXTERNAL_PACING_MAX_BUFFERS;
+
+    struct PendingSample
+    {
+        std::string data;
+        gint64 endTime;
+    };
+
+    struct ForwardedMessage
+    {
+        DynamicPipeline *pipeline;
+        GstMessage *message;
+    };
 
     std::shared_ptr<spdlog::logger> logger;
     std::function<void(bool)> terminationCallback;
@@ -175,9 +257,13 @@ private:
     std::string terminationMessage;
     guint lastWriteTimer;
     std::chrono::steady_clock::time_point lastWriteTime;
-    unsigned long totalBytesRead;
+    // written on the runloop, read from streaming threads
+    std::atomic<unsigned long> totalBytesRead;
     unsigned long totalBytesWritten;
-    gint64 processedTime;
+    // written from streaming threads, read on the runloop
+    std::atomic<gint64> processedTime;
+    GstSegment outputSegment;
+    gint64 lastInputBufferAdjustTime;
     bool done;
     std::mutex doneMutex;
     std::condition_variable doneCond;
@@ -188,15 +274,46 @@ private:
     std::function<void()> enoughDataCallback;
     std::function<void()> needDataCallback;
     std::function<void()> eosCallback;
+    // callbacks are invoked from streaming threads, reset() disables them and waits for running ones
+    std::mutex callbackMutex;
+    std::condition_variable callbackCond;
+    bool callbacksDisabled;
+    unsigned int activeCallbacks;
+    std::mutex outputMutex;
+    std::deque<PendingSample> outputQueue;
+    unsigned long outputQueueBytes;
+    std::unique_ptr<SpillBuffer> spill;
+    // samples queued in the sink and not yet taken, used for batched notifications
+    std::atomic<int> pendingSamples;
+    PendingSample heldSample;
+    bool hasHeldSample;
+    bool flushing;
+    std::map<std::string, std::function<void(GstMessage *)>> messageHandlers;
 
     DynamicPipeline(std::shared_ptr<spdlog::logger> &logger, const PipelineParameters &parameters, const std::string &pipelineId, GstElement *pipeline);
     void terminatePipeline(PipelineTerminationReason reason, const std::string &message, bool force = true);
+    bool spoolSample();
+    void updateProcessedTime(GstBuffer *buffer);
+    void adjustInputBuffer();
+    bool holdNextSample();
+    bool countSampleQueued();
+    void countSampleTaken();
+    bool enterCallback();
+    void leaveCallback();
+    gint64 getSampleEndTime(GstSample *sample);
+    void handleEOS();
+    void forwardBusMessage(GstMessage *message);
+    void handleBusMessage(GstMessage *message);
 
-    static gboolean gstBusMessage(GstBus * bus, GstMessage * message, gpointer user_data);
+    static GstBusSyncReply gstBusSyncMessage(GstBus * bus, GstMessage * message, gpointer user_data);
+    static gboolean gstBusIdleCallback(gpointer user_data);
     static void gstEnoughData(GstElement * pipeline, guint size, gpointer user_data);
     static void gstNeedData(GstElement * pipeline, guint size, gpointer user_data);
+    static gint64 getStreamEndTime(GstBuffer *buffer, const GstSegment *segment);
     static void gstNewSample(GstElement *sink, gpointer user_data);
+    static GstPadProbeReturn gstSinkPadProbe(GstPad *pad, GstPadProbeInfo *info, gpointer user_data);
     static gboolean gstTerminateIdleCallback(gpointer user_data);
+    static gboolean gstEOSIdleCallback(gpointer user_data);
     static gboolean writeTimeoutCallback(gpointer user_data);
     static gboolean drain(gpointer user_data);
 };
@@ -0,0 +1,291 @@
+#include "ingestbufferpool.h"
+
+#include <fmt/format.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+
+/**
+ * Allocator handing out fixed size chunks carved from large slabs.
+ * Released chunks are kept in per size free lists and never returned
+ * to the system.
+ */
+typedef struct {
+    GstAllocator parent;
+    bool hugePages;
+    std::mutex *lock;
+    std::unordered_map<size_t, std::vector<char *>> *freeChunks;
+    std::vector<std::pair<char *, size_t>> *slabs;
+} SlabAllocator;
+
+typedef struct {
+    GstAllocatorClass parent_class;
+} SlabAllocatorClass;
+
+struct SlabChunk
+{
+    SlabAllocator *allocator;
+    char *data;
+    size_t size;
+};
+
+static const size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+G_DEFINE_TYPE(SlabAllocator, slab_allocator, GST_TYPE_ALLOCATOR)
+
+static char * slab_allocator_map(size_t size, bool hugePages)
+{
+    if (!hugePages) {
+        auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return data == MAP_FAILED ? nullptr : static_cast<char *>(data);
+    }
+
+    // huge pages need the slab to be aligned to the huge page size
+    auto data = mmap(nullptr, size + SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return nullptr;
+    auto start = reinterpret_cast<uintptr_t>(data);
+    auto aligned = (start + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1);
+    if (aligned > start)
+        munmap(data, aligned - start);
+    munmap(reinterpret_cast<char *>(aligned) + size, SLAB_SIZE - (aligned - start));
+    madvise(reinterpret_cast<char *>(aligned), size, MADV_HUGEPAGE);
+
+    return reinterpret_cast<char *>(aligned);
+}
+
+static char * slab_allocator_get_chunk(SlabAllocator *allocator, size_t size)
+{
+    std::unique_lock<std::mutex> lock(*allocator->lock);
+
+    auto &chunks = (*allocator->freeChunks)[size];
+    if (chunks.empty()) {
+        auto slabSize = std::max(size, SLAB_SIZE);
+        auto slab = slab_allocator_map(slabSize, allocator->hugePages);
+        if (!slab)
+            return nullptr;
+        allocator->slabs->push_back(std::make_pair(slab, slabSize));
+        for(size_t offset=0; offset + size <= slabSize; offset += size)
+            chunks.push_back(slab + offset);
+    }
+
+    auto chunk = chunks.back();
+    chunks.pop_back();
+
+    return chunk;
+}
+
+static void slab_allocator_release_chunk(gpointer user_data)
+{
+    auto chunk = static_cast<SlabChunk *>(user_data);
+    {
+        std::unique_lock<std::mutex> lock(*chunk->allocator->lock);
+        (*chunk->allocator->freeChunks)[chunk->size].push_back(chunk->data);
+    }
+    gst_object_unref(chunk->allocator);
+    delete chunk;
+}
+
+static GstMemory * slab_allocator_alloc(GstAllocator *allocator, gsize size, GstAllocationParams *params)
+{
+    auto slabAllocator = reinterpret_cast<SlabAllocator *>(allocator);
+
+    // chunks are page aligned powers of two, which satisfies any requested alignment
+    size_t chunkSize = 4096;
+    while (chunkSize < params->prefix + size + params->padding)
+        chunkSize <<= 1;
+
+    auto data = slab_allocator_get_chunk(slabAllocator, chunkSize);
+    if (!data)
+        return nullptr;
+
+    // memory may outlive its pool, keep the allocator until it is released
+    gst_object_ref(allocator);
+    auto chunk = new SlabChunk();
+    chunk->allocator = slabAllocator;
+    chunk->data = data;
+    chunk->size = chunkSize;
+
+    return gst_memory_new_wrapped(
+        (GstMemoryFlags)params->flags,
+        data,
+        chunkSize,
+        params->prefix,
+        size,
+        chunk,
+        slab_allocator_release_chunk);
+}
+
+static void slab_allocator_free(GstAllocator *allocator, GstMemory *memory)
+{
+    // memory is wrapped, it is released through its destroy notify
+}
+
+static void slab_allocator_finalize(GObject *object)
+{
+    auto allocator = reinterpret_cast<SlabAllocator *>(object);
+    for(auto &slab : *allocator->slabs)
+        munmap(slab.first, slab.second);
+    delete allocator->slabs;
+    delete allocator->freeChunks;
+    delete allocator->lock;
+
+    G_OBJECT_CLASS(slab_allocator_parent_class)->finalize(object);
+}
+
+static void slab_allocator_class_init(SlabAllocatorClass *klass)
+{
+    auto allocatorClass = GST_ALLOCATOR_CLASS(klass);
+    allocatorClass->alloc = slab_allocator_alloc;
+    allocatorClass->free = slab_allocator_free;
+    G_OBJECT_CLASS(klass)->finalize = slab_allocator_finalize;
+}
+
+static void slab_allocator_init(SlabAllocator *allocator)
+{
+    GST_OBJECT_FLAG_SET(allocator, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+    allocator->hugePages = false;
+    allocator->lock = new std::mutex();
+    allocator->freeChunks = new std::unordered_map<size_t, std::vector<char *>>();
+    allocator->slabs = new std::vector<std::pair<char *, size_t>>();
+}
+
+IngestBufferPool * IngestBufferPool::Shared = nullptr;
+std::mutex IngestBufferPool::SharedLock;
+
+const size_t IngestBufferPool::MIN_CLASS_SIZE = 4 * 1024;
+const size_t IngestBufferPool::MAX_CLASS_SIZE = 1024 * 1024;
+const unsigned long IngestBufferPool::DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+
+IngestBufferPool::IngestBufferPool()
+{
+    this->started = false;
+    this->maxBytes = DEFAULT_MAX_BYTES;
+    this->hugePages = false;
+    this->allocator = nullptr;
+    this->oversized = 0;
+}
+
+IngestBufferPool * IngestBufferPool::shared()
+{
+    std::unique_lock<std::mutex> lock(SharedLock);
+    if (Shared == nullptr)
+        Shared = new IngestBufferPool();
+
+    return Shared;
+}
+
+void IngestBufferPool::configure(unsigned long maxBytes, bool hugePages)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->started)
+        return;
+
+    if (maxBytes > 0)
+        this->maxBytes = maxBytes;
+    this->hugePages = hugePages;
+}
+
+void IngestBufferPool::startPools()
+{
+    auto allocator = reinterpret_cast<SlabAllocator *>(g_object_new(slab_allocator_get_type(), NULL));
+    allocator->hugePages = this->hugePages;
+    this->allocator = GST_ALLOCATOR_CAST(allocator);
+
+    for(auto size=MIN_CLASS_SIZE; size<=MAX_CLASS_SIZE; size <<= 1) {
+        std::unique_ptr<SizeClass> sizeClass(new SizeClass());
+        sizeClass->size = size;
+        sizeClass->hits = 0;
+        sizeClass->misses = 0;
+        sizeClass->pool = gst_buffer_pool_new();
+
+        auto config = gst_buffer_pool_get_config(sizeClass->pool);
+        gst_buffer_pool_config_set_params(config, NULL, size, 0, std::max(this->maxBytes / size, 1ul));
+        gst_buffer_pool_config_set_allocator(config, this->allocator, NULL);
+        if (!gst_buffer_pool_set_config(sizeClass->pool, config) || !gst_buffer_pool_set_active(sizeClass->pool, TRUE))
+            throw std::runtime_error(fmt::format("unable to start ingest buffer pool of size {0}", size));
+
+        this->classes.push_back(std::move(sizeClass));
+    }
+
+    this->started = true;
+}
+
+GstBuffer * IngestBufferPool::acquire(size_t size)
+{
+    if (!this->started) {
+        std::unique_lock<std::mutex> lock(this->lock);
+        if (!this->started)
+            this->startPools();
+    }
+
+    if (size > MAX_CLASS_SIZE) {
+        this->oversized++;
+        return gst_buffer_new_and_alloc(size);
+    }
+
+    size_t index = 0;
+    while ((MIN_CLASS_SIZE << index) < size)
+        index++;
+    auto &sizeClass = this->classes[index];
+
+    GstBuffer *buffer = nullptr;
+    GstBufferPoolAcquireParams params = {};
+    params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+    if (gst_buffer_pool_acquire_buffer(sizeClass->pool, &buffer, &params) != GST_FLOW_OK || !buffer) {
+        sizeClass->misses++;
+        return gst_buffer_new_and_alloc(size);
+    }
+
+    sizeClass->hits++;
+    gst_buffer_set_size(buffer, size);
+
+    return buffer;
+}
+
+unsigned long IngestBufferPool::getHits() const
+{
+    // size classes do not change once started
+    if (!this->started)
+        return 0;
+
+    unsigned long hits = 0;
+    for(auto &sizeClass : this->classes)
+        hits += sizeClass->hits;
+
+    return hits;
+}
+
+unsigned long IngestBufferPool::getMisses() const
+{
+    if (!this->started)
+        return this->oversized;
+
+    unsigned long misses = this->oversized;
+    for(auto &sizeClass : this->classes)
+        misses += sizeClass->misses;
+
+    return misses;
+}
+
+std::string IngestBufferPool::debugString() const
+{
+    auto hits = this->getHits();
+    auto misses = this->getMisses();
+    auto result = fmt::format("hits: {0}, misses: {1}, hitRate: {2:.3f}, oversized: {3}",
+        hits,
+        misses,
+        hits + misses ? (double)hits / (hits + misses) : 0.0,
+        (unsigned long)this->oversized);
+    if (!this->started)
+        return result;
+    for(auto &sizeClass : this->classes) {
+        if (sizeClass->hits || sizeClass->misses)
+            result += fmt::format(", {0}: {1}/{2}", sizeClass->size, (unsigned long)sizeClass->hits, (unsigned long)sizeClass->misses);
+    }
+
+    return result;
+}
@@ -0,0 +1,109 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __INGESTBUFFERPOOL_H__
+#define __INGESTBUFFERPOOL_H__
+
+#include <gst/gst.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+/**
+ * Process wide pools of input buffers, one per power of two size class.
+ *
+ * Buffers are recycled by gst buffer pools, and their memory is carved out
+ * of large slabs that can optionally be backed by transparent huge pages.
+ * When a size class is exhausted, or the size is larger than the largest
+ * class, a regular buffer is allocated instead.
+ */
+class IngestBufferPool
+{
+public:
+    /**
+     * Get the shared pool instance.
+     *
+     * \return shared pool.
+     */
+    static IngestBufferPool * shared();
+
+    /**
+     * Configure the pool. Only effective before the first buffer is acquired.
+     *
+     * \param maxBytes maximum bytes of buffers in each size class.
+     * \param hugePages back slabs with transparent huge pages.
+     */
+    void configure(unsigned long maxBytes, bool hugePages);
+
+    /**
+     * Get a writable buffer.
+     *
+     * \param size buffer size.
+     * \return new buffer.
+     */
+    GstBuffer * acquire(size_t size);
+
+    /**
+     * Get number of buffers served from the pools.
+     *
+     * \return hits.
+     */
+    unsigned long getHits() const;
+    /**
+     * Get number of buffers allocated outside of the pools.
+     *
+     * \return misses.
+     */
+    unsigned long getMisses() const;
+    /**
+     * Get per size class statistics for reporting.
+     *
+     * \return statistics string.
+     */
+    std::string debugString() const;
+
+private:
+    static const size_t MIN_CLASS_SIZE;
+    static const size_t MAX_CLASS_SIZE;
+    static const unsigned long DEFAULT_MAX_BYTES;
+
+    struct SizeClass
+    {
+        size_t size;
+        GstBufferPool *pool;
+        std::atomic<unsigned long> hits;
+        std::atomic<unsigned long> misses;
+    };
+
+    std::mutex lock;
+    std::atomic<bool> started;
+    unsigned long maxBytes;
+    bool hugePages;
+    GstAllocator *allocator;
+    std::vector<std::unique_ptr<SizeClass>> classes;
+    std::atomic<unsigned long> oversized;
+
+    IngestBufferPool();
+    void startPools();
+
+    static IngestBufferPool *Shared;
+    static std::mutex SharedLock;
+};
+
+#endif
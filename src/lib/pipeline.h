@@ -42,7 +42,9 @@ enum class PipelineTerminationReason
     // pipeline did not start in the required time.
     STREAM_START_TIMEOUT,
     // execution was cancelled.
-    CANCELLED
+    CANCELLED,
+    // output spilled to disk exceeded the allowed quota.
+    OUTPUT_QUOTA_EXCEEDED
 };
 
 /**
@@ -104,6 +106,8 @@ public:
      * Set callback function when there are samples to consume.
      * 
      * The callback will be called multiple times whenever a sample is ready.
+     * With batched sample notifications, it is only called when a sample becomes
+     * ready after all previously ready samples have been consumed.
      * 
      * \param callback callback function
      */
@@ -127,14 +131,33 @@ public:
      */
     virtual void setEOSCallback(const std::function<void()> &callback) = 0;
     /**
-     * Gets pending samples.
+     * Gets pending samples without blocking.
      * 
-     * Caller must have kept track of SampleAvailableCallbacks.
+     * Caller must have kept track of SampleAvailableCallbacks. With batched
+     * sample notifications, caller should keep pulling until fewer than count
+     * samples are returned.
      * 
-     * \param count get this number of samples
+     * \param count maximum number of samples to get
      * \return vector of samples
      */
     virtual std::vector<std::string> getPendingSample(int count) = 0;
+    /**
+     * Gets pending samples that end at or before a media time without blocking.
+     * 
+     * Used by consumers that pace output themselves.
+     * 
+     * \param count maximum number of samples to get
+     * \param maxTime maximum sample end time in seconds, -1 for any
+     * \param endTime receives end time in seconds of the last returned sample
+     * \return vector of samples
+     */
+    virtual std::vector<std::string> getPendingSample(int count, double maxTime, double &endTime) = 0;
+    /**
+     * Get end time of the next pending sample.
+     * 
+     * \return end time in seconds of the next sample, -1 if none is pending.
+     */
+    virtual double getNextSampleTime() = 0;
     
     /**
      * Get how many bytes have been processed by the pipeline.
@@ -156,6 +179,12 @@ public:
      * \return seconds of stream media time processed.
      */
     virtual double getProcessedTime() const = 0;
+    /**
+     * Get how many input bytes are queued ahead of the pipeline.
+     * 
+     * \return number of queued input bytes, 0 if not known.
+     */
+    virtual unsigned long getInputLevelBytes() const = 0;
 };
 
 #endif
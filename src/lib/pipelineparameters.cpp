@@ -2,14 +2,26 @@
 
 #include <fmt/format.h>
 
+#include "cpuaffinity.h"
+
 PipelineParameters::PipelineParameters()
 {
     this->rateEnforcementPolicy = RateEnforcementPolicy::BLOCK;
     this->rate = 1.0;
     this->lengthLimit = 0.0;
     this->inputBufferSize = 0;
+    this->inputBufferTimeMilliseconds = 0;
     this->readTimeoutMilliseconds = 0;
     this->startToleranceBytes = 0;
+    this->outputOverflowPolicy = OutputOverflowPolicy::BUFFER;
+    this->spillThresholdBytes = 1024 * 1024;
+    this->spillQuotaBytes = 0;
+    this->batchedSampleNotifications = false;
+    this->externalPacing = false;
+    this->sharedTaskPool = false;
+    this->numaNode = -1;
+    this->pooledInputBuffers = false;
+    this->reusable = false;
 }
 
 RateEnforcementPolicy PipelineParameters::getRateEnforcemnetPolicy() const
@@ -56,6 +68,17 @@ PipelineParameters & PipelineParameters::setInputBufferSize(unsigned int inputBu
     return *this;
 }
 
+unsigned int PipelineParameters::getInputBufferTimeMilliseconds() const
+{
+    return this->inputBufferTimeMilliseconds;
+}
+
+PipelineParameters & PipelineParameters::setInputBufferTimeMilliseconds(unsigned int inputBufferTimeMilliseconds)
+{
+    this->inputBufferTimeMilliseconds = inputBufferTimeMilliseconds;
+    return *this;
+}
+
 unsigned int PipelineParameters::getStartToleranceBytes() const
 {
     return this->startToleranceBytes;
@@ -78,15 +101,150 @@ PipelineParameters & PipelineParameters::setReadTimeoutMilliseconds(unsigned int
     return *this;
 }
 
+OutputOverflowPolicy PipelineParameters::getOutputOverflowPolicy() const
+{
+    return this->outputOverflowPolicy;
+}
+
+PipelineParameters & PipelineParameters::setOutputOverflowPolicy(OutputOverflowPolicy policy)
+{
+    this->outputOverflowPolicy = policy;
+    return *this;
+}
+
+unsigned long PipelineParameters::getSpillThresholdBytes() const
+{
+    return this->spillThresholdBytes;
+}
+
+PipelineParameters & PipelineParameters::setSpillThresholdBytes(unsigned long spillThresholdBytes)
+{
+    this->spillThresholdBytes = spillThresholdBytes;
+    return *this;
+}
+
+unsigned long PipelineParameters::getSpillQuotaBytes() const
+{
+    return this->spillQuotaBytes;
+}
+
+PipelineParameters & PipelineParameters::setSpillQuotaBytes(unsigned long spillQuotaBytes)
+{
+    this->spillQuotaBytes = spillQuotaBytes;
+    return *this;
+}
+
+std::string PipelineParameters::getSpillDirectory() const
+{
+    return this->spillDirectory;
+}
+
+PipelineParameters & PipelineParameters::setSpillDirectory(const std::string &spillDirectory)
+{
+    this->spillDirectory = spillDirectory;
+    return *this;
+}
+
+bool PipelineParameters::getBatchedSampleNotifications() const
+{
+    return this->batchedSampleNotifications;
+}
+
+PipelineParameters & PipelineParameters::setBatchedSampleNotifications(bool batchedSampleNotifications)
+{
+    this->batchedSampleNotifications = batchedSampleNotifications;
+    return *this;
+}
+
+bool PipelineParameters::getExternalPacing() const
+{
+    return this->externalPacing;
+}
+
+PipelineParameters & PipelineParameters::setExternalPacing(bool externalPacing)
+{
+    this->externalPacing = externalPacing;
+    return *this;
+}
+
+bool PipelineParameters::getSharedTaskPool() const
+{
+    return this->sharedTaskPool;
+}
+
+PipelineParameters & PipelineParameters::setSharedTaskPool(bool sharedTaskPool)
+{
+    this->sharedTaskPool = sharedTaskPool;
+    return *this;
+}
+
+std::vector<int> PipelineParameters::getCpuAffinity() const
+{
+    return this->cpuAffinity;
+}
+
+PipelineParameters & PipelineParameters::setCpuAffinity(const std::vector<int> &cpuAffinity)
+{
+    this->cpuAffinity = cpuAffinity;
+    return *this;
+}
+
+int PipelineParameters::getNumaNode() const
+{
+    return this->numaNode;
+}
+
+PipelineParameters & PipelineParameters::setNumaNode(int numaNode)
+{
+    this->numaNode = numaNode;
+    return *this;
+}
+
+bool PipelineParameters::getPooledInputBuffers() const
+{
+    return this->pooledInputBuffers;
+}
+
+PipelineParameters & PipelineParameters::setPooledInputBuffers(bool pooledInputBuffers)
+{
+    this->pooledInputBuffers = pooledInputBuffers;
+    return *this;
+}
+
+bool PipelineParameters::getReusable() const
+{
+    return this->reusable;
+}
+
+PipelineParameters & PipelineParameters::setReusable(bool reusable)
+{
+    this->reusable = reusable;
+    return *this;
+}
+
 std::string PipelineParameters::debugString() const
 {
     return fmt::format(
-        "rate: {0}, lengthLimit: {1}, rateEnforcementPolicy: {2}, inputBufferSize: {3}, startToleranceBytes: {4}, readTimeoutMillis: {5}",
+        "rate: {0}, lengthLimit: {1}, rateEnforcementPolicy: {2}, inputBufferSize: {3}, startToleranceBytes: {4}, readTimeoutMillis: {5}, "
+        "outputOverflowPolicy: {6}, spillThresholdBytes: {7}, spillQuotaBytes: {8}, batchedSampleNotifications: {9}, "
+        "inputBufferTimeMillis: {10}, externalPacing: {11}, sharedTaskPool: {12}, "
+        "cpuAffinity: {13}, numaNode: {14}, pooledInputBuffers: {15}, reusable: {16}",
         this->rate,
         this->lengthLimit,
         (int)this->rateEnforcementPolicy,
         this->inputBufferSize,
         this->startToleranceBytes,
-        this->readTimeoutMilliseconds
+        this->readTimeoutMilliseconds,
+        (int)this->outputOverflowPolicy,
+        this->spillThresholdBytes,
+        this->spillQuotaBytes,
+        this->batchedSampleNotifications,
+        this->inputBufferTimeMilliseconds,
+        this->externalPacing,
+        this->sharedTaskPool,
+        CpuAffinity::formatCpuList(this->cpuAffinity),
+        this->numaNode,
+        this->pooledInputBuffers,
+        this->reusable
     );
 }
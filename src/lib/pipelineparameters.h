@@ -18,12 +18,18 @@ all copies or substantial portions of the Software.
 #define __PIPELINEPARAMETERS_H__
 
 #include <string>
+#include <vector>
 
 enum class RateEnforcementPolicy {
     BLOCK = 0,
     ERROR = 1
 };
 
+enum class OutputOverflowPolicy {
+    BUFFER = 0,
+    SPILL = 1
+};
+
 /**
  * Wrapper for pipeline parameters.
  */
@@ -43,12 +49,36 @@ public:
 
     unsigned int getInputBufferSize() const;
     PipelineParameters & setInputBufferSize(unsigned int inputBufferSize);
+    unsigned int getInputBufferTimeMilliseconds() const;
+    PipelineParameters & setInputBufferTimeMilliseconds(unsigned int inputBufferTimeMilliseconds);
 
     unsigned int getStartToleranceBytes() const;
     PipelineParameters & setStartToleranceBytes(unsigned int startToleranceBytes);
 
     unsigned int getReadTimeoutMilliseconds() const;
     PipelineParameters & setReadTimeoutMilliseconds(unsigned int readTimeoutMilliseconds);
+    OutputOverflowPolicy getOutputOverflowPolicy() const;
+    PipelineParameters & setOutputOverflowPolicy(OutputOverflowPolicy policy);
+    unsigned long getSpillThresholdBytes() const;
+    PipelineParameters & setSpillThresholdBytes(unsigned long spillThresholdBytes);
+    unsigned long getSpillQuotaBytes() const;
+    PipelineParameters & setSpillQuotaBytes(unsigned long spillQuotaBytes);
+    std::string getSpillDirectory() const;
+    PipelineParameters & setSpillDirectory(const std::string &spillDirectory);
+    bool getBatchedSampleNotifications() const;
+    PipelineParameters & setBatchedSampleNotifications(bool batchedSampleNotifications);
+    bool getExternalPacing() const;
+    PipelineParameters & setExternalPacing(bool externalPacing);
+    bool getSharedTaskPool() const;
+    PipelineParameters & setSharedTaskPool(bool sharedTaskPool);
+    std::vector<int> getCpuAffinity() const;
+    PipelineParameters & setCpuAffinity(const std::vector<int> &cpuAffinity);
+    int getNumaNode() const;
+    PipelineParameters & setNumaNode(int numaNode);
+    bool getPooledInputBuffers() const;
+    PipelineParameters & setPooledInputBuffers(bool pooledInputBuffers);
+    bool getReusable() const;
+    PipelineParameters & setReusable(bool reusable);
 
     std::string debugString() const;
 
@@ -57,8 +87,20 @@ private:
     double lengthLimit;
     RateEnforcementPolicy rateEnforcementPolicy;
     unsigned int inputBufferSize;
+    unsigned int inputBufferTimeMilliseconds;
     unsigned int startToleranceBytes;
     unsigned int readTimeoutMilliseconds;
+    OutputOverflowPolicy outputOverflowPolicy;
+    unsigned long spillThresholdBytes;
+    unsigned long spillQuotaBytes;
+    std::string spillDirectory;
+    bool batchedSampleNotifications;
+    bool externalPacing;
+    bool sharedTaskPool;
+    std::vector<int> cpuAffinity;
+    int numaNode;
+    bool pooledInputBuffers;
+    bool reusable;
 };
 
 #endif
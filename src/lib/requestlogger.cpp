@@ -0,0 +1,31 @@
+#include "requestlogger.h"
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <fmt/format.h>
+
+const size_t RequestLogger::QUEUE_SIZE = 8192;
+
+RequestLogger *RequestLogger::Shared = nullptr;
+std::mutex RequestLogger::SharedLock;
+
+RequestLogger * RequestLogger::shared()
+{
+    std::unique_lock<std::mutex> lock(SharedLock);
+    if (Shared == nullptr)
+        Shared = new RequestLogger();
+
+    return Shared;
+}
+
+RequestLogger::RequestLogger()
+{
+    spdlog::init_thread_pool(QUEUE_SIZE, 1);
+    // registered once so that it picks up the global level and pattern
+    this->logger = spdlog::create_async_nb<spdlog::sinks::stderr_sink_mt>("requests");
+}
+
+std::shared_ptr<spdlog::logger> RequestLogger::get(const std::string &context, const std::string &requestId)
+{
+    return this->logger->clone(fmt::format("{0}/{1}", context, requestId));
+}
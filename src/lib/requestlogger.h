@@ -0,0 +1,67 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __REQUESTLOGGER_H__
+#define __REQUESTLOGGER_H__
+
+#include <spdlog/spdlog.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Process wide asynchronous logger for per request components.
+ *
+ * Messages are formatted on the calling thread and written to stderr by a
+ * single background thread through a bounded queue. When the queue is full
+ * the oldest messages are dropped so request threads never block on logging.
+ *
+ * Request loggers are unregistered copies of the shared logger named after
+ * their context and request ID. Creating one takes no global lock, and it is
+ * released together with its owner.
+ */
+class RequestLogger
+{
+public:
+    /**
+     * Get the shared logger instance.
+     *
+     * \return shared logger.
+     */
+    static RequestLogger * shared();
+
+    /**
+     * Get a logger for a request.
+     *
+     * \param context name of the component logging, e.g. "dynamicpipeline".
+     * \param requestId request ID included with every message.
+     * \return new logger.
+     */
+    std::shared_ptr<spdlog::logger> get(const std::string &context, const std::string &requestId);
+
+private:
+    static const size_t QUEUE_SIZE;
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    RequestLogger();
+
+    static RequestLogger *Shared;
+    static std::mutex SharedLock;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "asynccancelimpl.h"
+
+#include <fmt/format.h>
+
+namespace gst_transformer {
+namespace service {
+
+AsyncCancelImpl::AsyncCancelImpl(const AsyncCallResources *resources)
+    : responder(&this->serverContext)
+{
+    this->resources = resources;
+
+    this->requestFunction = [&] (bool ok) {
+        if (!ok) {
+            this->resources->globalLogger->debug("AsyncCancelImpl requestFunction ok is false, quitting");
+            delete this;
+            return;
+        }
+
+        new AsyncCancelImpl(this->resources);
+
+        if (this->request.request_id().empty()) {
+            this->responder.FinishWithError(
+                ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "request ID not set"),
+                &this->finishFunction);
+            return;
+        }
+
+        this->resources->runloop->execute([this] {
+            auto cancelled = this->resources->streamRegistry->cancel(
+                this->request.request_id(),
+                this->request.session_id(),
+                "cancelled by operator");
+            this->resources->globalLogger->info("cancelled {0} streams of request ID {1}", cancelled, this->request.request_id());
+            this->response.set_cancelled(cancelled);
+            this->responder.Finish(this->response, ::grpc::Status::OK, &this->finishFunction);
+        });
+    };
+
+    this->finishFunction = [&] (bool ok) {
+        delete this;
+    };
+
+    this->resources->adminService->RequestCancel(
+        &this->serverContext,
+        &this->request,
+        &this->responder,
+        this->resources->adminCompletionQueue,
+        this->resources->adminCompletionQueue,
+        &this->requestFunction);
+}
+
+}
+}
@@ -0,0 +1,52 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCCANCELIMPL_H__
+#define __ASYNCCANCELIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <functional>
+
+#include "admin.grpc.pb.h"
+#include "asyncserviceimpl.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Cancel the streams of a call on behalf of an operator.
+ */
+class AsyncCancelImpl
+{
+public:
+    AsyncCancelImpl(const AsyncCallResources *resources);
+
+private:
+    const AsyncCallResources *resources;
+
+    ::grpc::ServerContext serverContext;
+    ::grpc::ServerAsyncResponseWriter<CancelResponse> responder;
+    CancelRequest request;
+    CancelResponse response;
+
+    std::function<void(bool)> requestFunction;
+    std::function<void(bool)> finishFunction;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,38 @@
+#include "asyncgetloadimpl.h"
+
+namespace gst_transformer {
+namespace service {
+
+AsyncGetLoadImpl::AsyncGetLoadImpl(const AsyncCallResources *resources)
+    : responder(&this->serverContext)
+{
+    this->resources = resources;
+
+    this->requestFunction = [&] (bool ok) {
+        if (!ok) {
+            this->resources->globalLogger->debug("AsyncGetLoadImpl requestFunction ok is false, quitting");
+            delete this;
+            return;
+        }
+
+        new AsyncGetLoadImpl(this->resources);
+
+        this->resources->loadTracker->getLoad(this->response);
+        this->responder.Finish(this->response, ::grpc::Status::OK, &this->finishFunction);
+    };
+
+    this->finishFunction = [&] (bool ok) {
+        delete this;
+    };
+
+    this->resources->service->RequestGetLoad(
+        &this->serverContext,
+        &this->request,
+        &this->responder,
+        this->resources->completionQueue,
+        this->resources->completionQueue,
+        &this->requestFunction);
+}
+
+}
+}
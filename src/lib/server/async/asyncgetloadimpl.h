@@ -0,0 +1,52 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCGETLOADIMPL_H__
+#define __ASYNCGETLOADIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <functional>
+
+#include "gsttransformer.grpc.pb.h"
+#include "asyncserviceimpl.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Serve the last aggregated load, without touching any pipeline.
+ */
+class AsyncGetLoadImpl
+{
+public:
+    AsyncGetLoadImpl(const AsyncCallResources *resources);
+
+private:
+    const AsyncCallResources *resources;
+
+    ::grpc::ServerContext serverContext;
+    ::grpc::ServerAsyncResponseWriter<LoadResponse> responder;
+    LoadRequest request;
+    LoadResponse response;
+
+    std::function<void(bool)> requestFunction;
+    std::function<void(bool)> finishFunction;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "asyncliststreamsimpl.h"
+
+namespace gst_transformer {
+namespace service {
+
+AsyncListStreamsImpl::AsyncListStreamsImpl(const AsyncCallResources *resources)
+    : responder(&this->serverContext)
+{
+    this->resources = resources;
+
+    this->requestFunction = [&] (bool ok) {
+        if (!ok) {
+            this->resources->globalLogger->debug("AsyncListStreamsImpl requestFunction ok is false, quitting");
+            delete this;
+            return;
+        }
+
+        new AsyncListStreamsImpl(this->resources);
+
+        // stream state is owned by the runloop
+        this->resources->runloop->execute([this] {
+            this->resources->streamRegistry->list(this->response);
+            this->responder.Finish(this->response, ::grpc::Status::OK, &this->finishFunction);
+        });
+    };
+
+    this->finishFunction = [&] (bool ok) {
+        delete this;
+    };
+
+    this->resources->adminService->RequestListStreams(
+        &this->serverContext,
+        &this->request,
+        &this->responder,
+        this->resources->adminCompletionQueue,
+        this->resources->adminCompletionQueue,
+        &this->requestFunction);
+}
+
+}
+}
@@ -0,0 +1,52 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCLISTSTREAMSIMPL_H__
+#define __ASYNCLISTSTREAMSIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <functional>
+
+#include "admin.grpc.pb.h"
+#include "asyncserviceimpl.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * List streams with running pipelines.
+ */
+class AsyncListStreamsImpl
+{
+public:
+    AsyncListStreamsImpl(const AsyncCallResources *resources);
+
+private:
+    const AsyncCallResources *resources;
+
+    ::grpc::ServerContext serverContext;
+    ::grpc::ServerAsyncResponseWriter<ListStreamsResponse> responder;
+    ListStreamsRequest request;
+    ListStreamsResponse response;
+
+    std::function<void(bool)> requestFunction;
+    std::function<void(bool)> finishFunction;
+};
+
+}
+}
+
+#endif
@@ -1,39 +1,230 @@
 #include "asyncserviceimpl.h"
 #include "asynctransformimpl.h"
+#include "asyncsessionsimpl.h"
+#include "asyncgetloadimpl.h"
+#include "asyncliststreamsimpl.h"
+#include "asynccancelimpl.h"
 #include <spdlog/sinks/stdout_sinks.h>
+#include <fmt/format.h>
 
 #include <functional>
 
 #include "../grunloop.h"
+#include "spillbuffer.h"
+#include "sharedtaskpool.h"
+#include "cpuaffinity.h"
+#include "ingestbufferpool.h"
 
 namespace gst_transformer {
 namespace service {
 
+const unsigned int AsyncServiceImpl::DEFAULT_PACING_TICK_MILLIS = 5;
+const unsigned int AsyncServiceImpl::DEFAULT_PACING_BURST_MILLIS = 100;
+const unsigned int AsyncServiceImpl::DEFAULT_MAX_IDLE_PIPELINES = 8;
+const unsigned int AsyncServiceImpl::DEFAULT_SETUP_THREADS = 4;
+const unsigned int AsyncServiceImpl::DEFAULT_MAX_PENDING_SETUPS = 256;
+const unsigned int AsyncServiceImpl::DEFAULT_TEARDOWN_THREADS = 2;
+const unsigned int AsyncServiceImpl::DEFAULT_TEARDOWN_TIMEOUT_MILLIS = 5000;
+const unsigned int AsyncServiceImpl::DEFAULT_LOAD_SAMPLE_MILLIS = 1000;
+
 AsyncServiceImpl::AsyncServiceImpl(
     GstTransformer::AsyncService *service,
+    GstTransformerAdmin::AsyncService *adminService,
     ::grpc::ServerCompletionQueue *completionQueue,
+    ::grpc::ServerCompletionQueue *adminCompletionQueue,
     const ServiceParametersStruct &params)
 {
     this->globalLogger = spdlog::stderr_logger_mt("asyncserviceimpl");
 
     this->service = service;
+    this->adminService = adminService;
     this->completionQueue = std::move(completionQueue);
+    this->adminCompletionQueue = adminCompletionQueue;
     this->params = params;
+
+    SpillBuffer::setTotalQuota(this->params.max_total_spill_bytes());
+    if (this->params.shared_task_pool())
+        SharedTaskPool::shared()->setMaxThreads(this->params.max_task_pool_threads());
+    if (this->params.pooled_input_buffers())
+        IngestBufferPool::shared()->configure(this->params.input_pool_max_bytes(), this->params.input_pool_huge_pages());
+
+    if (this->params.centralized_pacing()) {
+        this->pacingScheduler.reset(new PacingScheduler(
+            this->params.pacing_tick_millis() ? this->params.pacing_tick_millis() : DEFAULT_PACING_TICK_MILLIS,
+            this->params.pacing_burst_millis() ? this->params.pacing_burst_millis() : DEFAULT_PACING_BURST_MILLIS));
+    }
+
+    if (!this->params.control_cpus().empty()) {
+        this->controlCpus = CpuAffinity::parseCpuList(this->params.control_cpus());
+        auto cpus = this->controlCpus;
+        auto logger = this->globalLogger;
+        GRunLoop::main()->execute([cpus, logger] {
+            if (!CpuAffinity::setThreadAffinity(cpus))
+                logger->warn("unable to set runloop thread affinity");
+        });
+    }
+    if (!this->controlCpus.empty() || this->params.numa_sharding())
+        this->numaPlacement.reset(new NumaPlacement(this->controlCpus, this->params.numa_sharding()));
+
+    if (!this->params.capture_path().empty()) {
+        this->trafficCapture.reset(new TrafficCapture(
+            this->globalLogger,
+            this->params.capture_path(),
+            this->params.capture_sample_rate(),
+            this->params.capture_sizes_only()));
+    }
+
+    if (this->params.worker_processes()) {
+        this->workerPool.reset(new WorkerPool(
+            this->globalLogger,
+            ForkServer::shared(),
+            this->params.worker_processes(),
+            this->params.max_worker_calls()));
+    }
+
+    // workers keep their own pools
+    for(auto &pipeline : this->params.pipelines()) {
+        if (!this->workerPool && pipeline.second.reusable()) {
+            this->pipelinePool.reset(new PipelinePool(
+                this->params.max_idle_pipelines() ? this->params.max_idle_pipelines() : DEFAULT_MAX_IDLE_PIPELINES));
+            break;
+        }
+    }
+
+    this->setupPool.reset(new SetupPool(
+        this->params.setup_threads() ? this->params.setup_threads() : DEFAULT_SETUP_THREADS,
+        this->params.max_pending_setups() ? this->params.max_pending_setups() : DEFAULT_MAX_PENDING_SETUPS));
+    this->reaperPool.reset(new ReaperPool(
+        this->params.teardown_threads() ? this->params.teardown_threads() : DEFAULT_TEARDOWN_THREADS,
+        this->params.teardown_timeout_millis() ? this->params.teardown_timeout_millis() : DEFAULT_TEARDOWN_TIMEOUT_MILLIS));
+
+    this->loadTracker.reset(new LoadTracker(
+        this->params.load_sample_millis() ? this->params.load_sample_millis() : DEFAULT_LOAD_SAMPLE_MILLIS,
+        this->params.max_load_streams()));
+    if (this->workerPool) {
+        auto workerPool = this->workerPool.get();
+        this->loadTracker->setChildProcesses([workerPool] {
+            return workerPool->getProcessIds();
+        });
+    }
+    this->loadTracker->start();
+
+    this->resources.globalLogger = this->globalLogger;
+    this->resources.runloop = GRunLoop::main();
+    this->resources.pacingScheduler = this->pacingScheduler.get();
+    this->resources.numaPlacement = this->numaPlacement.get();
+    this->resources.trafficCapture = this->trafficCapture.get();
+    this->resources.pipelinePool = this->pipelinePool.get();
+    this->resources.setupPool = this->setupPool.get();
+    this->resources.reaperPool = this->reaperPool.get();
+    this->resources.workerPool = this->workerPool.get();
+    this->resources.loadTracker = this->loadTracker.get();
+    this->resources.streamRegistry = &this->streamRegistry;
+    this->resources.service = this->service;
+    this->resources.adminService = this->adminService;
+    this->resources.completionQueue = this->completionQueue;
+    this->resources.adminCompletionQueue = this->adminCompletionQueue;
+    this->resources.params = &this->params;
+
+    if (this->params.stats_interval_millis()) {
+        this->statsReporter.reset(new StatsReporter(this->globalLogger, this->params.stats_interval_millis()));
+        this->statsReporter->addSource("spill", [] {
+            return fmt::format("usedBytes: {0}", SpillBuffer::getTotalUsedBytes());
+        });
+        auto setupPool = this->setupPool.get();
+        this->statsReporter->addSource("setup", [setupPool] {
+            return setupPool->debugString();
+        });
+        auto reaperPool = this->reaperPool.get();
+        this->statsReporter->addSource("teardown", [reaperPool] {
+            return reaperPool->debugString();
+        });
+        auto loadTracker = this->loadTracker.get();
+        this->statsReporter->addSource("load", [loadTracker] {
+            return loadTracker->debugString();
+        });
+        if (this->workerPool) {
+            auto workerPool = this->workerPool.get();
+            this->statsReporter->addSource("workers", [workerPool] {
+                return workerPool->debugString();
+            });
+        }
+        if (this->params.shared_task_pool()) {
+            this->statsReporter->addSource("taskpool", [] {
+                auto pool = SharedTaskPool::shared();
+                return fmt::format("threads: {0}, busy: {1}, queued: {2}, maxThreads: {3}",
+                    pool->getThreadCount(),
+                    pool->getBusyThreadCount(),
+                    pool->getQueueDepth(),
+                    pool->getMaxThreads());
+            });
+        }
+        if (this->params.pooled_input_buffers()) {
+            this->statsReporter->addSource("inputpool", [] {
+                return IngestBufferPool::shared()->debugString();
+            });
+        }
+        if (this->numaPlacement) {
+            auto placement = this->numaPlacement.get();
+            auto controlCpus = CpuAffinity::formatCpuList(this->controlCpus);
+            this->statsReporter->addSource("placement", [placement, controlCpus] {
+                return fmt::format("control cpus {0}, {1}", controlCpus, placement->debugString());
+            });
+        }
+        if (this->trafficCapture) {
+            auto capture = this->trafficCapture.get();
+            this->statsReporter->addSource("capture", [capture] {
+                return capture->debugString();
+            });
+        }
+        if (this->pipelinePool) {
+            auto pool = this->pipelinePool.get();
+            this->statsReporter->addSource("pipelinepool", [pool] {
+                return pool->debugString();
+            });
+        }
+        this->statsReporter->start();
+    }
 }
 
 AsyncServiceImpl::~AsyncServiceImpl()
 {
+    if (this->adminThread.joinable())
+        this->adminThread.join();
 }
 
 void AsyncServiceImpl::start()
 {
-    new AsyncTransformImpl(this->globalLogger, GRunLoop::main(), service, completionQueue, &this->params);
+    // completion queue is driven from the calling thread
+    if (!this->controlCpus.empty() && !CpuAffinity::setThreadAffinity(this->controlCpus))
+        this->globalLogger->warn("unable to set completion queue thread affinity");
+
+    new AsyncTransformImpl(&this->resources);
+    new AsyncSessionsImpl(&this->resources);
+    new AsyncGetLoadImpl(&this->resources);
+    if (this->adminService) {
+        new AsyncListStreamsImpl(&this->resources);
+        new AsyncCancelImpl(&this->resources);
+        this->adminThread = std::thread(&AsyncServiceImpl::runCompletionQueue, this->adminCompletionQueue);
+    }
+
+    runCompletionQueue(this->completionQueue);
+}
+
+void AsyncServiceImpl::stop()
+{
+    this->completionQueue->Shutdown();
+    if (this->adminService)
+        this->adminCompletionQueue->Shutdown();
+}
 
+void AsyncServiceImpl::runCompletionQueue(::grpc::ServerCompletionQueue *completionQueue)
+{
     void* tag;
     bool ok;
     bool shutdown = false;
     while (!shutdown) {
-        shutdown = !this->completionQueue->Next(&tag, &ok);
+        shutdown = !completionQueue->Next(&tag, &ok);
         if (!shutdown) {
             auto func = *static_cast<std::function<void(bool)>*>(tag);
             func(ok);
@@ -41,10 +232,5 @@ void AsyncServiceImpl::start()
     }
 }
 
-void AsyncServiceImpl::stop()
-{
-    this->completionQueue->Shutdown();
-}
-
 }
 }
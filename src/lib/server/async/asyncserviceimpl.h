@@ -18,19 +18,67 @@ all copies or substantial portions of the Software.
 #define __ASYNCSERVICEIMPL_H__
 
 #include <spdlog/spdlog.h>
+#include <thread>
 
 #include "serviceparameters.pb.h"
 #include "gsttransformer.grpc.pb.h"
+#include "admin.grpc.pb.h"
+#include "../pacingscheduler.h"
+#include "../statsreporter.h"
+#include "../numaplacement.h"
+#include "../trafficcapture.h"
+#include "../pipelinepool.h"
+#include "../setuppool.h"
+#include "../reaperpool.h"
+#include "../worker/workerpool.h"
+#include "../loadtracker.h"
+#include "../streamregistry.h"
+#include "../grunloop.h"
 
 namespace gst_transformer {
 namespace service {
 
+/**
+ * Server wide objects shared by all calls.
+ */
+struct AsyncCallResources
+{
+    std::shared_ptr<spdlog::logger> globalLogger;
+    GRunLoop *runloop;
+    PacingScheduler *pacingScheduler;
+    NumaPlacement *numaPlacement;
+    TrafficCapture *trafficCapture;
+    PipelinePool *pipelinePool;
+    SetupPool *setupPool;
+    ReaperPool *reaperPool;
+    WorkerPool *workerPool;
+    LoadTracker *loadTracker;
+    StreamRegistry *streamRegistry;
+    GstTransformer::AsyncService *service;
+    GstTransformerAdmin::AsyncService *adminService;
+    ::grpc::ServerCompletionQueue *completionQueue;
+    ::grpc::ServerCompletionQueue *adminCompletionQueue;
+    const ServiceParametersStruct *params;
+};
+
 class AsyncServiceImpl
 {
 public:
+    /**
+     * Construct a new service.
+     *
+     * \param service service to serve calls of.
+     * \param adminService admin service to serve calls of, nullptr to not serve it.
+     * \param completionQueue completion queue of the service.
+     * \param adminCompletionQueue completion queue of the admin service, usually
+     * of a separate server on a private listen address.
+     * \param params service parameters.
+     */
     AsyncServiceImpl(
         GstTransformer::AsyncService *service,
+        GstTransformerAdmin::AsyncService *adminService,
         ::grpc::ServerCompletionQueue *completionQueue,
+        ::grpc::ServerCompletionQueue *adminCompletionQueue,
         const ServiceParametersStruct &params);
     ~AsyncServiceImpl();
 
@@ -38,10 +86,37 @@ public:
     void stop();
 
 private:
+    static const unsigned int DEFAULT_PACING_TICK_MILLIS;
+    static const unsigned int DEFAULT_PACING_BURST_MILLIS;
+    static const unsigned int DEFAULT_MAX_IDLE_PIPELINES;
+    static const unsigned int DEFAULT_SETUP_THREADS;
+    static const unsigned int DEFAULT_MAX_PENDING_SETUPS;
+    static const unsigned int DEFAULT_TEARDOWN_THREADS;
+    static const unsigned int DEFAULT_TEARDOWN_TIMEOUT_MILLIS;
+    static const unsigned int DEFAULT_LOAD_SAMPLE_MILLIS;
+
     std::shared_ptr<spdlog::logger> globalLogger;
     GstTransformer::AsyncService *service;
+    GstTransformerAdmin::AsyncService *adminService;
     ::grpc::ServerCompletionQueue *completionQueue;
+    ::grpc::ServerCompletionQueue *adminCompletionQueue;
+    // drives the admin completion queue
+    std::thread adminThread;
     ServiceParametersStruct params;
+    std::unique_ptr<PacingScheduler> pacingScheduler;
+    std::unique_ptr<StatsReporter> statsReporter;
+    std::vector<int> controlCpus;
+    std::unique_ptr<NumaPlacement> numaPlacement;
+    std::unique_ptr<TrafficCapture> trafficCapture;
+    std::unique_ptr<PipelinePool> pipelinePool;
+    std::unique_ptr<SetupPool> setupPool;
+    std::unique_ptr<ReaperPool> reaperPool;
+    std::unique_ptr<WorkerPool> workerPool;
+    std::unique_ptr<LoadTracker> loadTracker;
+    StreamRegistry streamRegistry;
+    AsyncCallResources resources;
+
+    static void runCompletionQueue(::grpc::ServerCompletionQueue *completionQueue);
 };
 
 }
@@ -0,0 +1,666 @@
+#include "asyncsessionsimpl.h"
+#include "asynctransformimpl.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "requestlogger.h"
+
+namespace gst_transformer {
+namespace service {
+
+const unsigned int AsyncSessionsImpl::MAX_RESPONSE_BYTES = 1024 * 1024;
+const unsigned int AsyncSessionsImpl::MAX_PULL_SAMPLES = 64;
+const unsigned int AsyncSessionsImpl::MAX_QUEUED_BYTES = 4 * 1024 * 1024;
+
+AsyncSessionsImpl::AsyncSessionsImpl(const AsyncCallResources *resources)
+    : responder(&this->serverContext), factory(*resources->params, resources->pipelinePool, resources->workerPool)
+{
+    this->resources = resources;
+    this->runloop = resources->runloop;
+    this->logger = nullptr;
+    this->blockedSessions = 0;
+    this->pendingSetups = 0;
+    this->pendingTeardowns = 0;
+    this->reading = false;
+    this->readsDone = false;
+    this->queuedBytes = 0;
+    this->writingBytes = 0;
+    this->writing = false;
+    this->failed = false;
+    this->finishing = false;
+    this->finished = false;
+    this->done = false;
+
+    this->requestFunction = [&] (bool ok) {
+        if (!ok) {
+            this->resources->globalLogger->debug("AsyncSessionsImpl requestFunction ok is false, quitting");
+            delete this;
+            return;
+        }
+
+        new AsyncSessionsImpl(this->resources);
+
+        auto metadata = this->serverContext.client_metadata();
+        auto iterator = metadata.find(ClientMetadata_Name(ClientMetadata::requestid));
+        if (iterator == metadata.end()) {
+            auto message = fmt::format("request ID not set: {0}", ClientMetadata_Name(ClientMetadata::requestid));
+            this->resources->globalLogger->warn(message);
+
+            this->finishing = true;
+            this->responder.Finish(
+                ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, message),
+                &this->finishFunction);
+            return;
+        }
+
+        this->requestId = std::string(iterator->second.data(), iterator->second.size());
+        this->resources->globalLogger->debug("sessions request ID {0}", requestId);
+        // one logger for all sessions of the call
+        this->logger = RequestLogger::shared()->get("asyncserviceimpl.TransformSessions", requestId);
+
+        this->runloop->execute([=] {
+            this->readNext();
+        });
+    };
+
+    this->readDoneFunction = [&] (bool ok) {
+        this->runloop->execute([=] {
+            this->reading = false;
+            if (this->finished) {
+                this->deleteIfFinished();
+                return;
+            }
+
+            if (ok) {
+                if (!this->failed) {
+                    this->handleRequest();
+                    this->request.Clear();
+                    this->readNext();
+                }
+            }
+            else {
+                SPDLOG_LOGGER_TRACE(this->logger, "client finished sending, ending input of {0} sessions", this->sessions.size());
+                this->readsDone = true;
+                for(auto &entry : this->sessions) {
+                    if (!entry.second->inputEnded) {
+                        entry.second->inputEnded = true;
+                        entry.second->pipeline->endData();
+                    }
+                }
+                this->finishIfDone();
+            }
+        });
+    };
+
+    this->writeDoneFunction = [&] (bool ok) {
+        this->runloop->execute([=] {
+            this->writing = false;
+            this->queuedBytes -= this->writingBytes;
+            this->writingBytes = 0;
+            if (!ok) {
+                this->fail(::grpc::Status(::grpc::StatusCode::CANCELLED, "write failed"));
+                this->finishIfDone();
+                return;
+            }
+
+            this->writeNext();
+            this->resumeSessions();
+            this->finishIfDone();
+        });
+    };
+
+    this->finishFunction = [&] (bool ok) {
+        this->runloop->execute([=] {
+            (this->logger ? this->logger : this->resources->globalLogger)->debug("sessions call finished, ok: {0}", ok);
+            this->finished = true;
+            this->deleteIfFinished();
+        });
+    };
+
+    this->doneFunction = [&] (bool ok) {
+        this->runloop->execute([=] {
+            this->done = true;
+            // stops all pipelines right away, nobody is left to read their output
+            if (this->serverContext.IsCancelled() && !this->finishing)
+                this->fail(::grpc::Status(::grpc::StatusCode::CANCELLED, "call cancelled by client or deadline"));
+            this->deleteIfFinished();
+        });
+    };
+
+    this->serverContext.AsyncNotifyWhenDone(&this->doneFunction);
+    SPDLOG_LOGGER_TRACE(this->resources->globalLogger, "RequestTransformSessions");
+    this->resources->service->RequestTransformSessions(
+        &this->serverContext,
+        &this->responder,
+        this->resources->completionQueue,
+        this->resources->completionQueue,
+        &this->requestFunction);
+}
+
+AsyncSessionsImpl::~AsyncSessionsImpl()
+{
+    (this->logger ? this->logger : this->resources->globalLogger)->trace("AsyncSessionsImpl destructor called");
+
+    for(auto &entry : this->sessions) {
+        if (entry.second->pacingId)
+            this->resources->pacingScheduler->removeStream(entry.second->pacingId);
+    }
+}
+
+void AsyncSessionsImpl::handleRequest()
+{
+    auto id = this->request.session_id();
+    auto iterator = this->sessions.find(id);
+    std::shared_ptr<Session> session = iterator != this->sessions.end() ? iterator->second : nullptr;
+
+    switch (this->request.request_case()) {
+        case SessionRequest::kConfig:
+            if (session) {
+                this->fail(::grpc::Status(
+                    ::grpc::StatusCode::INVALID_ARGUMENT,
+                    fmt::format("session {0} is already active", id)));
+                return;
+            }
+            this->startSession(id, this->request.config());
+            break;
+
+        case SessionRequest::kPayload:
+            // session may have terminated before the client noticed
+            if (!session || session->inputEnded) {
+                SPDLOG_LOGGER_TRACE(this->logger, "session {0}: payload for inactive session ignored", id);
+                break;
+            }
+            for(auto &data : this->request.payload().data()) {
+                if (session->capture)
+                    session->capture->payload(data);
+                if (session->pipeline->addData(data.data(), data.size()) == -1) {
+                    this->logger->warn("session {0}: pipeline returned error adding data", id);
+                    break;
+                }
+            }
+            break;
+
+        case SessionRequest::kEndOfInput:
+            if (session && !session->inputEnded) {
+                SPDLOG_LOGGER_TRACE(this->logger, "session {0}: ending data stream", id);
+                session->inputEnded = true;
+                session->pipeline->endData();
+            }
+            break;
+
+        case SessionRequest::kCancel:
+            if (session) {
+                this->logger->debug("session {0}: cancelled by client", id);
+                session->pipeline->stop();
+                this->terminateSession(session);
+            }
+            break;
+
+        default:
+            this->fail(::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "empty session request"));
+            break;
+    }
+}
+
+void AsyncSessionsImpl::startSession(unsigned long id, const TransformConfig &config)
+{
+    auto session = std::make_shared<Session>();
+    session->id = id;
+    session->config = config;
+    session->pacingId = 0;
+    session->samplesAvailable = 0;
+    session->enoughData = false;
+    session->inputEnded = false;
+    session->eos = false;
+    session->terminating = false;
+    session->settingUp = false;
+    session->bufferedSize = 0;
+
+    this->logger->debug("session {0}: config {1}", id, config.ShortDebugString());
+    try {
+        AsyncTransformImpl::validateConfig(this->resources->params, session->config);
+    }
+    catch(std::exception &e) {
+        auto message = fmt::format("invalid config: {0}", e.what());
+        this->logger->warn("session {0}: {1}", id, message);
+        this->completeSession(session, TerminationReason::REJECTED, message);
+        return;
+    }
+
+    // sessions share the deadline of the call
+    std::string deadlineMessage;
+    if (!AsyncTransformImpl::checkDeadline(this->resources->setupPool, this->serverContext, session->config, deadlineMessage)) {
+        this->logger->warn("session {0}: {1}", id, deadlineMessage);
+        this->completeSession(session, TerminationReason::REJECTED, deadlineMessage);
+        return;
+    }
+
+    // pipeline construction and state changes may block, keep them off the runloop.
+    // reading stops until the session is attached.
+    auto pipelineId = fmt::format("{0}/{1}", this->requestId, id);
+    session->load = this->resources->loadTracker->begin(session->config.pipeline_name());
+    this->pendingSetups++;
+    session->settingUp = true;
+    auto setupStartTime = std::chrono::steady_clock::now();
+    auto queued = this->resources->setupPool->submit([this, session, pipelineId, setupStartTime] {
+        std::string error;
+        try {
+            if (this->resources->numaPlacement)
+                session->placement = this->resources->numaPlacement->acquire();
+            session->pipeline = this->factory.get(pipelineId, session->config, session->placement.get());
+            if (this->resources->trafficCapture)
+                session->capture = this->resources->trafficCapture->begin(pipelineId, session->config);
+            this->setupSession(session);
+            this->resources->setupPool->recordSetupTime(
+                session->config.pipeline_name(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStartTime).count());
+        }
+        catch(std::exception &e) {
+            error = e.what();
+        }
+
+        this->runloop->execute([this, session, error] {
+            this->attachSession(session, error);
+        });
+    });
+    if (!queued) {
+        this->pendingSetups--;
+        session->settingUp = false;
+        auto message = "too many pending pipeline setups";
+        this->logger->warn("session {0}: {1}", id, message);
+        this->completeSession(session, TerminationReason::REJECTED, message);
+    }
+}
+
+void AsyncSessionsImpl::setupSession(const std::shared_ptr<Session> &session)
+{
+    // callbacks queued on the runloop may outlive the session
+    std::weak_ptr<Session> weakSession = session;
+
+    session->pipeline->setSampleAvailableCallback([this, weakSession] {
+        this->runloop->execute([this, weakSession] {
+            auto session = weakSession.lock();
+            if (!session)
+                return;
+            session->samplesAvailable++;
+            this->pullSamples(session);
+        });
+    });
+
+    auto rate = session->config.pipeline_parameters().rate() ? session->config.pipeline_parameters().rate() : 1.0;
+    if (this->resources->pacingScheduler && rate > 0) {
+        session->pacingId = this->resources->pacingScheduler->addStream(rate, [this, weakSession] {
+            this->runloop->execute([this, weakSession] {
+                auto session = weakSession.lock();
+                if (!session)
+                    return;
+                if (session->eos)
+                    this->finalizeSession(session);
+                else
+                    this->pullSamples(session);
+            });
+        });
+    }
+
+    session->pipeline->setEnoughDataCallback([this, weakSession] {
+        this->runloop->execute([this, weakSession] {
+            auto session = weakSession.lock();
+            if (!session || session->enoughData)
+                return;
+            session->enoughData = true;
+            this->blockedSessions++;
+        });
+    });
+
+    session->pipeline->setNeedDataCallback([this, weakSession] {
+        this->runloop->execute([this, weakSession] {
+            auto session = weakSession.lock();
+            if (!session || !session->enoughData)
+                return;
+            session->enoughData = false;
+            this->blockedSessions--;
+            this->readNext();
+        });
+    });
+
+    session->pipeline->setEOSCallback([this, weakSession] {
+        this->runloop->execute([this, weakSession] {
+            auto session = weakSession.lock();
+            if (!session)
+                return;
+            this->logger->debug("session {0}: got EOS from pipeline", session->id);
+            session->eos = true;
+            this->finalizeSession(session);
+        });
+    });
+
+    session->pipeline->start([this, weakSession] (bool force) {
+        if (!force)
+            return;
+        this->runloop->execute([this, weakSession] {
+            auto session = weakSession.lock();
+            if (!session)
+                return;
+            SPDLOG_LOGGER_TRACE(this->logger, "session {0}: error callback invoked", session->id);
+            this->terminateSession(session);
+        });
+    });
+}
+
+void AsyncSessionsImpl::attachSession(const std::shared_ptr<Session> &session, const std::string &error)
+{
+    this->pendingSetups--;
+    session->settingUp = false;
+    // call is already finishing, the session is dropped with its pipeline
+    if (this->finished || this->failed) {
+        if (session->pacingId) {
+            this->resources->pacingScheduler->removeStream(session->pacingId);
+            session->pacingId = 0;
+        }
+        session->terminating = true;
+        this->reapSession(session);
+        this->deleteIfFinished();
+        return;
+    }
+
+    if (!error.empty()) {
+        auto message = fmt::format("cannot create pipeline: {0}", error);
+        this->logger->warn("session {0}: {1}", session->id, message);
+        this->completeSession(session, TerminationReason::REJECTED, message);
+        return;
+    }
+
+    // pipeline failed while starting and the session already completed
+    if (session->terminating) {
+        this->reapSession(session);
+        // reads were paused while the setup was pending
+        this->readNext();
+        this->finishIfDone();
+        return;
+    }
+
+    this->sessions[session->id] = session;
+    std::weak_ptr<Session> weakSession = session;
+    session->registration = this->resources->streamRegistry->add(
+        this->requestId,
+        session->id,
+        session->config.pipeline_name(),
+        [this, weakSession] (ActiveStream &stream) {
+            StreamRegistry::describePipeline(*weakSession.lock()->pipeline, stream);
+            if (this->writing) {
+                stream.set_write_stall_millis(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - this->writeStartTime).count());
+            }
+        },
+        [this, weakSession] (const std::string &message) {
+            this->cancelSession(weakSession.lock(), message);
+        });
+    this->readNext();
+}
+
+void AsyncSessionsImpl::pullSamples(const std::shared_ptr<Session> &session)
+{
+    if (session->terminating)
+        return;
+
+    auto pacingScheduler = this->resources->pacingScheduler;
+    auto limit = std::max(session->config.pipeline_output_buffer(), MAX_RESPONSE_BYTES);
+    while (session->samplesAvailable > 0 && session->bufferedSize <= limit && this->queuedBytes < MAX_QUEUED_BYTES) {
+        double until = -1;
+        if (session->pacingId)
+            until = pacingScheduler->getAllowance(session->pacingId);
+
+        double endTime;
+        auto samples = session->pipeline->getPendingSample(MAX_PULL_SAMPLES, until, endTime);
+        for(auto &sample : samples) {
+            if (session->capture)
+                session->capture->output(sample);
+            session->bufferedSize += sample.length();
+            session->response.mutable_payload()->add_data(std::move(sample));
+        }
+        if (!samples.empty())
+            session->load->progress(session->pipeline->getProcessedTime());
+        if (session->pacingId && !samples.empty())
+            pacingScheduler->consume(session->pacingId, endTime);
+
+        auto heldBack = false;
+        if (samples.size() < MAX_PULL_SAMPLES) {
+            auto nextTime = session->pacingId ? session->pipeline->getNextSampleTime() : -1;
+            if (nextTime >= 0) {
+                pacingScheduler->schedule(session->pacingId, nextTime);
+                heldBack = true;
+            }
+            else {
+                session->samplesAvailable = 0;
+            }
+        }
+        else {
+            session->samplesAvailable = std::max(session->samplesAvailable - (int)samples.size(), 1);
+        }
+
+        if (session->bufferedSize > session->config.pipeline_output_buffer()) {
+            this->enqueue(session->id, session->response);
+            session->bufferedSize = 0;
+        }
+        if (heldBack)
+            break;
+    }
+}
+
+void AsyncSessionsImpl::finalizeSession(const std::shared_ptr<Session> &session)
+{
+    if (session->terminating)
+        return;
+
+    if (session->samplesAvailable > 0) {
+        this->pullSamples(session);
+        // waiting for write queue space or paced output to be released
+        if (session->samplesAvailable > 0)
+            return;
+    }
+
+    if (session->response.payload().data_size() > 0) {
+        this->enqueue(session->id, session->response);
+        session->bufferedSize = 0;
+    }
+    this->completeSession(
+        session,
+        (TerminationReason)session->pipeline->getTerminationReason(),
+        session->pipeline->getTerminationMessage());
+}
+
+void AsyncSessionsImpl::terminateSession(const std::shared_ptr<Session> &session)
+{
+    if (session->terminating)
+        return;
+
+    session->terminating = true;
+    session->response.Clear();
+    session->bufferedSize = 0;
+    this->completeSession(
+        session,
+        (TerminationReason)session->pipeline->getTerminationReason(),
+        session->pipeline->getTerminationMessage());
+}
+
+void AsyncSessionsImpl::completeSession(const std::shared_ptr<Session> &session, TerminationReason reason, const std::string &message)
+{
+    SessionResponse response;
+    auto completion = response.mutable_transform_completed();
+    completion->set_termination_reason(reason);
+    completion->set_termination_message(message);
+    if (session->pipeline) {
+        completion->set_processed_input_bytes(session->pipeline->getProcessedInputBytes());
+        completion->set_processed_output_bytes(session->pipeline->getProcessedOutputBytes());
+        completion->set_processed_time(session->pipeline->getProcessedTime());
+    }
+    if (session->capture)
+        session->capture->completed(reason, completion->processed_time());
+    this->logger->debug("session {0}: completed {1}", session->id, TerminationReason_Name(reason));
+
+    this->enqueue(session->id, response);
+    this->removeSession(session);
+}
+
+void AsyncSessionsImpl::cancelSession(const std::shared_ptr<Session> &session, const std::string &message)
+{
+    if (session->terminating)
+        return;
+
+    this->logger->info("session {0}: cancelling: {1}", session->id, message);
+    session->pipeline->stop();
+    session->terminating = true;
+    session->response.Clear();
+    session->bufferedSize = 0;
+    this->completeSession(session, TerminationReason::CANCELLED, message);
+}
+
+void AsyncSessionsImpl::removeSession(const std::shared_ptr<Session> &session)
+{
+    auto removed = session;
+    removed->terminating = true;
+    removed->load.reset();
+    removed->registration.reset();
+    // still used by its setup thread, reaped once attached
+    if (!removed->settingUp)
+        this->reapSession(removed);
+    if (removed->pacingId) {
+        this->resources->pacingScheduler->removeStream(removed->pacingId);
+        removed->pacingId = 0;
+    }
+    if (removed->enoughData) {
+        removed->enoughData = false;
+        this->blockedSessions--;
+    }
+
+    auto iterator = this->sessions.find(removed->id);
+    if (iterator != this->sessions.end() && iterator->second == removed)
+        this->sessions.erase(iterator);
+
+    this->readNext();
+    this->finishIfDone();
+}
+
+void AsyncSessionsImpl::reapSession(const std::shared_ptr<Session> &session)
+{
+    if (!session->pipeline)
+        return;
+
+    // stopping a pipeline may block, tear it down on the reaper pool. its callbacks
+    // reference this call, which is kept until the teardown completes.
+    std::shared_ptr<Pipeline> pipeline(std::move(session->pipeline));
+    std::shared_ptr<NumaPlacement::Lease> placement(std::move(session->placement));
+    this->pendingTeardowns++;
+    this->resources->reaperPool->submit([this, pipeline, placement] () mutable {
+        pipeline.reset();
+        placement.reset();
+        this->runloop->execute([this] {
+            this->pendingTeardowns--;
+            this->deleteIfFinished();
+        });
+    });
+}
+
+void AsyncSessionsImpl::deleteIfFinished()
+{
+    if (this->finished && this->done && !this->reading && !this->pendingSetups && !this->pendingTeardowns)
+        delete this;
+}
+
+void AsyncSessionsImpl::resumeSessions()
+{
+    std::vector<std::shared_ptr<Session>> ready;
+    for(auto &entry : this->sessions) {
+        if (entry.second->samplesAvailable > 0)
+            ready.push_back(entry.second);
+    }
+
+    for(auto &session : ready) {
+        if (this->queuedBytes >= MAX_QUEUED_BYTES)
+            break;
+        if (session->eos)
+            this->finalizeSession(session);
+        else
+            this->pullSamples(session);
+    }
+}
+
+void AsyncSessionsImpl::enqueue(unsigned long sessionId, SessionResponse &response)
+{
+    response.set_session_id(sessionId);
+    this->queuedBytes += response.ByteSizeLong();
+    this->writeQueue.push_back(SessionResponse());
+    // leaves response empty for reuse
+    this->writeQueue.back().Swap(&response);
+    this->writeNext();
+}
+
+void AsyncSessionsImpl::writeNext()
+{
+    if (this->writing || this->writeQueue.empty() || this->finishing)
+        return;
+
+    auto &response = this->writeQueue.front();
+    this->writingBytes = response.ByteSizeLong();
+    this->writing = true;
+    this->writeStartTime = std::chrono::steady_clock::now();
+    this->responder.Write(response, &this->writeDoneFunction);
+    this->writeQueue.pop_front();
+}
+
+void AsyncSessionsImpl::readNext()
+{
+    if (this->reading || this->readsDone || this->failed || this->finishing || this->blockedSessions > 0 || this->pendingSetups > 0)
+        return;
+
+    this->reading = true;
+    this->responder.Read(&this->request, &this->readDoneFunction);
+}
+
+void AsyncSessionsImpl::fail(const ::grpc::Status &status)
+{
+    if (this->failed)
+        return;
+
+    this->logger->warn("failing sessions call: {0}", status.error_message());
+    this->failed = true;
+    this->failedStatus = status;
+    for(auto &entry : this->sessions) {
+        if (entry.second->pacingId) {
+            this->resources->pacingScheduler->removeStream(entry.second->pacingId);
+            entry.second->pacingId = 0;
+        }
+        entry.second->terminating = true;
+        entry.second->registration.reset();
+        this->reapSession(entry.second);
+    }
+    this->sessions.clear();
+    this->blockedSessions = 0;
+    this->writeQueue.clear();
+    this->queuedBytes = this->writingBytes;
+
+    this->finishIfDone();
+}
+
+void AsyncSessionsImpl::finishIfDone()
+{
+    if (this->finishing || this->writing)
+        return;
+
+    if (this->failed) {
+        this->finishing = true;
+        this->responder.Finish(this->failedStatus, &this->finishFunction);
+    }
+    else if (this->readsDone && this->sessions.empty() && this->writeQueue.empty() && !this->pendingSetups) {
+        SPDLOG_LOGGER_TRACE(this->logger, "all sessions completed, finishing");
+        this->finishing = true;
+        this->responder.Finish(::grpc::Status::OK, &this->finishFunction);
+    }
+}
+
+}
+}
@@ -0,0 +1,141 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCSESSIONSIMPL_H__
+#define __ASYNCSESSIONSIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+
+#include "serviceparameters.pb.h"
+#include "gsttransformer.grpc.pb.h"
+#include "asyncserviceimpl.h"
+#include "../serverpipelinefactory.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Multiplexed sessions call. Runs many concurrent transforms, each with its
+ * own pipeline, over a single bidirectional stream.
+ *
+ * All state is handled on the runloop. Responses of all sessions share one
+ * write queue; sessions stop pulling output while it is full. Reading stops
+ * while any session has enough input buffered or its pipeline is being set up.
+ */
+class AsyncSessionsImpl
+{
+public:
+    AsyncSessionsImpl(const AsyncCallResources *resources);
+    ~AsyncSessionsImpl();
+
+private:
+    static const unsigned int MAX_RESPONSE_BYTES;
+    static const unsigned int MAX_PULL_SAMPLES;
+    static const unsigned int MAX_QUEUED_BYTES;
+
+    struct Session
+    {
+        unsigned long id;
+        TransformConfig config;
+        // released after the pipeline is destroyed
+        std::unique_ptr<NumaPlacement::Lease> placement;
+        std::unique_ptr<Pipeline> pipeline;
+        std::unique_ptr<TrafficCapture::Session> capture;
+        std::unique_ptr<LoadTracker::Stream> load;
+        // listed by the admin service while attached
+        std::unique_ptr<StreamRegistry::Registration> registration;
+        unsigned long pacingId;
+        int samplesAvailable;
+        bool enoughData;
+        bool inputEnded;
+        bool eos;
+        bool terminating;
+        // pipeline is being built and started on the setup pool
+        bool settingUp;
+        SessionResponse response;
+        unsigned int bufferedSize;
+    };
+
+    const AsyncCallResources *resources;
+    std::shared_ptr<spdlog::logger> logger;
+    std::string requestId;
+    GRunLoop *runloop;
+
+    ::grpc::ServerContext serverContext;
+    ::grpc::ServerAsyncReaderWriter<SessionResponse, SessionRequest> responder;
+    ServerPipelineFactory factory;
+
+    std::function<void(bool)> requestFunction;
+    std::function<void(bool)> readDoneFunction;
+    std::function<void(bool)> writeDoneFunction;
+    std::function<void(bool)> finishFunction;
+    // delivered once the call is done, including when the client cancels or its deadline passes
+    std::function<void(bool)> doneFunction;
+
+    std::map<unsigned long, std::shared_ptr<Session>> sessions;
+    // sessions with enough input buffered
+    unsigned int blockedSessions;
+    // sessions with their pipeline being built on the setup pool
+    unsigned int pendingSetups;
+    // pipelines being torn down on the reaper pool
+    unsigned int pendingTeardowns;
+
+    SessionRequest request;
+    bool reading;
+    bool readsDone;
+
+    std::deque<SessionResponse> writeQueue;
+    unsigned int queuedBytes;
+    unsigned int writingBytes;
+    bool writing;
+    std::chrono::steady_clock::time_point writeStartTime;
+
+    bool failed;
+    ::grpc::Status failedStatus;
+    bool finishing;
+    bool finished;
+    bool done;
+
+    void handleRequest();
+    void startSession(unsigned long id, const TransformConfig &config);
+    void setupSession(const std::shared_ptr<Session> &session);
+    void attachSession(const std::shared_ptr<Session> &session, const std::string &error);
+    void pullSamples(const std::shared_ptr<Session> &session);
+    void finalizeSession(const std::shared_ptr<Session> &session);
+    void terminateSession(const std::shared_ptr<Session> &session);
+    void completeSession(const std::shared_ptr<Session> &session, TerminationReason reason, const std::string &message);
+    void cancelSession(const std::shared_ptr<Session> &session, const std::string &message);
+    void removeSession(const std::shared_ptr<Session> &session);
+    void reapSession(const std::shared_ptr<Session> &session);
+    void deleteIfFinished();
+    void resumeSessions();
+    void enqueue(unsigned long sessionId, SessionResponse &response);
+    void writeNext();
+    void readNext();
+    void fail(const ::grpc::Status &status);
+    void finishIfDone();
+};
+
+}
+}
+
+#endif
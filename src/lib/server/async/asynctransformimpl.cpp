@@ -3,26 +3,32 @@
 #include "../serverpipelinefactory.h"
 
 #include <fmt/format.h>
+#include <algorithm>
 
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/stdout_sinks.h>
+
+#include "requestlogger.h"
 
 namespace gst_transformer {
 namespace service {
 
-AsyncTransformImpl::AsyncTransformImpl(
-    std::shared_ptr<spdlog::logger> &globalLogger,
-    GRunLoop *runloop,
-    GstTransformer::AsyncService *service,
-    ::grpc::ServerCompletionQueue *completionQueue,
-    const ServiceParametersStruct *params) 
-    : responder(&this->serverContext), factory(*params)
+const unsigned int AsyncTransformImpl::MAX_RESPONSE_BYTES = 1024 * 1024;
+const unsigned int AsyncTransformImpl::MAX_PULL_SAMPLES = 64;
+const unsigned int AsyncTransformImpl::DEFAULT_MAX_SPILL_THRESHOLD_BYTES = 1024 * 1024;
+
+AsyncTransformImpl::AsyncTransformImpl(const AsyncCallResources *resources) 
+    : responder(&this->serverContext), factory(*resources->params, resources->pipelinePool, resources->workerPool)
 {
-    this->globalLogger = globalLogger;
-    this->runloop = runloop;
-    this->service = service;
-    this->completionQueue = completionQueue;
-    this->params = params;
+    this->resources = resources;
+    this->globalLogger = resources->globalLogger;
+    this->runloop = resources->runloop;
+    this->pacingScheduler = resources->pacingScheduler;
+    this->pacingId = 0;
+    this->numaPlacement = resources->numaPlacement;
+    this->trafficCapture = resources->trafficCapture;
+    this->service = resources->service;
+    this->completionQueue = resources->completionQueue;
+    this->params = resources->params;
     this->nextWriteCallback = nullptr;
     this->writeState = AsyncWriteState::Idle;
     this->logger = nullptr;
@@ -35,16 +41,26 @@ AsyncTransformImpl::~AsyncTransformImpl()
         this->logger->trace("AsyncTransormImpl destructor called");
     else
         this->globalLogger->trace("AsyncTransormImpl destructor called");
+
+    if (this->pacingId)
+        this->pacingScheduler->removeStream(this->pacingId);
 }
 
 void AsyncTransformImpl::setup()
 {
     this->readReady = false;
+    this->reading = false;
     this->writeReady = true;
     this->samplesAvailable = 0;
     this->writeBufferedSize = 0;
     this->terminating = false;
     this->eos = false;
+    this->started = false;
+    this->setupPending = false;
+    this->cancelled = false;
+    this->done = false;
+    this->finishing = false;
+    this->finished = false;
 
     this->wrapperWriteCallback = [&] (bool ok) {
         this->writeCallback(ok);
@@ -57,7 +73,7 @@ void AsyncTransformImpl::setup()
             return;
         }
 
-        new AsyncTransformImpl(this->globalLogger, this->runloop, this->service, this->completionQueue, this->params);
+        new AsyncTransformImpl(this->resources);
 
         auto metadata = this->serverContext.client_metadata();
         auto iterator = metadata.find(ClientMetadata_Name(ClientMetadata::requestid));
@@ -73,8 +89,7 @@ void AsyncTransformImpl::setup()
 
         this->requestId = std::string(iterator->second.data(), iterator->second.size());
         this->globalLogger->debug("request ID {0}", requestId);
-        // TODO: not ideal but convenient. global lock.
-        this->logger = spdlog::stderr_logger_mt(fmt::format("asyncserviceimpl.Transform/{0}", requestId));
+        this->logger = RequestLogger::shared()->get("asyncserviceimpl.Transform", requestId);
 
         this->responder.Read(&this->request, &this->startFunction);
     };
@@ -92,7 +107,7 @@ void AsyncTransformImpl::setup()
         auto params = this->config.pipeline_parameters();
         logger->debug("request config {0}", this->config.ShortDebugString());
         try {
-            this->validateConfig(this->config);
+            validateConfig(this->params, this->config);
         }
         catch(std::exception &e) {
             auto message = fmt::format("invalid config: {0}", e.what());
@@ -104,88 +119,44 @@ void AsyncTransformImpl::setup()
         }
         logger->debug("request config with limits applied {0}", this->config.ShortDebugString());
 
-        try {
-            this->pipeline = this->factory.get(requestId, this->config);
-        }
-        catch(std::exception &e) {
-            auto message = fmt::format("cannot create pipeline: {0}", e.what());
-            logger->warn(message);
+        std::string deadlineMessage;
+        if (!checkDeadline(this->resources->setupPool, this->serverContext, this->config, deadlineMessage)) {
+            logger->warn(deadlineMessage);
             this->responder.Finish(
-                ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, message), 
+                ::grpc::Status(::grpc::StatusCode::DEADLINE_EXCEEDED, deadlineMessage),
                 &this->finishFunction);
             return;
         }
 
-        this->pipeline->setSampleAvailableCallback([&] () {
-            this->runloop->execute([=] {
-                this->logger->trace("sample callback invoked");
-                this->samplesAvailable++;
-                if (this->writeReady)
-                    this->pullSample();
-            });
-        });
-
-        this->pipeline->setEnoughDataCallback([&] {
-            this->runloop->execute([=] {
-                this->runloop->assertOnLoop();
-                this->logger->trace("setting read ready to false");
-                this->readReady = false;
-            });
-        });
+        if (this->trafficCapture)
+            this->capture = this->trafficCapture->begin(this->requestId, this->config);
+        this->load = this->resources->loadTracker->begin(this->config.pipeline_name());
 
-        this->pipeline->setNeedDataCallback([&] () {
-            this->runloop->execute([=] {
-                if (!this->readReady) {
-                    this->logger->trace("setting read ready to true");
-                    this->readReady = true;
-                    this->responder.Read(&this->request, &this->readDoneFunction);
-                }
-            });
+        // pipeline construction and state changes may block, keep them off the completion queue
+        this->setupStartTime = std::chrono::steady_clock::now();
+        this->setupPending = true;
+        auto queued = this->resources->setupPool->submit([this] {
+            this->startPipeline();
         });
-
-        this->pipeline->setEOSCallback([&] () {
-            this->runloop->execute([=] {
-                this->logger->debug("got EOS from pipeline");
-                // flush buffered data if any
-                this->eos = true;
-                if (this->writeReady) {
-                    this->logger->trace("EOS and writeReady, finalizing");
-                    this->finalizeWrites();
-                }
-                else {
-                    this->logger->trace("EOS and !writeReady");
-                }
-            });
-        });
-
-        this->pipeline->start(
-            [&] (bool force) {
-                if (this->terminating)
-                    return;
-                this->runloop->execute([=] {
-                    this->logger->trace("error callback invoked, force: {0}", force);
-                    if (force) {
-                        this->terminating = true;
-                        if (this->writeState < AsyncWriteState::WritingSummary) {
-                            if (this->writeReady) {
-                                this->logger->trace("writeReady, jumping to summaries");
-                                this->summaryFunction(true);
-                            }
-                            else {
-                                this->logger->trace("write not ready, setting next state to summaries");
-                                this->nextWriteCallback = this->summaryFunction;
-                            }
-                        }
-                    }
-                });
-            });
-
-        // wait for need data callback to initiate read
+        if (!queued) {
+            this->setupPending = false;
+            auto message = "too many pending pipeline setups";
+            logger->warn(message);
+            this->responder.Finish(
+                ::grpc::Status(::grpc::StatusCode::RESOURCE_EXHAUSTED, message), 
+                &this->finishFunction);
+        }
     };
 
     this->readDoneFunction = [&] (bool ok) {
         this->runloop->execute([=] {
-            this->logger->trace("read callback called ok: {0}", ok);
+            SPDLOG_LOGGER_TRACE(this->logger, "read callback called ok: {0}", ok);
+            this->reading = false;
+            if (this->finished) {
+                this->deleteIfFinished();
+                return;
+            }
+
             if (ok) {
                 if (!this->request.has_payload()) {
                     auto message = "no payload in request message";
@@ -198,6 +169,8 @@ void AsyncTransformImpl::setup()
                 auto payloads = request.payload();
                 for (int i=0; i<payloads.data_size(); i++) {
                     auto data = payloads.data(i);
+                    if (this->capture)
+                        this->capture->payload(data);
                     if (pipeline->addData(data.data(), data.size()) == -1) {
                         logger->warn("pipeline returned error adding data");
                         pipelineError = true;
@@ -205,49 +178,56 @@ void AsyncTransformImpl::setup()
                     }
                 }
                 this->request.Clear();
-                if (!pipelineError && readReady)
+                if (!pipelineError && readReady) {
+                    this->reading = true;
                     this->responder.Read(&request, &this->readDoneFunction);
+                }
             }
             else {
-                logger->trace("ending data stream");
+                SPDLOG_LOGGER_TRACE(logger, "ending data stream");
                 pipeline->endData();
             }
         });
     };
 
     this->writeSampleDoneFunction = [&] (bool ok) {
-        this->logger->trace("writeSample callback called, ok: {0}", ok);
+        SPDLOG_LOGGER_TRACE(this->logger, "writeSample callback called, ok: {0}", ok);
         if (ok) {
-            if (!this->eos) {
-                if (this->samplesAvailable) {
-                    this->logger->trace("writeSampleDoneFunction: sample ready, pulling {0} samples", this->samplesAvailable);
-                    this->pullSample();
-                }
-                else {
-                    this->logger->trace("writeSampleDoneFunction: no sample ready");
-                }
+            if (this->samplesAvailable) {
+                SPDLOG_LOGGER_TRACE(this->logger, "writeSampleDoneFunction: sample ready, pulling {0} samples", this->samplesAvailable);
+                this->pullSample();
             }
             else {
-                this->logger->trace("writeSampleDoneFunction: finalizeWrites");
+                SPDLOG_LOGGER_TRACE(this->logger, "writeSampleDoneFunction: no sample ready");
+            }
+            // output may still be pending after eos, e.g. spilled to disk
+            if (this->eos && this->writeReady) {
+                SPDLOG_LOGGER_TRACE(this->logger, "writeSampleDoneFunction: finalizeWrites");
                 this->finalizeWrites();
             }
-            this->logger->trace("writeSampleDoneFunction: done");
+            SPDLOG_LOGGER_TRACE(this->logger, "writeSampleDoneFunction: done");
         }
         else {
             this->logger->warn("not ok in write");
+            this->finishCancelled("write failed");
         }
     };
 
     this->writeRemainderDoneFunction = [&] (bool ok) {
-        this->logger->trace("writerRemainderDoneFunction: callback, ok: {0}", ok);
+        SPDLOG_LOGGER_TRACE(this->logger, "writerRemainderDoneFunction: callback, ok: {0}", ok);
         if (ok) 
             this->summaryFunction(ok);
-        else
+        else {
             this->logger->warn("writerRemainderDoneFunction: not ok");
+            this->finishCancelled("write failed");
+        }
     };
 
     this->summaryFunction = [&] (bool ok) {
-        this->logger->trace("summaryFunction: callback, ok: {0}", ok);
+        SPDLOG_LOGGER_TRACE(this->logger, "summaryFunction: callback, ok: {0}", ok);
+        if (this->finishing)
+            return;
+
         if (ok) {
             TransformResponse finalResponse;
             auto completion = finalResponse.mutable_transform_completed();
@@ -256,25 +236,58 @@ void AsyncTransformImpl::setup()
             completion->set_processed_input_bytes(this->pipeline->getProcessedInputBytes());
             completion->set_processed_output_bytes(this->pipeline->getProcessedOutputBytes());
             completion->set_processed_time(this->pipeline->getProcessedTime());
-            logger->trace("writing summary");
+            if (this->capture)
+                this->capture->completed(completion->termination_reason(), completion->processed_time());
+            SPDLOG_LOGGER_TRACE(logger, "writing summary");
             this->write(finalResponse, AsyncWriteState::WritingSummary, this->finishSuccessFunction);
         }
         else {
             this->logger->warn("unable to perform flush write");
+            this->finishCancelled("write failed");
         }
     };
 
     this->finishSuccessFunction = [&] (bool ok) {
-        this->logger->trace("finishSuccessFunction: callback, ok: {0}", ok);
+        SPDLOG_LOGGER_TRACE(this->logger, "finishSuccessFunction: callback, ok: {0}", ok);
+        if (this->finishing)
+            return;
+
+        this->finishing = true;
         this->responder.Finish(::grpc::Status::OK, &this->finishFunction);
     };
 
     this->finishFunction = [&] (bool ok) {
-        this->logger->debug("call finished, ok: {0}", ok);
-        delete this;
+        (this->logger ? this->logger : this->globalLogger)->debug("call finished, ok: {0}", ok);
+        // released on the runloop, where pullSample reports progress through them
+        this->runloop->execute([this] {
+            this->load.reset();
+            this->registration.reset();
+            // no pacing releases once finished, the call may be deleted at any time
+            if (this->pacingId) {
+                this->pacingScheduler->removeStream(this->pacingId);
+                this->pacingId = 0;
+            }
+            this->finished = true;
+            this->deleteIfFinished();
+        });
     };
 
-    this->globalLogger->trace("RequestTransform");
+    this->doneFunction = [&] (bool ok) {
+        this->runloop->execute([this] {
+            this->done = true;
+            if (this->serverContext.IsCancelled() && !this->finished) {
+                (this->logger ? this->logger : this->globalLogger)->debug("call cancelled by client or deadline");
+                this->cancelled = true;
+                // a pipeline still being set up is cancelled once started
+                if (this->started)
+                    this->cancel("call cancelled by client or deadline");
+            }
+            this->deleteIfFinished();
+        });
+    };
+
+    this->serverContext.AsyncNotifyWhenDone(&this->doneFunction);
+    SPDLOG_LOGGER_TRACE(this->globalLogger, "RequestTransform");
     this->service->RequestTransform(
         &this->serverContext,
         &this->responder,
@@ -283,24 +296,179 @@ void AsyncTransformImpl::setup()
         &this->configFunction);    
 }
 
+void AsyncTransformImpl::startPipeline()
+{
+    try {
+        if (this->numaPlacement)
+            this->placement = this->numaPlacement->acquire();
+        this->pipeline = this->factory.get(requestId, this->config, this->placement.get());
+    }
+    catch(std::exception &e) {
+        auto message = fmt::format("cannot create pipeline: {0}", e.what());
+        logger->warn(message);
+        this->setupPending = false;
+        this->responder.Finish(
+            ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, message), 
+            &this->finishFunction);
+        return;
+    }
+
+    this->pipeline->setSampleAvailableCallback([&] () {
+        this->runloop->execute([=] {
+            SPDLOG_LOGGER_TRACE(this->logger, "sample callback invoked");
+            this->samplesAvailable++;
+            if (this->writeReady)
+                this->pullSample();
+        });
+    });
+
+    auto rate = this->config.pipeline_parameters().rate() ? this->config.pipeline_parameters().rate() : 1.0;
+    if (this->pacingScheduler && rate > 0) {
+        this->pacingId = this->pacingScheduler->addStream(rate, [&] () {
+            this->runloop->execute([=] {
+                SPDLOG_LOGGER_TRACE(this->logger, "pacing release invoked");
+                if (this->writeReady) {
+                    if (this->eos)
+                        this->finalizeWrites();
+                    else
+                        this->pullSample();
+                }
+            });
+        });
+    }
+
+    this->pipeline->setEnoughDataCallback([&] {
+        this->runloop->execute([=] {
+            this->runloop->assertOnLoop();
+            SPDLOG_LOGGER_TRACE(this->logger, "setting read ready to false");
+            this->readReady = false;
+        });
+    });
+
+    this->pipeline->setNeedDataCallback([&] () {
+        this->runloop->execute([=] {
+            if (!this->readReady) {
+                SPDLOG_LOGGER_TRACE(this->logger, "setting read ready to true");
+                this->readReady = true;
+                if (!this->reading && !this->cancelled) {
+                    this->reading = true;
+                    this->responder.Read(&this->request, &this->readDoneFunction);
+                }
+            }
+        });
+    });
+
+    this->pipeline->setEOSCallback([&] () {
+        this->runloop->execute([=] {
+            this->logger->debug("got EOS from pipeline");
+            // flush buffered data if any
+            this->eos = true;
+            if (this->writeReady) {
+                SPDLOG_LOGGER_TRACE(this->logger, "EOS and writeReady, finalizing");
+                this->finalizeWrites();
+            }
+            else {
+                SPDLOG_LOGGER_TRACE(this->logger, "EOS and !writeReady");
+            }
+        });
+    });
+
+    this->pipeline->start(
+        [&] (bool force) {
+            if (this->terminating)
+                return;
+            this->runloop->execute([=] {
+                SPDLOG_LOGGER_TRACE(this->logger, "error callback invoked, force: {0}", force);
+                if (force) {
+                    this->terminating = true;
+                    if (this->writeState < AsyncWriteState::WritingSummary) {
+                        if (this->writeReady) {
+                            SPDLOG_LOGGER_TRACE(this->logger, "writeReady, jumping to summaries");
+                            this->summaryFunction(true);
+                        }
+                        else {
+                            SPDLOG_LOGGER_TRACE(this->logger, "write not ready, setting next state to summaries");
+                            this->nextWriteCallback = this->summaryFunction;
+                        }
+                    }
+                }
+            });
+        });
+
+    this->resources->setupPool->recordSetupTime(
+        this->config.pipeline_name(),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->setupStartTime).count());
+    this->runloop->execute([this] {
+        this->setupPending = false;
+        // pipeline failed right away and the call already finished
+        if (this->finished) {
+            this->deleteIfFinished();
+            return;
+        }
+
+        this->started = true;
+        // only listed once started, an admin cancel must not race the start
+        this->registration = this->resources->streamRegistry->add(
+            this->requestId,
+            0,
+            this->config.pipeline_name(),
+            [this] (ActiveStream &stream) {
+                this->describe(stream);
+            },
+            [this] (const std::string &message) {
+                this->cancel(message);
+            });
+        if (this->cancelled)
+            this->cancel("call cancelled by client or deadline");
+    });
+
+    // wait for need data callback to initiate read
+}
+
 void AsyncTransformImpl::pullSample()
 {
     // called with writeReady and sampleReady
-    if (this->terminating)
+    if (this->terminating || this->finishing)
         return;
 
-    auto samples = this->pipeline->getPendingSample(this->samplesAvailable);
-    for(auto sample : samples) {
-        this->response.mutable_payload()->add_data(std::string(sample));
-        this->writeBufferedSize += sample.length();
+    // bound response size so that large backlogs, such as spilled output, are sent in chunks
+    auto limit = std::max(config.pipeline_output_buffer(), MAX_RESPONSE_BYTES);
+    while (this->samplesAvailable > 0 && this->writeBufferedSize <= limit) {
+        // paced requests only release output up to their scheduler allowance
+        double until = -1;
+        if (this->pacingId)
+            until = this->pacingScheduler->getAllowance(this->pacingId);
+
+        double endTime;
+        auto samples = this->pipeline->getPendingSample(MAX_PULL_SAMPLES, until, endTime);
+        for(auto &sample : samples) {
+            if (this->capture)
+                this->capture->output(sample);
+            this->writeBufferedSize += sample.length();
+            this->response.mutable_payload()->add_data(std::move(sample));
+        }
+        if (this->load && !samples.empty())
+            this->load->progress(this->pipeline->getProcessedTime());
+        if (this->pacingId && !samples.empty())
+            this->pacingScheduler->consume(this->pacingId, endTime);
+        // notifications are coalesced, keep pulling until drained
+        if (samples.size() < MAX_PULL_SAMPLES) {
+            auto nextTime = this->pacingId ? this->pipeline->getNextSampleTime() : -1;
+            if (nextTime >= 0) {
+                // held back, keep samples available until released
+                this->pacingScheduler->schedule(this->pacingId, nextTime);
+                break;
+            }
+            this->samplesAvailable = 0;
+        }
+        else
+            this->samplesAvailable = std::max(this->samplesAvailable - (int)samples.size(), 1);
     }
     if (this->writeBufferedSize > config.pipeline_output_buffer()) {
         this->write(this->response, AsyncWriteState::WritingSamples, this->writeSampleDoneFunction);
         this->response.Clear();
         this->writeBufferedSize = 0;
     }
-
-    this->samplesAvailable = 0;
 }
 
 void AsyncTransformImpl::finalizeWrites()
@@ -308,9 +476,16 @@ void AsyncTransformImpl::finalizeWrites()
     this->runloop->assertOnLoop();
 
     // called with writeReady
-    if (this->terminating)
+    if (this->terminating || this->finishing)
         return;
 
+    if (this->samplesAvailable > 0) {
+        this->pullSample();
+        // either writing or waiting for paced output to be released
+        if (!this->writeReady || this->samplesAvailable > 0)
+            return;
+    }
+
     if (this->response.payload().data_size() > 0) {
         logger->debug("flushing {0} buffers to client", this->response.payload().data_size());
         this->write(this->response, AsyncWriteState::WritingSamplesRemainder, this->writeRemainderDoneFunction);
@@ -330,6 +505,7 @@ void AsyncTransformImpl::write(const TransformResponse &m, AsyncWriteState write
 
     this->writeState = writeState;
     this->nextWriteCallback = nextCallback;
+    this->writeStartTime = std::chrono::steady_clock::now();
     this->responder.Write(m, &this->wrapperWriteCallback);
     this->writeReady = false;
 }
@@ -347,50 +523,157 @@ void AsyncTransformImpl::writeCallback(bool ok)
     });
 }
 
-void AsyncTransformImpl::validateConfig(TransformConfig &transformConfig)
+void AsyncTransformImpl::describe(ActiveStream &stream)
+{
+    StreamRegistry::describePipeline(*this->pipeline, stream);
+    if (!this->writeReady) {
+        stream.set_write_stall_millis(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - this->writeStartTime).count());
+    }
+}
+
+void AsyncTransformImpl::cancel(const std::string &message)
+{
+    this->runloop->assertOnLoop();
+    if (this->terminating || this->finishing)
+        return;
+
+    this->logger->info("cancelling: {0}", message);
+    this->terminating = true;
+    // releases decoder resources right away, teardown completes on the reaper pool
+    this->pipeline->stop();
+    if (this->writeState >= AsyncWriteState::WritingSummary)
+        return;
+
+    if (!this->writeReady) {
+        // the client may not be reading, do not wait for the pending write
+        this->nextWriteCallback = [this, message] (bool ok) {
+            this->finishCancelled(message);
+        };
+        this->serverContext.TryCancel();
+    }
+    else if (this->cancelled) {
+        // nobody to send a summary to
+        this->finishCancelled(message);
+    }
+    else {
+        this->summaryFunction(true);
+    }
+}
+
+void AsyncTransformImpl::finishCancelled(const std::string &message)
+{
+    // reached from failed writes and cancellation, only the first one finishes the call
+    if (this->finishing)
+        return;
+
+    this->finishing = true;
+    if (!this->terminating) {
+        // no further output can be delivered, stop pipeline callbacks from writing
+        this->terminating = true;
+        if (this->pipeline)
+            this->pipeline->stop();
+    }
+    this->responder.Finish(
+        ::grpc::Status(::grpc::StatusCode::CANCELLED, message),
+        &this->finishFunction);
+}
+
+void AsyncTransformImpl::deleteIfFinished()
+{
+    if (!this->finished || !this->done || this->reading || this->setupPending)
+        return;
+
+    // destroying the pipeline waits for it to stop, keep it off the runloop.
+    // callbacks still reference this call until the pipeline is gone.
+    this->resources->reaperPool->submit([this] {
+        delete this;
+    });
+}
+
+bool AsyncTransformImpl::checkDeadline(SetupPool *setupPool, const ::grpc::ServerContext &serverContext, const TransformConfig &transformConfig, std::string &message)
+{
+    if (serverContext.deadline() == std::chrono::system_clock::time_point::max())
+        return true;
+
+    auto remaining = std::chrono::duration<double, std::milli>(serverContext.deadline() - std::chrono::system_clock::now()).count();
+    auto expected = setupPool->getExpectedSetupTime(transformConfig.pipeline_name());
+    if (remaining >= expected && remaining > 0)
+        return true;
+
+    message = fmt::format("remaining deadline {0:.0f}ms is shorter than expected setup time {1:.0f}ms", remaining, expected);
+    return false;
+}
+
+void AsyncTransformImpl::validateConfig(const ServiceParametersStruct *params, TransformConfig &transformConfig)
 {
     auto pipelineParams = transformConfig.pipeline_parameters();
 
-    if (!transformConfig.pipeline().empty() && !this->params->allow_dynamic_pipelines())
+    if (!transformConfig.pipeline().empty() && !params->allow_dynamic_pipelines())
         throw std::invalid_argument("dynamic pipelines in requests are disabled");
     
-    if (this->params->max_rate() != 0 && this->params->max_rate() != -1) {
-        if (pipelineParams.rate() > this->params->max_rate() || pipelineParams.rate() == -1)
+    if (params->max_rate() != 0 && params->max_rate() != -1) {
+        if (pipelineParams.rate() > params->max_rate() || pipelineParams.rate() == -1)
             throw std::invalid_argument(
                 fmt::format("requested rate {0} exceeds allowed max rate {1}", 
                 pipelineParams.rate(), 
-                this->params->max_rate()));
+                params->max_rate()));
     }
-    if (this->params->max_length_millis() != 0) {
-        if (pipelineParams.length_limit_milliseconds() > this->params->max_length_millis())
+    if (params->max_length_millis() != 0) {
+        if (pipelineParams.length_limit_milliseconds() > params->max_length_millis())
             throw std::invalid_argument(
                 fmt::format("requested length limit {0} exceeds allowed max {1}",
                 pipelineParams.length_limit_milliseconds(),
-                this->params->max_length_millis()));
-        transformConfig.mutable_pipeline_parameters()->set_length_limit_milliseconds(this->params->max_length_millis());
+                params->max_length_millis()));
+        transformConfig.mutable_pipeline_parameters()->set_length_limit_milliseconds(params->max_length_millis());
     }
-    if (this->params->max_start_tolerance_bytes() != 0) {
-        if (pipelineParams.start_tolerance_bytes() > this->params->max_start_tolerance_bytes())
+    if (params->max_start_tolerance_bytes() != 0) {
+        if (pipelineParams.start_tolerance_bytes() > params->max_start_tolerance_bytes())
             throw std::invalid_argument(
                 fmt::format("requested start tolerance bytes {0} exceeds allowed max {1}",
                 pipelineParams.start_tolerance_bytes(),
-                this->params->max_start_tolerance_bytes()));
-        transformConfig.mutable_pipeline_parameters()->set_start_tolerance_bytes(this->params->max_start_tolerance_bytes());
+                params->max_start_tolerance_bytes()));
+        transformConfig.mutable_pipeline_parameters()->set_start_tolerance_bytes(params->max_start_tolerance_bytes());
     }
-    if (this->params->max_read_timeout_millis() != 0) {
-        if (pipelineParams.read_timeout_milliseconds() > this->params->max_read_timeout_millis())
+    if (params->max_read_timeout_millis() != 0) {
+        if (pipelineParams.read_timeout_milliseconds() > params->max_read_timeout_millis())
             throw std::invalid_argument(
                 fmt::format("requested read timeout {0} exceeds allowed max {1}",
                 pipelineParams.read_timeout_milliseconds(),
-                this->params->max_read_timeout_millis()));
-        transformConfig.mutable_pipeline_parameters()->set_read_timeout_milliseconds(this->params->max_read_timeout_millis());
+                params->max_read_timeout_millis()));
+        transformConfig.mutable_pipeline_parameters()->set_read_timeout_milliseconds(params->max_read_timeout_millis());
+    }
+    if (params->max_input_buffer_bytes() != 0) {
+        if (pipelineParams.input_buffer_bytes() > params->max_input_buffer_bytes())
+            throw std::invalid_argument(
+                fmt::format("requested input buffer bytes {0} exceeds allowed max {1}",
+                pipelineParams.input_buffer_bytes(),
+                params->max_input_buffer_bytes()));
+        if (pipelineParams.input_buffer_bytes() == 0)
+            transformConfig.mutable_pipeline_parameters()->set_input_buffer_bytes(params->max_input_buffer_bytes());
+    }
+    if (params->max_input_buffer_millis() != 0) {
+        if (pipelineParams.input_buffer_milliseconds() > params->max_input_buffer_millis())
+            throw std::invalid_argument(
+                fmt::format("requested input buffer time {0} exceeds allowed max {1}",
+                pipelineParams.input_buffer_milliseconds(),
+                params->max_input_buffer_millis()));
+        if (pipelineParams.input_buffer_milliseconds() == 0)
+            transformConfig.mutable_pipeline_parameters()->set_input_buffer_milliseconds(params->max_input_buffer_millis());
     }
-    if (this->params->max_pipeline_output_buffer() != 0) {
-        if (transformConfig.pipeline_output_buffer() > this->params->max_pipeline_output_buffer()) 
+    // output below the threshold is held in memory, unbounded it would bypass the spill quota
+    auto maxSpillThreshold = params->max_spill_threshold_bytes() ? params->max_spill_threshold_bytes() : DEFAULT_MAX_SPILL_THRESHOLD_BYTES;
+    if (pipelineParams.output_spill_threshold_bytes() > maxSpillThreshold)
+        throw std::invalid_argument(
+            fmt::format("requested output spill threshold bytes {0} exceeds allowed max {1}",
+            pipelineParams.output_spill_threshold_bytes(),
+            maxSpillThreshold));
+    if (params->max_pipeline_output_buffer() != 0) {
+        if (transformConfig.pipeline_output_buffer() > params->max_pipeline_output_buffer()) 
             throw std::invalid_argument(
                 fmt::format("requested pipeline output buffer {0} exceeds allowed max {1}",
                 transformConfig.pipeline_output_buffer(),
-                this->params->max_pipeline_output_buffer()));
+                params->max_pipeline_output_buffer()));
     }
 }
 
@@ -19,6 +19,7 @@ all copies or substantial portions of the Software.
 
 #include <grpc++/grpc++.h>
 #include <spdlog/spdlog.h>
+#include <chrono>
 #include <thread>
 #include <functional>
 
@@ -27,6 +28,11 @@ all copies or substantial portions of the Software.
 #include "asyncserviceimpl.h"
 #include "../serverpipelinefactory.h"
 #include "../grunloop.h"
+#include "../pacingscheduler.h"
+#include "../numaplacement.h"
+#include "../trafficcapture.h"
+#include "../loadtracker.h"
+#include "../streamregistry.h"
 
 namespace gst_transformer {
 namespace service {
@@ -42,15 +48,33 @@ enum class AsyncWriteState {
 class AsyncTransformImpl
 {
 public:
-    AsyncTransformImpl(
-        std::shared_ptr<spdlog::logger> &globalLogger,
-        GRunLoop *runloop,
-        GstTransformer::AsyncService *service,
-        ::grpc::ServerCompletionQueue *completionQueue,
-        const ServiceParametersStruct *params);
+    AsyncTransformImpl(const AsyncCallResources *resources);
     ~AsyncTransformImpl();
 
+    /**
+     * Validate a request config against service limits and apply defaults.
+     *
+     * \param params service parameters.
+     * \param transformConfig config to validate, updated in place.
+     */
+    static void validateConfig(const ServiceParametersStruct *params, TransformConfig &transformConfig);
+    /**
+     * Check that enough of the call deadline remains to set up a pipeline.
+     *
+     * \param setupPool setup pool with recent setup times.
+     * \param serverContext context of the call.
+     * \param transformConfig request config.
+     * \param message set to the reason when the deadline is too short.
+     * \return false if the deadline is shorter than the expected setup time.
+     */
+    static bool checkDeadline(SetupPool *setupPool, const ::grpc::ServerContext &serverContext, const TransformConfig &transformConfig, std::string &message);
+
 private:
+    static const unsigned int MAX_RESPONSE_BYTES;
+    static const unsigned int MAX_PULL_SAMPLES;
+    static const unsigned int DEFAULT_MAX_SPILL_THRESHOLD_BYTES;
+
+    const AsyncCallResources *resources;
     std::shared_ptr<spdlog::logger> globalLogger;
     std::shared_ptr<spdlog::logger> logger;
     std::string requestId;
@@ -59,6 +83,18 @@ private:
     ::grpc::ServerCompletionQueue *completionQueue;
     const ServiceParametersStruct *params;
     GRunLoop *runloop;
+    PacingScheduler *pacingScheduler;
+    unsigned long pacingId;
+    NumaPlacement *numaPlacement;
+    // released after the pipeline is destroyed
+    std::unique_ptr<NumaPlacement::Lease> placement;
+    TrafficCapture *trafficCapture;
+    // set when this request is sampled for capture
+    std::unique_ptr<TrafficCapture::Session> capture;
+    // counted as active load until the call finishes
+    std::unique_ptr<LoadTracker::Stream> load;
+    // listed by the admin service while the pipeline runs
+    std::unique_ptr<StreamRegistry::Registration> registration;
 
     ::grpc::ServerContext serverContext;
     ::grpc::ServerAsyncReaderWriter<TransformResponse, TransformRequest> responder;
@@ -69,13 +105,17 @@ private:
     std::function<void(bool)> summaryFunction;
     std::function<void(bool)> finishSuccessFunction;
     std::function<void(bool)> finishFunction;
+    // delivered once the call is done, including when the client cancels or its deadline passes
+    std::function<void(bool)> doneFunction;
 
     std::function<void(bool)> wrapperWriteCallback;
     std::function<void(bool)> nextWriteCallback;
+    std::chrono::steady_clock::time_point writeStartTime;
 
     ServerPipelineFactory factory;
     TransformRequest request;
     bool readReady;
+    bool reading;
     std::function<void(bool)> readDoneFunction;
     
     bool writeReady;
@@ -85,17 +125,32 @@ private:
     std::function<void(bool)> writeSampleDoneFunction;
     bool terminating;
     bool eos;
+    std::chrono::steady_clock::time_point setupStartTime;
+    // pipeline setup completed on the setup pool
+    bool started;
+    // setup thread still uses the call, it is not deleted until setup completes
+    bool setupPending;
+    // client cancelled or deadline passed
+    bool cancelled;
+    bool done;
+    // Finish issued, nothing may be written anymore
+    bool finishing;
+    bool finished;
     AsyncWriteState writeState;
 
     std::unique_ptr<Pipeline> pipeline;
     TransformConfig config;
 
     void setup();
+    void startPipeline();
     void finalizeWrites();
     void pullSample();
     void write(const TransformResponse &m, AsyncWriteState writeState, const std::function<void(bool)> &nextCallback);
     void writeCallback(bool ok);
-    void validateConfig(TransformConfig &transformConfig);
+    void describe(ActiveStream &stream);
+    void cancel(const std::string &message);
+    void finishCancelled(const std::string &message);
+    void deleteIfFinished();
 };
 
 }
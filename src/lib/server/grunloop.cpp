@@ -1,22 +1,54 @@
 #include "grunloop.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <stdexcept>
 
 GRunLoop * GRunLoop::Main = nullptr;
 std::mutex GRunLoop::MainLock;
 
+const int GRunLoop::MAX_BATCH = 256;
+
+GSourceFuncs GRunLoop::TaskSourceFuncs = {
+    nullptr,
+    nullptr,
+    &GRunLoop::taskSourceDispatch,
+    nullptr
+};
+
 GRunLoop::GRunLoop()
 {
     this->loop = nullptr;
     this->context = g_main_context_new();
+    this->setupTaskSource();
 }
 
 GRunLoop::GRunLoop(bool isDefault)
 {
     this->loop = nullptr;
-    this->context = g_main_context_new();
-    if (isDefault)
-        this->context = g_main_context_default();
+    this->context = isDefault ? g_main_context_default() : g_main_context_new();
+    this->setupTaskSource();
+}
+
+void GRunLoop::setupTaskSource()
+{
+    this->taskTail = new Task();
+    this->taskTail->next = nullptr;
+    this->taskHead = this->taskTail;
+    this->wakeupPending = false;
+
+    this->wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (this->wakeupFd == -1)
+        throw std::runtime_error("unable to create runloop eventfd");
+
+    this->taskSource = g_source_new(&TaskSourceFuncs, sizeof(TaskSource));
+    reinterpret_cast<TaskSource *>(this->taskSource)->runloop = this;
+    g_source_add_unix_fd(this->taskSource, this->wakeupFd, G_IO_IN);
+    g_source_attach(this->taskSource, this->context);
 }
 
 void GRunLoop::start()
@@ -57,32 +89,76 @@ GRunLoop * GRunLoop::main()
     return Main;
 }
 
-bool GRunLoop::execute(const std::function<void()> &func)
+bool GRunLoop::execute(std::function<void()> func)
 {
     if (!this->isOnLoop()) {
-        auto f = new std::function<void()>();
-        *f = std::function<void()>([=] {
-            std::unique_ptr<std::function<void()>> p(f);
-            func();
-        });
-        if (g_idle_add(&_execute, f) > 0) {
-            return true;
-        }
-        else {
-            delete f;
-            return false;
-        }
+        auto task = new Task();
+        task->func = std::move(func);
+        this->enqueue(task);
+        this->wakeup();
     }
     else {
         func();
-        return true;
     }
+
+    return true;
+}
+
+void GRunLoop::enqueue(Task *task)
+{
+    task->next.store(nullptr, std::memory_order_relaxed);
+    auto previous = this->taskHead.exchange(task, std::memory_order_acq_rel);
+    previous->next.store(task, std::memory_order_release);
+}
+
+bool GRunLoop::dequeue(std::function<void()> &func)
+{
+    // tail is always a consumed placeholder, its successor holds the next task
+    auto tail = this->taskTail;
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (!next)
+        return false;
+
+    func = std::move(next->func);
+    this->taskTail = next;
+    delete tail;
+
+    return true;
+}
+
+void GRunLoop::wakeup()
+{
+    // only the first producer after a drain needs to signal the loop
+    if (!this->wakeupPending.exchange(true)) {
+        uint64_t value = 1;
+        while (write(this->wakeupFd, &value, sizeof(value)) == -1 && errno == EINTR);
+    }
+}
+
+void GRunLoop::drainTasks()
+{
+    uint64_t value;
+    while (read(this->wakeupFd, &value, sizeof(value)) == -1 && errno == EINTR);
+    // clear before draining so that producers racing with us signal again
+    this->wakeupPending.exchange(false);
+
+    std::function<void()> func;
+    int count = 0;
+    while (count < MAX_BATCH && this->dequeue(func)) {
+        func();
+        func = nullptr;
+        count++;
+    }
+
+    // give other sources a chance before continuing with the rest
+    if (count == MAX_BATCH)
+        this->wakeup();
 }
 
-gboolean GRunLoop::_execute(gpointer user_data)
+gboolean GRunLoop::taskSourceDispatch(GSource *source, GSourceFunc callback, gpointer user_data)
 {
-    auto func = static_cast<std::function<void()> *>(user_data);
-    (*func)();
+    auto runloop = reinterpret_cast<TaskSource *>(source)->runloop;
+    runloop->drainTasks();
 
-    return FALSE;
+    return G_SOURCE_CONTINUE;
 }
@@ -20,11 +20,15 @@ all copies or substantial portions of the Software.
 #include <functional>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <glib.h>
 
 /**
  * Thin wrapper around GLib runloop. Used to track threads and thread execution
  * for callbacks in/out of gstreamer.
+ *
+ * Functions executed from other threads are pushed to a lock-free multi-producer
+ * queue drained by a single persistent GSource, woken up by an eventfd.
  */
 class GRunLoop
 {
@@ -52,7 +56,7 @@ public:
      * \param func function to call.
      * \return true if execution has been successfully scheduled.
      */
-    bool execute(const std::function<void()> &func);
+    bool execute(std::function<void()> func);
 
     /**
      * Asserts execution on the runloop thread.
@@ -72,17 +76,44 @@ public:
     static GRunLoop * main();
 
 private:
+    struct Task
+    {
+        std::atomic<Task *> next;
+        std::function<void()> func;
+    };
+
+    struct TaskSource
+    {
+        GSource source;
+        GRunLoop *runloop;
+    };
+
+    static const int MAX_BATCH;
+
     GMainLoop *loop;
     GMainContext *context;
     std::thread thread;
     std::thread::id threadId;
 
+    // producers push to head, loop thread pops from tail
+    std::atomic<Task *> taskHead;
+    Task *taskTail;
+    std::atomic<bool> wakeupPending;
+    int wakeupFd;
+    GSource *taskSource;
+
     GRunLoop(bool isDefault);
+    void setupTaskSource();
+    void enqueue(Task *task);
+    bool dequeue(std::function<void()> &func);
+    void wakeup();
+    void drainTasks();
 
     static GRunLoop * Main;
     static std::mutex MainLock;
+    static GSourceFuncs TaskSourceFuncs;
 
-    static gboolean _execute(gpointer user_data);
+    static gboolean taskSourceDispatch(GSource *source, GSourceFunc callback, gpointer user_data);
 };
 
 #endif
@@ -0,0 +1,169 @@
+#include "loadtracker.h"
+#include "grunloop.h"
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace gst_transformer::service;
+
+LoadTracker::Stream::Stream(LoadTracker *tracker, const std::string &pipelineName)
+    : processedTime(0)
+{
+    this->tracker = tracker;
+    this->pipelineName = pipelineName;
+}
+
+LoadTracker::Stream::~Stream()
+{
+    std::lock_guard<std::mutex> lock(this->tracker->lock);
+    this->tracker->streams.erase(this);
+    this->tracker->endedTime += this->processedTime;
+    auto iterator = this->tracker->activeStreams.find(this->pipelineName);
+    if (--iterator->second == 0)
+        this->tracker->activeStreams.erase(iterator);
+}
+
+void LoadTracker::Stream::progress(double processedTime)
+{
+    this->processedTime.store(processedTime, std::memory_order_relaxed);
+}
+
+LoadTracker::LoadTracker(unsigned int intervalMilliseconds, unsigned int maxStreams)
+{
+    this->intervalMilliseconds = intervalMilliseconds;
+    this->maxStreams = maxStreams;
+    this->timer = 0;
+    this->endedTime = 0;
+    this->lastSample = std::chrono::steady_clock::now();
+    this->lastProcessedTime = 0;
+    this->lastCpuBusy = 0;
+    this->lastCpuTotal = 0;
+    readCpuTimes(this->lastCpuBusy, this->lastCpuTotal);
+    this->load.set_headroom(1);
+    this->load.set_sample_interval_millis(intervalMilliseconds);
+}
+
+LoadTracker::~LoadTracker()
+{
+    if (this->timer)
+        g_source_remove(this->timer);
+}
+
+void LoadTracker::setChildProcesses(const std::function<std::vector<pid_t>()> &processes)
+{
+    this->childProcesses = processes;
+}
+
+void LoadTracker::start()
+{
+    // make sure we have a main loop
+    GRunLoop::main();
+    this->timer = g_timeout_add(this->intervalMilliseconds, aggregateCallback, this);
+}
+
+std::unique_ptr<LoadTracker::Stream> LoadTracker::begin(const std::string &pipelineName)
+{
+    auto stream = std::unique_ptr<Stream>(new Stream(this, pipelineName));
+
+    std::lock_guard<std::mutex> lock(this->lock);
+    this->streams.insert(stream.get());
+    this->activeStreams[pipelineName]++;
+    return stream;
+}
+
+void LoadTracker::getLoad(LoadResponse &load)
+{
+    std::lock_guard<std::mutex> lock(this->loadLock);
+    load.CopyFrom(this->load);
+}
+
+std::string LoadTracker::debugString()
+{
+    std::lock_guard<std::mutex> lock(this->loadLock);
+    return fmt::format("streams: {0}, realtimeFactor: {1:.2f}, cpu: {2:.2f}, memoryBytes: {3}, headroom: {4:.2f}",
+        this->load.total_streams(),
+        this->load.realtime_factor(),
+        this->load.cpu_utilization(),
+        this->load.memory_bytes(),
+        this->load.headroom());
+}
+
+void LoadTracker::aggregate()
+{
+    LoadResponse load;
+    double processedTime;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        processedTime = this->endedTime;
+        for(auto stream : this->streams)
+            processedTime += stream->processedTime.load(std::memory_order_relaxed);
+        for(auto &active : this->activeStreams) {
+            (*load.mutable_active_streams())[active.first] = active.second;
+            load.set_total_streams(load.total_streams() + active.second);
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - this->lastSample).count();
+    if (elapsed > 0)
+        load.set_realtime_factor(std::max(0.0, processedTime - this->lastProcessedTime) / elapsed);
+    this->lastSample = now;
+    this->lastProcessedTime = processedTime;
+
+    unsigned long busy, total;
+    if (readCpuTimes(busy, total)) {
+        if (total > this->lastCpuTotal)
+            load.set_cpu_utilization((double)(busy - this->lastCpuBusy) / (total - this->lastCpuTotal));
+        this->lastCpuBusy = busy;
+        this->lastCpuTotal = total;
+    }
+
+    auto memory = readResidentBytes("/proc/self/statm");
+    if (this->childProcesses) {
+        for(auto pid : this->childProcesses())
+            memory += readResidentBytes(fmt::format("/proc/{0}/statm", pid));
+    }
+    load.set_memory_bytes(memory);
+
+    auto headroom = 1.0 - load.cpu_utilization();
+    if (this->maxStreams)
+        headroom = std::min(headroom, 1.0 - (double)load.total_streams() / this->maxStreams);
+    load.set_headroom(std::max(0.0, headroom));
+    load.set_sample_interval_millis(this->intervalMilliseconds);
+
+    std::lock_guard<std::mutex> lock(this->loadLock);
+    this->load.Swap(&load);
+}
+
+gboolean LoadTracker::aggregateCallback(gpointer user_data)
+{
+    static_cast<LoadTracker *>(user_data)->aggregate();
+    return G_SOURCE_CONTINUE;
+}
+
+bool LoadTracker::readCpuTimes(unsigned long &busy, unsigned long &total)
+{
+    // host wide, pipelines may run in worker processes
+    std::ifstream stat("/proc/stat");
+    std::string cpu;
+    unsigned long user, nice, system, idle, iowait, irq, softirq, steal;
+    if (!(stat >> cpu >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal) || cpu != "cpu")
+        return false;
+
+    busy = user + nice + system + irq + softirq + steal;
+    total = busy + idle + iowait;
+    return true;
+}
+
+unsigned long LoadTracker::readResidentBytes(const std::string &statmPath)
+{
+    std::ifstream statm(statmPath);
+    unsigned long size, resident;
+    if (!(statm >> size >> resident))
+        return 0;
+
+    return resident * sysconf(_SC_PAGESIZE);
+}
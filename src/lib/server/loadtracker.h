@@ -0,0 +1,137 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __LOADTRACKER_H__
+#define __LOADTRACKER_H__
+
+#include <glib.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gsttransformer.pb.h"
+
+/**
+ * Tracks server load for load balancers polling GetLoad.
+ *
+ * Streams update counters as they run. The load is aggregated periodically
+ * on the main runloop so that serving it only copies the last aggregate.
+ */
+class LoadTracker
+{
+public:
+    /**
+     * Load accounting of a single stream, released when the stream ends.
+     */
+    class Stream
+    {
+    public:
+        ~Stream();
+
+        /**
+         * Report stream progress.
+         *
+         * \param processedTime seconds of media processed so far.
+         */
+        void progress(double processedTime);
+
+    private:
+        friend class LoadTracker;
+
+        LoadTracker *tracker;
+        std::string pipelineName;
+        std::atomic<double> processedTime;
+
+        Stream(LoadTracker *tracker, const std::string &pipelineName);
+    };
+
+    /**
+     * Construct a new tracker.
+     *
+     * \param intervalMilliseconds aggregation interval.
+     * \param maxStreams streams at which the server is saturated, 0 to use cpu only.
+     */
+    LoadTracker(unsigned int intervalMilliseconds, unsigned int maxStreams);
+    ~LoadTracker();
+
+    /**
+     * Set a function listing other processes doing work for this server,
+     * included in memory usage.
+     *
+     * \param processes function returning process IDs.
+     */
+    void setChildProcesses(const std::function<std::vector<pid_t>()> &processes);
+    /**
+     * Start aggregating.
+     */
+    void start();
+    /**
+     * Start accounting a stream.
+     *
+     * \param pipelineName predefined pipeline name, empty for dynamic pipelines.
+     * \return stream accounting, active until destroyed.
+     */
+    std::unique_ptr<Stream> begin(const std::string &pipelineName);
+    /**
+     * Get the last aggregated load.
+     *
+     * \param load filled with the load.
+     */
+    void getLoad(gst_transformer::service::LoadResponse &load);
+    /**
+     * Get the last aggregated load for reporting.
+     *
+     * \return formatted load.
+     */
+    std::string debugString();
+
+private:
+    unsigned int intervalMilliseconds;
+    unsigned int maxStreams;
+    std::function<std::vector<pid_t>()> childProcesses;
+    guint timer;
+
+    // guards streams and counters updated by streams
+    std::mutex lock;
+    std::set<Stream *> streams;
+    std::map<std::string, unsigned int> activeStreams;
+    // processed media of ended streams
+    double endedTime;
+
+    // aggregation state, used on the runloop only
+    std::chrono::steady_clock::time_point lastSample;
+    double lastProcessedTime;
+    unsigned long lastCpuBusy;
+    unsigned long lastCpuTotal;
+
+    std::mutex loadLock;
+    gst_transformer::service::LoadResponse load;
+
+    void aggregate();
+    static gboolean aggregateCallback(gpointer user_data);
+    static bool readCpuTimes(unsigned long &busy, unsigned long &total);
+    static unsigned long readResidentBytes(const std::string &statmPath);
+};
+
+#endif
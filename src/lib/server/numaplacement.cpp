@@ -0,0 +1,88 @@
+#include "numaplacement.h"
+#include "cpuaffinity.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <stdexcept>
+
+NumaPlacement::Lease::Lease(NumaPlacement *placement, size_t index)
+{
+    this->placement = placement;
+    this->index = index;
+}
+
+NumaPlacement::Lease::~Lease()
+{
+    this->placement->release(this->index);
+}
+
+int NumaPlacement::Lease::getNode() const
+{
+    return this->placement->slots[this->index].node;
+}
+
+const std::vector<int> & NumaPlacement::Lease::getCpus() const
+{
+    return this->placement->slots[this->index].cpus;
+}
+
+NumaPlacement::NumaPlacement(const std::vector<int> &reservedCpus, bool shardByNode)
+{
+    auto nodes = CpuAffinity::getNumaNodes();
+    for(auto &node : nodes) {
+        Slot slot;
+        slot.node = shardByNode ? node.first : -1;
+        slot.pipelines = 0;
+        for(auto cpu : node.second) {
+            if (std::find(reservedCpus.begin(), reservedCpus.end(), cpu) == reservedCpus.end())
+                slot.cpus.push_back(cpu);
+        }
+        if (slot.cpus.empty())
+            continue;
+
+        if (shardByNode || this->slots.empty())
+            this->slots.push_back(slot);
+        else
+            this->slots[0].cpus.insert(this->slots[0].cpus.end(), slot.cpus.begin(), slot.cpus.end());
+    }
+
+    if (this->slots.empty())
+        throw std::invalid_argument(fmt::format("no cpus left for pipelines after reserving {0}", CpuAffinity::formatCpuList(reservedCpus)));
+}
+
+std::unique_ptr<NumaPlacement::Lease> NumaPlacement::acquire()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    size_t index = 0;
+    for(size_t i=1; i<this->slots.size(); i++) {
+        if (this->slots[i].pipelines < this->slots[index].pipelines)
+            index = i;
+    }
+    this->slots[index].pipelines++;
+
+    return std::unique_ptr<Lease>(new Lease(this, index));
+}
+
+void NumaPlacement::release(size_t index)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    this->slots[index].pipelines--;
+}
+
+std::string NumaPlacement::debugString()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    std::string result;
+    for(auto &slot : this->slots) {
+        if (!result.empty())
+            result += ", ";
+        result += fmt::format("node {0} cpus {1}: {2} pipelines",
+            slot.node,
+            CpuAffinity::formatCpuList(slot.cpus),
+            slot.pipelines);
+    }
+
+    return result;
+}
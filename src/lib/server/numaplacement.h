@@ -0,0 +1,99 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __NUMAPLACEMENT_H__
+#define __NUMAPLACEMENT_H__
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * Assigns pipelines to CPU sets, either one per NUMA node or a single set
+ * of all CPUs, excluding CPUs reserved for control threads.
+ *
+ * New pipelines are placed on the set with the fewest active pipelines.
+ */
+class NumaPlacement
+{
+public:
+    /**
+     * A pipeline placement, released when destroyed.
+     */
+    class Lease
+    {
+    public:
+        ~Lease();
+
+        /**
+         * Get NUMA node of the placement.
+         *
+         * \return node, -1 if not sharded by node.
+         */
+        int getNode() const;
+        /**
+         * Get CPUs of the placement.
+         *
+         * \return CPU numbers.
+         */
+        const std::vector<int> & getCpus() const;
+
+    private:
+        friend class NumaPlacement;
+
+        NumaPlacement *placement;
+        size_t index;
+
+        Lease(NumaPlacement *placement, size_t index);
+    };
+
+    /**
+     * Construct a new placement.
+     *
+     * \param reservedCpus CPUs that pipelines must not use.
+     * \param shardByNode place pipelines on individual NUMA nodes.
+     */
+    NumaPlacement(const std::vector<int> &reservedCpus, bool shardByNode);
+
+    /**
+     * Place a new pipeline.
+     *
+     * \return placement lease.
+     */
+    std::unique_ptr<Lease> acquire();
+    /**
+     * Get current placement for reporting.
+     *
+     * \return placement string.
+     */
+    std::string debugString();
+
+private:
+    struct Slot
+    {
+        int node;
+        std::vector<int> cpus;
+        unsigned int pipelines;
+    };
+
+    std::mutex lock;
+    std::vector<Slot> slots;
+
+    void release(size_t index);
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "pacingscheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+const size_t PacingScheduler::WHEEL_SIZE = 512;
+
+PacingScheduler::PacingScheduler(unsigned int tickMilliseconds, unsigned int burstMilliseconds)
+{
+    this->tick = std::chrono::milliseconds(tickMilliseconds);
+    this->burst = (double)burstMilliseconds / 1000;
+    this->nextId = 1;
+    this->wheel.resize(WHEEL_SIZE);
+    this->cursor = 0;
+    this->timerCount = 0;
+    this->timer = 0;
+}
+
+PacingScheduler::~PacingScheduler()
+{
+    if (this->timer)
+        g_source_remove(this->timer);
+}
+
+unsigned long PacingScheduler::addStream(double rate, const std::function<void()> &release)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->lock);
+
+    auto id = this->nextId++;
+    auto &stream = this->streams[id];
+    stream.rate = rate;
+    stream.tokens = this->burst;
+    stream.releasedTime = 0;
+    stream.lastRefill = std::chrono::steady_clock::now();
+    stream.scheduled = false;
+    stream.release = release;
+
+    return id;
+}
+
+void PacingScheduler::removeStream(unsigned long id)
+{
+    // stale timers are skipped when they expire
+    std::lock_guard<std::recursive_mutex> lock(this->lock);
+    this->streams.erase(id);
+}
+
+double PacingScheduler::getAllowance(unsigned long id)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->lock);
+
+    auto iter = this->streams.find(id);
+    if (iter == this->streams.end())
+        return -1;
+
+    this->refill(iter->second);
+    return iter->second.releasedTime + iter->second.tokens;
+}
+
+void PacingScheduler::consume(unsigned long id, double mediaTime)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->lock);
+
+    auto iter = this->streams.find(id);
+    if (iter == this->streams.end())
+        return;
+
+    auto &stream = iter->second;
+    if (mediaTime > stream.releasedTime) {
+        this->refill(stream);
+        stream.tokens -= mediaTime - stream.releasedTime;
+        stream.releasedTime = mediaTime;
+    }
+}
+
+void PacingScheduler::schedule(unsigned long id, double mediaTime)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->lock);
+
+    auto iter = this->streams.find(id);
+    if (iter == this->streams.end())
+        return;
+
+    // media time is monotonic, an already scheduled wakeup is never later
+    auto &stream = iter->second;
+    if (stream.scheduled)
+        return;
+
+    this->refill(stream);
+    auto wait = std::max(0.0, (mediaTime - stream.releasedTime - stream.tokens) / stream.rate);
+    unsigned long ticks = std::max(1.0, std::ceil(wait * 1000 / this->tick.count()));
+
+    if (!this->timer) {
+        this->lastTick = std::chrono::steady_clock::now();
+        this->timer = g_timeout_add(this->tick.count(), tickCallback, this);
+    }
+
+    Timer timer;
+    timer.id = id;
+    timer.rounds = (ticks - 1) / WHEEL_SIZE;
+    this->wheel[(this->cursor + ticks) % WHEEL_SIZE].push_back(timer);
+    this->timerCount++;
+    stream.scheduled = true;
+}
+
+void PacingScheduler::refill(Stream &stream)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - stream.lastRefill).count();
+    stream.tokens = std::min(this->burst, stream.tokens + elapsed * stream.rate);
+    stream.lastRefill = now;
+}
+
+void PacingScheduler::advance(std::vector<unsigned long> &released)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto ticks = (now - this->lastTick) / this->tick;
+    this->lastTick += ticks * this->tick;
+
+    for(decltype(ticks) i=0; i<ticks && this->timerCount > 0; i++) {
+        this->cursor = (this->cursor + 1) % WHEEL_SIZE;
+
+        std::vector<Timer> slot;
+        slot.swap(this->wheel[this->cursor]);
+        for(auto &timer : slot) {
+            if (timer.rounds > 0) {
+                timer.rounds--;
+                this->wheel[this->cursor].push_back(timer);
+                continue;
+            }
+
+            this->timerCount--;
+            auto iter = this->streams.find(timer.id);
+            if (iter == this->streams.end())
+                continue;
+
+            iter->second.scheduled = false;
+            released.push_back(timer.id);
+        }
+    }
+}
+
+gboolean PacingScheduler::tickCallback(gpointer user_data)
+{
+    auto scheduler = static_cast<PacingScheduler *>(user_data);
+    std::vector<unsigned long> released;
+    auto result = G_SOURCE_CONTINUE;
+    {
+        std::lock_guard<std::recursive_mutex> lock(scheduler->lock);
+        scheduler->advance(released);
+        if (scheduler->timerCount == 0) {
+            scheduler->timer = 0;
+            result = G_SOURCE_REMOVE;
+        }
+    }
+
+    // release callbacks run unlocked, an earlier one may have removed a later stream
+    for(auto id : released) {
+        std::function<void()> release;
+        {
+            std::lock_guard<std::recursive_mutex> lock(scheduler->lock);
+            auto iter = scheduler->streams.find(id);
+            if (iter == scheduler->streams.end())
+                continue;
+            release = iter->second.release;
+        }
+        release();
+    }
+
+    return result;
+}
@@ -0,0 +1,121 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __PACINGSCHEDULER_H__
+#define __PACINGSCHEDULER_H__
+
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <glib.h>
+
+/**
+ * Server wide scheduler that paces output of many streams from a single
+ * timer wheel on the default runloop.
+ *
+ * Each stream has a token bucket in media time refilled at its target rate.
+ * Consumers release output up to the allowance, and schedule a wakeup for
+ * when the next held back sample is due.
+ */
+class PacingScheduler
+{
+public:
+    /**
+     * Construct a new scheduler.
+     *
+     * \param tickMilliseconds timer wheel resolution.
+     * \param burstMilliseconds maximum media time a stream can release ahead of its rate.
+     */
+    PacingScheduler(unsigned int tickMilliseconds, unsigned int burstMilliseconds);
+    ~PacingScheduler();
+
+    /**
+     * Add a stream to be paced.
+     *
+     * \param rate target rate, 1.0 is realtime.
+     * \param release function called on the runloop when a scheduled sample is due.
+     * \return stream id.
+     */
+    unsigned long addStream(double rate, const std::function<void()> &release);
+    /**
+     * Remove a stream. Once this returns, its release function will not be called.
+     *
+     * \param id stream id.
+     */
+    void removeStream(unsigned long id);
+    /**
+     * Get media time a stream is currently allowed to release up to.
+     *
+     * \param id stream id.
+     * \return media time in seconds.
+     */
+    double getAllowance(unsigned long id);
+    /**
+     * Record that a stream released output up to a media time.
+     *
+     * \param id stream id.
+     * \param mediaTime media time in seconds.
+     */
+    void consume(unsigned long id, double mediaTime);
+    /**
+     * Schedule a call to the stream release function when allowance
+     * reaches a media time.
+     *
+     * \param id stream id.
+     * \param mediaTime media time in seconds.
+     */
+    void schedule(unsigned long id, double mediaTime);
+
+private:
+    static const size_t WHEEL_SIZE;
+
+    struct Stream
+    {
+        double rate;
+        double tokens;
+        double releasedTime;
+        std::chrono::steady_clock::time_point lastRefill;
+        bool scheduled;
+        std::function<void()> release;
+    };
+
+    struct Timer
+    {
+        unsigned long id;
+        unsigned long rounds;
+    };
+
+    std::chrono::milliseconds tick;
+    double burst;
+    // recursive since release functions call back into the scheduler
+    std::recursive_mutex lock;
+    std::unordered_map<unsigned long, Stream> streams;
+    unsigned long nextId;
+    std::vector<std::vector<Timer>> wheel;
+    size_t cursor;
+    size_t timerCount;
+    std::chrono::steady_clock::time_point lastTick;
+    guint timer;
+
+    void refill(Stream &stream);
+    void advance(std::vector<unsigned long> &released);
+
+    static gboolean tickCallback(gpointer user_data);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "pipelinepool.h"
+
+#include <fmt/format.h>
+
+/**
+ * Forwards to a pooled pipeline and releases it when the request is done.
+ */
+class PipelinePool::PooledPipeline : public Pipeline
+{
+public:
+    PooledPipeline(PipelinePool *pool, const std::string &key, std::unique_ptr<DynamicPipeline> pipeline)
+    {
+        this->pool = pool;
+        this->key = key;
+        this->pipeline = std::move(pipeline);
+    }
+
+    ~PooledPipeline()
+    {
+        this->pool->release(this->key, std::move(this->pipeline));
+    }
+
+    void start(const std::function<void(bool)> &termination) override { this->pipeline->start(termination); }
+    void stop() override { this->pipeline->stop(); }
+    int addData(const char *buffer, int size) override { return this->pipeline->addData(buffer, size); }
+    void endData() override { this->pipeline->endData(); }
+    void waitUntilCompleted() override { this->pipeline->waitUntilCompleted(); }
+    PipelineTerminationReason getTerminationReason() const override { return this->pipeline->getTerminationReason(); }
+    std::string getTerminationMessage() const override { return this->pipeline->getTerminationMessage(); }
+    void setSampleAvailableCallback(const std::function<void()> &callback) override { this->pipeline->setSampleAvailableCallback(callback); }
+    void setNeedDataCallback(const std::function<void()> &callback) override { this->pipeline->setNeedDataCallback(callback); }
+    void setEnoughDataCallback(const std::function<void()> &callback) override { this->pipeline->setEnoughDataCallback(callback); }
+    void setEOSCallback(const std::function<void()> &callback) override { this->pipeline->setEOSCallback(callback); }
+    std::vector<std::string> getPendingSample(int count) override { return this->pipeline->getPendingSample(count); }
+    std::vector<std::string> getPendingSample(int count, double maxTime, double &endTime) override { return this->pipeline->getPendingSample(count, maxTime, endTime); }
+    double getNextSampleTime() override { return this->pipeline->getNextSampleTime(); }
+    unsigned long getProcessedInputBytes() const override { return this->pipeline->getProcessedInputBytes(); }
+    unsigned long getProcessedOutputBytes() const override { return this->pipeline->getProcessedOutputBytes(); }
+    double getProcessedTime() const override { return this->pipeline->getProcessedTime(); }
+    unsigned long getInputLevelBytes() const override { return this->pipeline->getInputLevelBytes(); }
+
+private:
+    PipelinePool *pool;
+    std::string key;
+    std::unique_ptr<DynamicPipeline> pipeline;
+};
+
+PipelinePool::PipelinePool(unsigned int maxIdle)
+{
+    this->maxIdle = maxIdle;
+    this->reused = 0;
+    this->created = 0;
+    this->discarded = 0;
+}
+
+PipelinePool::~PipelinePool()
+{
+}
+
+std::unique_ptr<DynamicPipeline> PipelinePool::acquire(const std::string &key)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    auto iter = this->idle.find(key);
+    if (iter == this->idle.end()) {
+        this->created++;
+        return nullptr;
+    }
+
+    auto pipeline = std::move(iter->second);
+    this->idle.erase(iter);
+    this->reused++;
+
+    return pipeline;
+}
+
+void PipelinePool::release(const std::string &key, std::unique_ptr<DynamicPipeline> pipeline)
+{
+    if (pipeline->reset()) {
+        std::unique_lock<std::mutex> lock(this->lock);
+        if (this->idle.size() < this->maxIdle) {
+            this->idle.emplace(key, std::move(pipeline));
+            return;
+        }
+        this->discarded++;
+    }
+
+    // destroyed outside the lock as it waits for the pipeline to stop
+    pipeline.reset();
+}
+
+std::unique_ptr<Pipeline> PipelinePool::lease(const std::string &key, std::unique_ptr<DynamicPipeline> pipeline)
+{
+    return std::unique_ptr<Pipeline>(new PooledPipeline(this, key, std::move(pipeline)));
+}
+
+std::string PipelinePool::debugString()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    return fmt::format("idle: {0}, maxIdle: {1}, reused: {2}, created: {3}, discarded: {4}",
+        this->idle.size(),
+        this->maxIdle,
+        this->reused,
+        this->created,
+        this->discarded);
+}
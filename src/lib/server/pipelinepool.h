@@ -0,0 +1,86 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __PIPELINEPOOL_H__
+#define __PIPELINEPOOL_H__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "dynamicpipeline.h"
+
+/**
+ * Keeps reusable pipelines PLAYING between requests.
+ *
+ * A pipeline that ended normally is rewound and parked under a key that
+ * identifies its specs and parameters. The next request with the same key
+ * starts on it as a new stream instead of building and prerolling a new one.
+ */
+class PipelinePool
+{
+public:
+    /**
+     * Construct a new pool.
+     *
+     * \param maxIdle maximum number of idle pipelines kept.
+     */
+    PipelinePool(unsigned int maxIdle);
+    ~PipelinePool();
+
+    /**
+     * Take an idle pipeline.
+     *
+     * \param key specs and parameters of the wanted pipeline.
+     * \return a pipeline ready to start, nullptr if none is idle.
+     */
+    std::unique_ptr<DynamicPipeline> acquire(const std::string &key);
+    /**
+     * Return a pipeline after use. It is destroyed instead if it cannot be
+     * rewound or the pool is full.
+     *
+     * \param key specs and parameters of the pipeline.
+     * \param pipeline the pipeline.
+     */
+    void release(const std::string &key, std::unique_ptr<DynamicPipeline> pipeline);
+    /**
+     * Wrap a pipeline so that it is released back to the pool when destroyed.
+     *
+     * \param key specs and parameters of the pipeline.
+     * \param pipeline the pipeline.
+     * \return pipeline to hand out to a request.
+     */
+    std::unique_ptr<Pipeline> lease(const std::string &key, std::unique_ptr<DynamicPipeline> pipeline);
+    /**
+     * Get current pool usage for reporting.
+     *
+     * \return formatted usage.
+     */
+    std::string debugString();
+
+private:
+    class PooledPipeline;
+
+    std::mutex lock;
+    unsigned int maxIdle;
+    std::multimap<std::string, std::unique_ptr<DynamicPipeline>> idle;
+    unsigned long reused;
+    unsigned long created;
+    unsigned long discarded;
+};
+
+#endif
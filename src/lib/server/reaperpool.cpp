@@ -0,0 +1,157 @@
+#include "reaperpool.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+
+const unsigned int ReaperPool::MAX_ABANDONED_WORKERS = 16;
+
+ReaperPool::ReaperPool(unsigned int threads, unsigned int timeoutMilliseconds, const std::function<void()> &stuck)
+{
+    this->state = std::make_shared<State>();
+    this->state->timeout = std::chrono::milliseconds(timeoutMilliseconds);
+    this->state->stopping = false;
+    this->state->completed = 0;
+    this->state->slow = 0;
+    this->state->abandoned = 0;
+    this->state->stuck = 0;
+    this->state->maxMilliseconds = 0;
+    this->stuckCallback = stuck;
+    this->stuckReported = false;
+
+    std::unique_lock<std::mutex> lock(this->state->lock);
+    for(unsigned int i=0; i<threads; i++)
+        this->startWorker();
+    this->watchdog = std::thread(&ReaperPool::watch, this);
+}
+
+ReaperPool::~ReaperPool()
+{
+    std::vector<std::shared_ptr<Worker>> workers;
+    {
+        std::unique_lock<std::mutex> lock(this->state->lock);
+        this->state->stopping = true;
+        this->state->cond.notify_all();
+        this->watchdogCond.notify_all();
+    }
+
+    this->watchdog.join();
+    // watchdog no longer replaces workers, abandoned ones are detached and hold their own state
+    workers = this->workers;
+    for(auto &worker : workers)
+        worker->thread.join();
+}
+
+void ReaperPool::submit(const std::function<void()> &teardown)
+{
+    std::unique_lock<std::mutex> lock(this->state->lock);
+    this->state->pending.push_back(teardown);
+    this->state->cond.notify_one();
+}
+
+void ReaperPool::startWorker()
+{
+    // called with lock held
+    auto worker = std::make_shared<Worker>();
+    worker->busy = false;
+    worker->abandoned = false;
+    worker->thread = std::thread(&ReaperPool::run, this->state, worker);
+    this->workers.push_back(worker);
+}
+
+void ReaperPool::run(std::shared_ptr<State> state, std::shared_ptr<Worker> worker)
+{
+    std::unique_lock<std::mutex> lock(state->lock);
+    while (true) {
+        while (!state->stopping && state->pending.empty())
+            state->cond.wait(lock);
+        // queued teardowns are still run when stopping
+        if (state->pending.empty())
+            break;
+
+        auto teardown = std::move(state->pending.front());
+        state->pending.pop_front();
+        worker->busy = true;
+        worker->started = std::chrono::steady_clock::now();
+
+        lock.unlock();
+        teardown();
+        // release captures within the measured time
+        teardown = nullptr;
+        lock.lock();
+
+        auto elapsed = std::chrono::steady_clock::now() - worker->started;
+        worker->busy = false;
+        state->completed++;
+        if (elapsed > state->timeout)
+            state->slow++;
+        state->maxMilliseconds = std::max(state->maxMilliseconds, std::chrono::duration<double, std::milli>(elapsed).count());
+
+        // replaced while stuck, the replacement serves the queue now
+        if (worker->abandoned) {
+            state->stuck--;
+            break;
+        }
+    }
+}
+
+void ReaperPool::watch()
+{
+    std::unique_lock<std::mutex> lock(this->state->lock);
+    auto interval = std::max(this->state->timeout / 2, std::chrono::milliseconds(100));
+    while (!this->state->stopping) {
+        this->watchdogCond.wait_for(lock, interval);
+        if (this->state->stopping)
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+        auto exhausted = false;
+        for(size_t i=0; i<this->workers.size(); i++) {
+            auto worker = this->workers[i];
+            if (!worker->busy || now - worker->started <= this->state->timeout)
+                continue;
+
+            // bound the number of leaked threads, the worker keeps its slot and the queue waits
+            if (this->state->stuck >= MAX_ABANDONED_WORKERS) {
+                exhausted = true;
+                continue;
+            }
+
+            worker->abandoned = true;
+            worker->thread.detach();
+            this->workers.erase(this->workers.begin() + i);
+            this->state->abandoned++;
+            this->state->stuck++;
+            this->startWorker();
+            // replacement was appended, revisit this index
+            i--;
+        }
+
+        if (exhausted && this->stuckCallback && !this->stuckReported) {
+            this->stuckReported = true;
+            lock.unlock();
+            this->stuckCallback();
+            lock.lock();
+        }
+    }
+}
+
+std::string ReaperPool::debugString()
+{
+    std::unique_lock<std::mutex> lock(this->state->lock);
+
+    auto busy = std::count_if(this->workers.begin(), this->workers.end(), [] (const std::shared_ptr<Worker> &worker) {
+        return worker->busy;
+    });
+    auto result = fmt::format("threads: {0}, busy: {1}, pending: {2}, completed: {3}, slow: {4}, abandoned: {5}, stuck: {6}, maxMillis: {7:.1f}",
+        this->workers.size(),
+        busy,
+        this->state->pending.size(),
+        this->state->completed,
+        this->state->slow,
+        this->state->abandoned,
+        this->state->stuck,
+        this->state->maxMilliseconds);
+    this->state->maxMilliseconds = 0;
+
+    return result;
+}
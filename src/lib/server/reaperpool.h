@@ -0,0 +1,116 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __REAPERPOOL_H__
+#define __REAPERPOOL_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads that tear down pipelines and finished calls away from the
+ * completion queue and runloop threads.
+ *
+ * Stopping a pipeline waits for its streaming threads, which can take long
+ * for heavy pipelines or never finish for broken ones. A teardown running
+ * longer than the timeout is counted as slow and its worker is abandoned:
+ * it is detached to finish on its own and replaced by a new worker, so that
+ * stuck teardowns never stall the ones queued behind them. Abandoned workers
+ * only share the queue and counters with the pool, which may be destroyed
+ * before they finish.
+ *
+ * At most MAX_ABANDONED_WORKERS can be abandoned at a time. Once reached,
+ * stuck workers are no longer replaced and the stuck callback, if set, is
+ * called as the last resort, e.g. to exit a worker process so that its
+ * stuck pipelines are killed with it.
+ */
+class ReaperPool
+{
+public:
+    /**
+     * Construct a new pool and start its threads.
+     *
+     * \param threads number of worker threads.
+     * \param timeoutMilliseconds time after which a teardown is considered stuck.
+     * \param stuck called once on the watchdog thread when too many workers are stuck, may be null.
+     */
+    ReaperPool(unsigned int threads, unsigned int timeoutMilliseconds, const std::function<void()> &stuck = nullptr);
+    /**
+     * Stop the pool after running queued teardowns. Abandoned workers are not waited for.
+     */
+    ~ReaperPool();
+
+    /**
+     * Queue a teardown. Objects captured by the function are released on the
+     * worker thread right after it returns.
+     *
+     * \param teardown function to run on a worker thread.
+     */
+    void submit(const std::function<void()> &teardown);
+    /**
+     * Get current pool usage for reporting. Maximum teardown time is reset with each call.
+     *
+     * \return formatted usage.
+     */
+    std::string debugString();
+
+private:
+    static const unsigned int MAX_ABANDONED_WORKERS;
+
+    struct Worker
+    {
+        std::thread thread;
+        bool busy;
+        bool abandoned;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    // held by worker threads, abandoned ones may outlive the pool
+    struct State
+    {
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<std::function<void()>> pending;
+        std::chrono::milliseconds timeout;
+        bool stopping;
+        unsigned long completed;
+        unsigned long slow;
+        unsigned long abandoned;
+        // abandoned workers still running their teardown
+        unsigned int stuck;
+        double maxMilliseconds;
+    };
+
+    std::shared_ptr<State> state;
+    std::vector<std::shared_ptr<Worker>> workers;
+    std::condition_variable watchdogCond;
+    std::thread watchdog;
+    std::function<void()> stuckCallback;
+    bool stuckReported;
+
+    void startWorker();
+    static void run(std::shared_ptr<State> state, std::shared_ptr<Worker> worker);
+    void watch();
+};
+
+#endif
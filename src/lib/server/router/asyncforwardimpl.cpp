@@ -0,0 +1,280 @@
+#include "asyncforwardimpl.h"
+
+#include <fmt/format.h>
+
+#include "gsttransformer.grpc.pb.h"
+
+namespace gst_transformer {
+namespace service {
+
+const std::string AsyncForwardImpl::SERVICE_PREFIX = "/gst_transformer.service.GstTransformer/";
+const std::string AsyncForwardImpl::TRANSFORM_METHOD = "/gst_transformer.service.GstTransformer/Transform";
+const std::string AsyncForwardImpl::GET_LOAD_METHOD = "/gst_transformer.service.GstTransformer/GetLoad";
+
+// transport headers are regenerated by each hop
+static bool isForwardedHeader(const ::grpc::string_ref &key)
+{
+    return !key.starts_with("grpc-") &&
+        !key.starts_with(":") &&
+        key != "user-agent" &&
+        key != "content-type" &&
+        key != "te";
+}
+
+AsyncForwardImpl::AsyncForwardImpl(const AsyncRouterResources *resources)
+    : downstream(&this->serverContext)
+{
+    this->resources = resources;
+    this->globalLogger = resources->globalLogger;
+    this->selector = resources->selector;
+    this->backend = nullptr;
+    this->setup();
+}
+
+AsyncForwardImpl::~AsyncForwardImpl()
+{
+    this->globalLogger->trace("AsyncForwardImpl destructor called");
+
+    if (this->backend)
+        this->selector->release(this->backend);
+}
+
+void AsyncForwardImpl::setup()
+{
+    this->pending = 0;
+    this->headersForwarded = false;
+    this->downstreamBroken = false;
+    this->upstreamFinished = false;
+    this->finished = false;
+    this->cancelled = false;
+
+    this->requestFunction = [&] (bool ok) {
+        if (!ok) {
+            this->globalLogger->debug("AsyncForwardImpl requestFunction ok is false, quitting");
+            delete this;
+            return;
+        }
+
+        new AsyncForwardImpl(this->resources);
+
+        if (this->serverContext.method().compare(0, SERVICE_PREFIX.size(), SERVICE_PREFIX) != 0) {
+            this->finish(::grpc::Status(
+                ::grpc::StatusCode::UNIMPLEMENTED,
+                fmt::format("unknown method {0}", this->serverContext.method())));
+            return;
+        }
+
+        // the router answers for all of its backends
+        if (this->serverContext.method() == GET_LOAD_METHOD) {
+            LoadResponse load;
+            this->selector->getLoad(load);
+            bool ownBuffer;
+            ::grpc::SerializationTraits<LoadResponse>::Serialize(load, &this->response, &ownBuffer);
+            this->pending++;
+            this->downstream.WriteAndFinish(this->response, ::grpc::WriteOptions(), ::grpc::Status::OK, &this->downstreamFinishFunction);
+            return;
+        }
+
+        // only the first message is needed to choose a backend
+        this->pending++;
+        this->downstream.Read(&this->request, &this->firstReadFunction);
+    };
+
+    this->firstReadFunction = [&] (bool ok) {
+        this->pending--;
+        this->startUpstream(ok);
+        this->completed();
+    };
+
+    this->upstreamStartFunction = [&] (bool ok) {
+        this->pending--;
+        // a failed start surfaces through the upstream read and finish
+        this->completed();
+    };
+
+    this->downstreamReadFunction = [&] (bool ok) {
+        this->pending--;
+        if (this->upstreamFinished) {
+            this->completed();
+            return;
+        }
+
+        if (ok) {
+            this->pending++;
+            this->upstream->Write(this->request, &this->upstreamWriteFunction);
+        }
+        else if (!this->cancelled) {
+            // the client may also have cancelled, the done tag then cancels the backend call
+            this->pending++;
+            this->upstream->WritesDone(&this->upstreamWritesDoneFunction);
+        }
+        this->completed();
+    };
+
+    this->upstreamWriteFunction = [&] (bool ok) {
+        this->pending--;
+        // on failure stop reading, the backend status is relayed on finish
+        if (ok && !this->upstreamFinished) {
+            this->pending++;
+            this->downstream.Read(&this->request, &this->downstreamReadFunction);
+        }
+        this->completed();
+    };
+
+    this->upstreamWritesDoneFunction = [&] (bool ok) {
+        this->pending--;
+        this->completed();
+    };
+
+    this->upstreamReadFunction = [&] (bool ok) {
+        this->pending--;
+        if (!ok) {
+            this->pending++;
+            this->upstream->Finish(&this->status, &this->upstreamFinishFunction);
+            this->completed();
+            return;
+        }
+
+        if (this->downstreamBroken) {
+            // drain until the cancellation completes the call
+            this->pending++;
+            this->upstream->Read(&this->response, &this->upstreamReadFunction);
+            this->completed();
+            return;
+        }
+
+        if (!this->headersForwarded) {
+            for(auto &header : this->clientContext.GetServerInitialMetadata()) {
+                if (isForwardedHeader(header.first)) {
+                    this->serverContext.AddInitialMetadata(
+                        std::string(header.first.data(), header.first.size()),
+                        std::string(header.second.data(), header.second.size()));
+                }
+            }
+            this->headersForwarded = true;
+        }
+
+        this->pending++;
+        this->downstream.Write(this->response, &this->downstreamWriteFunction);
+        this->completed();
+    };
+
+    this->downstreamWriteFunction = [&] (bool ok) {
+        this->pending--;
+        if (!ok) {
+            this->globalLogger->debug("client went away, cancelling backend call");
+            this->downstreamBroken = true;
+            this->clientContext.TryCancel();
+        }
+
+        this->pending++;
+        this->upstream->Read(&this->response, &this->upstreamReadFunction);
+        this->completed();
+    };
+
+    this->upstreamFinishFunction = [&] (bool ok) {
+        this->pending--;
+        this->upstreamFinished = true;
+        if (!this->status.ok()) {
+            this->globalLogger->debug("backend {0} finished {1} with status {2}: {3}",
+                this->backend->endpoint,
+                this->serverContext.method(),
+                (int)this->status.error_code(),
+                this->status.error_message());
+        }
+
+        for(auto &header : this->clientContext.GetServerTrailingMetadata()) {
+            if (isForwardedHeader(header.first)) {
+                this->serverContext.AddTrailingMetadata(
+                    std::string(header.first.data(), header.first.size()),
+                    std::string(header.second.data(), header.second.size()));
+            }
+        }
+        this->finish(this->status);
+        this->completed();
+    };
+
+    this->downstreamFinishFunction = [&] (bool ok) {
+        this->pending--;
+        this->finished = true;
+        this->completed();
+    };
+
+    this->doneFunction = [&] (bool ok) {
+        this->pending--;
+        if (this->serverContext.IsCancelled() && !this->upstreamFinished) {
+            // do not let the backend decode the rest of the stream for nobody
+            this->globalLogger->debug("client cancelled, cancelling backend call");
+            this->cancelled = true;
+            this->downstreamBroken = true;
+            this->clientContext.TryCancel();
+        }
+        this->completed();
+    };
+
+    this->pending++;
+    this->serverContext.AsyncNotifyWhenDone(&this->doneFunction);
+
+    this->resources->service->RequestCall(
+        &this->serverContext,
+        &this->downstream,
+        this->resources->completionQueue,
+        this->resources->completionQueue,
+        &this->requestFunction);
+}
+
+void AsyncForwardImpl::startUpstream(bool hasRequest)
+{
+    std::string pipelineName;
+    if (hasRequest && this->serverContext.method() == TRANSFORM_METHOD) {
+        // deserializing consumes the buffer, parse a copy
+        ::grpc::ByteBuffer copy(this->request);
+        TransformRequest transformRequest;
+        if (::grpc::SerializationTraits<TransformRequest>::Deserialize(&copy, &transformRequest).ok())
+            pipelineName = transformRequest.config().pipeline_name();
+    }
+
+    this->backend = this->selector->select(pipelineName);
+    SPDLOG_LOGGER_TRACE(this->globalLogger, "routing {0} pipeline {1} to {2}",
+        this->serverContext.method(), pipelineName, this->backend->endpoint);
+
+    for(auto &header : this->serverContext.client_metadata()) {
+        if (isForwardedHeader(header.first)) {
+            this->clientContext.AddMetadata(
+                std::string(header.first.data(), header.first.size()),
+                std::string(header.second.data(), header.second.size()));
+        }
+    }
+    this->clientContext.set_deadline(this->serverContext.deadline());
+
+    this->upstream = this->backend->stub->PrepareCall(
+        &this->clientContext,
+        this->serverContext.method(),
+        this->resources->completionQueue);
+    this->pending++;
+    this->upstream->StartCall(&this->upstreamStartFunction);
+
+    this->pending++;
+    this->upstream->Read(&this->response, &this->upstreamReadFunction);
+
+    this->pending++;
+    if (hasRequest)
+        this->upstream->Write(this->request, &this->upstreamWriteFunction);
+    else
+        this->upstream->WritesDone(&this->upstreamWritesDoneFunction);
+}
+
+void AsyncForwardImpl::finish(const ::grpc::Status &status)
+{
+    this->pending++;
+    this->downstream.Finish(status, &this->downstreamFinishFunction);
+}
+
+void AsyncForwardImpl::completed()
+{
+    if (this->finished && this->pending == 0)
+        delete this;
+}
+
+}
+}
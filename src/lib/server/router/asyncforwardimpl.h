@@ -0,0 +1,91 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCFORWARDIMPL_H__
+#define __ASYNCFORWARDIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <grpc++/generic/async_generic_service.h>
+#include <grpc++/generic/generic_stub.h>
+#include <spdlog/spdlog.h>
+#include <functional>
+
+#include "asyncrouterimpl.h"
+#include "backendselector.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Forward one call to a backend, relaying serialized messages in both
+ * directions without parsing them, except the first Transform request
+ * whose pipeline name is used for backend affinity.
+ */
+class AsyncForwardImpl
+{
+public:
+    AsyncForwardImpl(const AsyncRouterResources *resources);
+    ~AsyncForwardImpl();
+
+private:
+    static const std::string SERVICE_PREFIX;
+    static const std::string TRANSFORM_METHOD;
+    static const std::string GET_LOAD_METHOD;
+
+    const AsyncRouterResources *resources;
+    std::shared_ptr<spdlog::logger> globalLogger;
+    BackendSelector *selector;
+    BackendSelector::Backend *backend;
+
+    ::grpc::GenericServerContext serverContext;
+    ::grpc::GenericServerAsyncReaderWriter downstream;
+    ::grpc::ClientContext clientContext;
+    std::unique_ptr<::grpc::GenericClientAsyncReaderWriter> upstream;
+
+    std::function<void(bool)> requestFunction;
+    std::function<void(bool)> firstReadFunction;
+    std::function<void(bool)> upstreamStartFunction;
+    std::function<void(bool)> downstreamReadFunction;
+    std::function<void(bool)> upstreamWriteFunction;
+    std::function<void(bool)> upstreamWritesDoneFunction;
+    std::function<void(bool)> upstreamReadFunction;
+    std::function<void(bool)> downstreamWriteFunction;
+    std::function<void(bool)> upstreamFinishFunction;
+    std::function<void(bool)> downstreamFinishFunction;
+    // delivered once the client call is done, including when it is cancelled
+    std::function<void(bool)> doneFunction;
+
+    ::grpc::ByteBuffer request;
+    ::grpc::ByteBuffer response;
+    ::grpc::Status status;
+    // operations started and not yet completed
+    int pending;
+    bool headersForwarded;
+    bool downstreamBroken;
+    bool upstreamFinished;
+    bool finished;
+    bool cancelled;
+
+    void setup();
+    void startUpstream(bool hasRequest);
+    void finish(const ::grpc::Status &status);
+    void completed();
+};
+
+}
+}
+
+#endif
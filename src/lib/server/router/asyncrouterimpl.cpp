@@ -0,0 +1,69 @@
+#include "asyncrouterimpl.h"
+#include "asyncforwardimpl.h"
+#include <spdlog/sinks/stdout_sinks.h>
+
+#include <functional>
+
+namespace gst_transformer {
+namespace service {
+
+const unsigned int AsyncRouterImpl::DEFAULT_AFFINITY_SLACK = 4;
+const unsigned int AsyncRouterImpl::DEFAULT_LOAD_SAMPLE_MILLIS = 1000;
+
+AsyncRouterImpl::AsyncRouterImpl(
+    ::grpc::AsyncGenericService *service,
+    ::grpc::ServerCompletionQueue *completionQueue,
+    const ServiceParametersStruct &params)
+{
+    this->globalLogger = spdlog::stderr_logger_mt("asyncrouterimpl");
+    this->completionQueue = completionQueue;
+
+    std::vector<std::string> endpoints(params.router_backends().begin(), params.router_backends().end());
+    this->selector.reset(new BackendSelector(
+        endpoints,
+        params.router_affinity_slack() ? params.router_affinity_slack() : DEFAULT_AFFINITY_SLACK,
+        params.load_sample_millis() ? params.load_sample_millis() : DEFAULT_LOAD_SAMPLE_MILLIS));
+
+    this->resources.globalLogger = this->globalLogger;
+    this->resources.selector = this->selector.get();
+    this->resources.service = service;
+    this->resources.completionQueue = this->completionQueue;
+
+    if (params.stats_interval_millis()) {
+        this->statsReporter.reset(new StatsReporter(this->globalLogger, params.stats_interval_millis()));
+        auto selector = this->selector.get();
+        this->statsReporter->addSource("router", [selector] {
+            return selector->debugString();
+        });
+        this->statsReporter->start();
+    }
+}
+
+AsyncRouterImpl::~AsyncRouterImpl()
+{
+}
+
+void AsyncRouterImpl::start()
+{
+    new AsyncForwardImpl(&this->resources);
+
+    // backend calls complete on the same queue
+    void* tag;
+    bool ok;
+    bool shutdown = false;
+    while (!shutdown) {
+        shutdown = !this->completionQueue->Next(&tag, &ok);
+        if (!shutdown) {
+            auto func = *static_cast<std::function<void(bool)>*>(tag);
+            func(ok);
+        }
+    }
+}
+
+void AsyncRouterImpl::stop()
+{
+    this->completionQueue->Shutdown();
+}
+
+}
+}
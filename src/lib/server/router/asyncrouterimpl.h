@@ -0,0 +1,72 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __ASYNCROUTERIMPL_H__
+#define __ASYNCROUTERIMPL_H__
+
+#include <grpc++/grpc++.h>
+#include <grpc++/generic/async_generic_service.h>
+#include <spdlog/spdlog.h>
+
+#include "serviceparameters.pb.h"
+#include "backendselector.h"
+#include "../statsreporter.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Router wide objects shared by all forwarded calls.
+ */
+struct AsyncRouterResources
+{
+    std::shared_ptr<spdlog::logger> globalLogger;
+    BackendSelector *selector;
+    ::grpc::AsyncGenericService *service;
+    ::grpc::ServerCompletionQueue *completionQueue;
+};
+
+/**
+ * Front end forwarding calls to backend service instances without
+ * running any pipelines itself.
+ */
+class AsyncRouterImpl
+{
+public:
+    AsyncRouterImpl(
+        ::grpc::AsyncGenericService *service,
+        ::grpc::ServerCompletionQueue *completionQueue,
+        const ServiceParametersStruct &params);
+    ~AsyncRouterImpl();
+
+    void start();
+    void stop();
+
+private:
+    static const unsigned int DEFAULT_AFFINITY_SLACK;
+    static const unsigned int DEFAULT_LOAD_SAMPLE_MILLIS;
+
+    std::shared_ptr<spdlog::logger> globalLogger;
+    ::grpc::ServerCompletionQueue *completionQueue;
+    std::unique_ptr<BackendSelector> selector;
+    std::unique_ptr<StatsReporter> statsReporter;
+    AsyncRouterResources resources;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,184 @@
+#include "backendselector.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace gst_transformer {
+namespace service {
+
+const size_t BackendSelector::MAX_AFFINITY_ENTRIES = 1024;
+
+BackendSelector::BackendSelector(const std::vector<std::string> &endpoints, unsigned int affinitySlack, unsigned int pollMilliseconds)
+{
+    if (endpoints.empty())
+        throw std::invalid_argument("router requires at least one backend");
+
+    for(auto &endpoint : endpoints) {
+        auto backend = std::unique_ptr<Backend>(new Backend());
+        backend->endpoint = endpoint;
+        auto channel = ::grpc::CreateChannel(endpoint, ::grpc::InsecureChannelCredentials());
+        backend->stub.reset(new ::grpc::GenericStub(channel));
+        backend->loadStub = GstTransformer::NewStub(channel);
+        backend->activeCalls = 0;
+        backend->routedCalls = 0;
+        backend->reported = false;
+        this->backends.push_back(std::move(backend));
+    }
+    this->affinitySlack = affinitySlack;
+    this->nextIndex = 0;
+    this->affinityHits = 0;
+    this->affinityMisses = 0;
+    this->pollMilliseconds = pollMilliseconds;
+    this->stopping = false;
+    this->poller = std::thread([this] {
+        this->poll();
+    });
+}
+
+BackendSelector::~BackendSelector()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        this->stopping = true;
+        this->pollCond.notify_all();
+    }
+    this->poller.join();
+}
+
+BackendSelector::Backend * BackendSelector::select(const std::string &pipelineName)
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    // saturated and unreported backends only take calls when all of them are
+    Backend *least = nullptr;
+    for(size_t i=0; i<this->backends.size(); i++) {
+        auto backend = this->backends[(this->nextIndex + i) % this->backends.size()].get();
+        if (!least ||
+            this->getPriority(backend) < this->getPriority(least) ||
+            (this->getPriority(backend) == this->getPriority(least) && this->getLoad(backend) < this->getLoad(least)))
+            least = backend;
+    }
+    this->nextIndex++;
+
+    auto selected = least;
+    if (!pipelineName.empty()) {
+        auto iterator = this->affinity.find(pipelineName);
+        if (iterator != this->affinity.end() &&
+            this->getPriority(iterator->second) <= this->getPriority(least) &&
+            this->getLoad(iterator->second) <= this->getLoad(least) + this->affinitySlack) {
+            selected = iterator->second;
+            this->affinityHits++;
+        }
+        else {
+            // names are client supplied, bound the map
+            if (this->affinity.size() >= MAX_AFFINITY_ENTRIES)
+                this->affinity.clear();
+            this->affinity[pipelineName] = least;
+            this->affinityMisses++;
+        }
+    }
+
+    selected->activeCalls++;
+    selected->routedCalls++;
+    return selected;
+}
+
+void BackendSelector::release(Backend *backend)
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    backend->activeCalls--;
+}
+
+void BackendSelector::getLoad(LoadResponse &load)
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    load.Clear();
+    load.set_sample_interval_millis(this->pollMilliseconds);
+    double headroom = 0;
+    unsigned int reported = 0;
+    for(auto &backend : this->backends) {
+        if (!backend->reported)
+            continue;
+
+        for(auto &active : backend->load.active_streams())
+            (*load.mutable_active_streams())[active.first] += active.second;
+        load.set_total_streams(load.total_streams() + backend->load.total_streams());
+        load.set_realtime_factor(load.realtime_factor() + backend->load.realtime_factor());
+        // backends share the host
+        load.set_cpu_utilization(std::max(load.cpu_utilization(), backend->load.cpu_utilization()));
+        load.set_memory_bytes(load.memory_bytes() + backend->load.memory_bytes());
+        headroom += backend->load.headroom();
+        reported++;
+    }
+    load.set_headroom(reported ? headroom / reported : 0);
+}
+
+std::string BackendSelector::debugString()
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    std::string backends;
+    for(auto &backend : this->backends) {
+        backends += fmt::format("{0}{1}: active {2}, routed {3}, reported {4}, headroom {5:.2f}",
+            backends.empty() ? "" : ", ",
+            backend->endpoint,
+            backend->activeCalls,
+            backend->routedCalls,
+            backend->reported ? (int)backend->load.total_streams() : -1,
+            backend->load.headroom());
+    }
+
+    return fmt::format("affinityHits: {0}, affinityMisses: {1}, {2}",
+        this->affinityHits,
+        this->affinityMisses,
+        backends);
+}
+
+void BackendSelector::poll()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (!this->stopping) {
+        for(auto &backend : this->backends) {
+            auto stub = backend->loadStub.get();
+            lock.unlock();
+
+            ::grpc::ClientContext context;
+            context.set_deadline(std::chrono::system_clock::now() + std::chrono::milliseconds(this->pollMilliseconds));
+            LoadResponse load;
+            auto status = stub->GetLoad(&context, LoadRequest(), &load);
+
+            lock.lock();
+            // unreachable backends fall back to the calls routed here
+            backend->reported = status.ok();
+            if (status.ok())
+                backend->load.Swap(&load);
+            if (this->stopping)
+                return;
+        }
+        this->pollCond.wait_for(lock, std::chrono::milliseconds(this->pollMilliseconds));
+    }
+}
+
+double BackendSelector::getLoad(const Backend *backend) const
+{
+    if (!backend->reported)
+        return backend->activeCalls;
+
+    // reported load lags behind calls routed since the last poll, count them as realtime streams
+    auto routed = backend->activeCalls > backend->load.total_streams() ? backend->activeCalls - backend->load.total_streams() : 0;
+    return (backend->load.realtime_factor() + routed) * (1 + backend->load.cpu_utilization());
+}
+
+int BackendSelector::getPriority(const Backend *backend) const
+{
+    // a backend that fails its load poll likely fails calls too, and looks idle while doing so
+    if (!backend->reported)
+        return 2;
+    return backend->load.headroom() <= 0 ? 1 : 0;
+}
+
+}
+}
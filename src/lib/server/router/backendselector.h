@@ -0,0 +1,124 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __BACKENDSELECTOR_H__
+#define __BACKENDSELECTOR_H__
+
+#include <grpc++/grpc++.h>
+#include <grpc++/generic/generic_stub.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gsttransformer.grpc.pb.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Chooses the backend instance for each routed call.
+ *
+ * Calls go to the least loaded backend. Calls for a named pipeline prefer
+ * the backend that last served it, where its pool is likely to be warm,
+ * unless that backend is loaded more than a slack above the least loaded.
+ * Backends are polled for their load, which covers calls not routed
+ * through this router. Load is the media seconds processed per second,
+ * weighted by cpu utilization, with calls routed since the last poll
+ * counted as realtime streams. Backends without headroom are avoided, and
+ * backends that do not report their load, e.g. unreachable ones, are only
+ * chosen when none reports.
+ */
+class BackendSelector
+{
+public:
+    struct Backend
+    {
+        std::string endpoint;
+        std::unique_ptr<::grpc::GenericStub> stub;
+        std::unique_ptr<GstTransformer::Stub> loadStub;
+        // calls currently routed to the backend
+        unsigned int activeCalls;
+        unsigned long routedCalls;
+        // last polled load, valid when reported
+        bool reported;
+        LoadResponse load;
+    };
+
+    /**
+     * Construct a new selector and connect to the backends.
+     *
+     * \param endpoints gRPC endpoints of the backends.
+     * \param affinitySlack additional load accepted to keep pipeline affinity, in realtime streams.
+     * \param pollMilliseconds interval of backend load polling.
+     */
+    BackendSelector(const std::vector<std::string> &endpoints, unsigned int affinitySlack, unsigned int pollMilliseconds);
+    ~BackendSelector();
+
+    /**
+     * Choose a backend for a new call and count it as active.
+     *
+     * \param pipelineName pipeline name of the call, empty if none.
+     * \return chosen backend.
+     */
+    Backend * select(const std::string &pipelineName);
+    /**
+     * Count a call as no longer active.
+     *
+     * \param backend backend returned by select().
+     */
+    void release(Backend *backend);
+    /**
+     * Get the combined load of all backends.
+     *
+     * \param load filled with the load.
+     */
+    void getLoad(LoadResponse &load);
+    /**
+     * Get current routing state for reporting.
+     *
+     * \return formatted state.
+     */
+    std::string debugString();
+
+private:
+    static const size_t MAX_AFFINITY_ENTRIES;
+
+    std::mutex lock;
+    std::vector<std::unique_ptr<Backend>> backends;
+    std::map<std::string, Backend *> affinity;
+    unsigned int affinitySlack;
+    // rotates among equally loaded backends
+    size_t nextIndex;
+    unsigned long affinityHits;
+    unsigned long affinityMisses;
+    unsigned int pollMilliseconds;
+    std::condition_variable pollCond;
+    bool stopping;
+    std::thread poller;
+
+    void poll();
+    double getLoad(const Backend *backend) const;
+    int getPriority(const Backend *backend) const;
+};
+
+}
+}
+
+#endif
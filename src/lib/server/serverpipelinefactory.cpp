@@ -1,18 +1,27 @@
 #include "serverpipelinefactory.h"
 #include "dynamicpipeline.h"
+#include "worker/workerpool.h"
+#include "requestlogger.h"
 
 namespace gst_transformer {
 namespace service {
 
-ServerPipelineFactory::ServerPipelineFactory(const ServiceParametersStruct &serviceParams)
+ServerPipelineFactory::ServerPipelineFactory(const ServiceParametersStruct &serviceParams, PipelinePool *pool, WorkerPool *workers)
 {
     this->serviceParams = serviceParams;
+    this->pool = pool;
+    this->workers = workers;
 }
  
-std::unique_ptr<Pipeline> ServerPipelineFactory::get(const std::string &requestId, const TransformConfig &config)
+std::unique_ptr<Pipeline> ServerPipelineFactory::get(const std::string &requestId, const TransformConfig &config, const NumaPlacement::Lease *placement)
 {
+    // the worker builds the pipeline from the same config with its own factory
+    if (this->workers)
+        return this->workers->create(requestId, config);
+
     auto requestedParams = config.pipeline_parameters();
     ::PipelineParameters params;
+    params.setBatchedSampleNotifications(true);
 
     if (requestedParams.rate())
         params.setRate(requestedParams.rate());
@@ -23,6 +32,25 @@ std::unique_ptr<Pipeline> ServerPipelineFactory::get(const std::string &requestI
 
     if (requestedParams.read_timeout_milliseconds())
         params.setReadTimeoutMilliseconds(requestedParams.read_timeout_milliseconds());
+
+    if (requestedParams.input_buffer_bytes())
+        params.setInputBufferSize(requestedParams.input_buffer_bytes());
+    if (requestedParams.input_buffer_milliseconds())
+        params.setInputBufferTimeMilliseconds(requestedParams.input_buffer_milliseconds());
+
+    params.setOutputOverflowPolicy((::OutputOverflowPolicy)requestedParams.output_overflow_policy());
+    if (requestedParams.output_spill_threshold_bytes())
+        params.setSpillThresholdBytes(requestedParams.output_spill_threshold_bytes());
+    params.setSpillQuotaBytes(this->serviceParams.max_spill_bytes());
+    params.setSpillDirectory(this->serviceParams.spill_directory());
+
+    params.setSharedTaskPool(this->serviceParams.shared_task_pool());
+    params.setPooledInputBuffers(this->serviceParams.pooled_input_buffers());
+    if (placement) {
+        params.setCpuAffinity(placement->getCpus());
+        params.setNumaNode(placement->getNode());
+    }
+    params.setExternalPacing(this->serviceParams.centralized_pacing() && params.getRate() > 0);
  
     std::unique_ptr<Pipeline> pipeline;
     if (!config.pipeline_name().empty() && !config.pipeline().empty())
@@ -43,6 +71,25 @@ std::unique_ptr<Pipeline> ServerPipelineFactory::get(const std::string &requestI
         auto iter = this->serviceParams.pipelines().find(config.pipeline_name());
         if (iter == this->serviceParams.pipelines().end())
             throw std::invalid_argument(fmt::format("pipeline name '{0}' not defined", config.pipeline_name()));
+
+        if (this->pool && iter->second.reusable()) {
+            // only pipelines with identical parameters can take over each other's streams
+            params.setReusable(true);
+            auto key = fmt::format("{0}/{1}", config.pipeline_name(), params.debugString());
+            auto pooled = this->pool->acquire(key);
+            if (!pooled) {
+                pooled.reset(DynamicPipeline::createFromSpecs(
+                    params,
+                    requestId,
+                    iter->second.specs()));
+            }
+            else {
+                // log under the request now running on it
+                pooled->setLogger(RequestLogger::shared()->get("dynamicpipeline", requestId));
+            }
+
+            return this->pool->lease(key, std::move(pooled));
+        }
         
         pipeline.reset(DynamicPipeline::createFromSpecs(
             params, 
@@ -20,10 +20,14 @@ all copies or substantial portions of the Software.
 #include "pipeline.h"
 #include "gsttransformer.pb.h"
 #include "serviceparameters.pb.h"
+#include "numaplacement.h"
+#include "pipelinepool.h"
 
 namespace gst_transformer {
 namespace service {
 
+class WorkerPool;
+
 /**
  * Factory class to create pipelines from gst-launch specs.
  * It also handles predefined pipelines that can be referenced by name.
@@ -35,20 +39,25 @@ public:
      * Construct a new factory.
      * 
      * \param: serviceParams Service parameters used when creating pipelines.
+     * \param: pool optional pool to reuse pipelines predefined as reusable.
+     * \param: workers optional worker processes to run pipelines in.
      */
-    ServerPipelineFactory(const ServiceParametersStruct &serviceParams);
+    ServerPipelineFactory(const ServiceParametersStruct &serviceParams, PipelinePool *pool = nullptr, WorkerPool *workers = nullptr);
     /**
      * Obtain a pipeline instance. It can be a predefined pipeline, or a dynamic
      * one created from gst specs in the request config.
      * 
      * \param requestId the request ID for logging.
      * \param config request parameters.
+     * \param placement optional cpu placement for the pipeline streaming threads.
      * \return a pipeline instance ready for use.
      */
-    std::unique_ptr<Pipeline> get(const std::string &requestId, const TransformConfig &config);
+    std::unique_ptr<Pipeline> get(const std::string &requestId, const TransformConfig &config, const NumaPlacement::Lease *placement = nullptr);
 
 private:
     ServiceParametersStruct serviceParams;
+    PipelinePool *pool;
+    WorkerPool *workers;
 };
 
 }
@@ -0,0 +1,115 @@
+#include "setuppool.h"
+
+#include <fmt/format.h>
+#include <algorithm>
+
+const size_t SetupPool::MAX_SETUP_TIME_ENTRIES = 1024;
+const double SetupPool::SETUP_TIME_WEIGHT = 0.2;
+
+SetupPool::SetupPool(unsigned int threads, unsigned int maxPending)
+{
+    this->maxPending = maxPending;
+    this->stopping = false;
+    this->busy = 0;
+    this->completed = 0;
+    this->rejected = 0;
+    this->totalWaitMilliseconds = 0;
+    this->maxWaitMilliseconds = 0;
+
+    for(unsigned int i=0; i<threads; i++)
+        this->threads.push_back(std::thread(&SetupPool::run, this));
+}
+
+SetupPool::~SetupPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(this->lock);
+        this->stopping = true;
+        this->pending.clear();
+        this->cond.notify_all();
+    }
+
+    for(auto &thread : this->threads)
+        thread.join();
+}
+
+bool SetupPool::submit(const std::function<void()> &setup)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->pending.size() >= this->maxPending) {
+        this->rejected++;
+        return false;
+    }
+
+    this->pending.push_back({ setup, std::chrono::steady_clock::now() });
+    this->cond.notify_one();
+
+    return true;
+}
+
+void SetupPool::recordSetupTime(const std::string &pipelineName, double milliseconds)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    auto iterator = this->setupTimes.find(pipelineName);
+    if (iterator != this->setupTimes.end()) {
+        iterator->second += SETUP_TIME_WEIGHT * (milliseconds - iterator->second);
+        return;
+    }
+
+    // names are client supplied, bound the map
+    if (this->setupTimes.size() >= MAX_SETUP_TIME_ENTRIES)
+        this->setupTimes.clear();
+    this->setupTimes[pipelineName] = milliseconds;
+}
+
+double SetupPool::getExpectedSetupTime(const std::string &pipelineName)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    auto iterator = this->setupTimes.find(pipelineName);
+    return iterator != this->setupTimes.end() ? iterator->second : 0;
+}
+
+void SetupPool::run()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (true) {
+        while (!this->stopping && this->pending.empty())
+            this->cond.wait(lock);
+        if (this->stopping)
+            break;
+
+        auto setup = std::move(this->pending.front().setup);
+        auto waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - this->pending.front().queued).count();
+        this->pending.pop_front();
+        this->totalWaitMilliseconds += waited;
+        this->maxWaitMilliseconds = std::max(this->maxWaitMilliseconds, waited);
+        this->busy++;
+
+        lock.unlock();
+        setup();
+        lock.lock();
+
+        this->busy--;
+        this->completed++;
+    }
+}
+
+std::string SetupPool::debugString()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    auto result = fmt::format("threads: {0}, busy: {1}, pending: {2}, maxPending: {3}, completed: {4}, rejected: {5}, avgWaitMillis: {6:.1f}, maxWaitMillis: {7:.1f}",
+        this->threads.size(),
+        this->busy,
+        this->pending.size(),
+        this->maxPending,
+        this->completed,
+        this->rejected,
+        this->completed ? this->totalWaitMilliseconds / this->completed : 0.0,
+        this->maxWaitMilliseconds);
+    this->maxWaitMilliseconds = 0;
+
+    return result;
+}
@@ -0,0 +1,108 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __SETUPPOOL_H__
+#define __SETUPPOOL_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads that build and start pipelines away from the completion
+ * queue and runloop threads.
+ *
+ * Parsing a pipeline and changing its state can take a long time with slow
+ * plugin initialization or complex specs. Running it on these workers keeps
+ * event handling of all other calls going meanwhile.
+ */
+class SetupPool
+{
+public:
+    /**
+     * Construct a new pool and start its threads.
+     *
+     * \param threads number of worker threads.
+     * \param maxPending maximum number of setups waiting for a worker.
+     */
+    SetupPool(unsigned int threads, unsigned int maxPending);
+    /**
+     * Stop the pool. Queued setups that have not started are dropped.
+     */
+    ~SetupPool();
+
+    /**
+     * Queue a setup.
+     *
+     * \param setup function to run on a worker thread.
+     * \return false if too many setups are pending, in which case setup is not run.
+     */
+    bool submit(const std::function<void()> &setup);
+    /**
+     * Record how long a setup took, from submission until its pipeline started.
+     *
+     * \param pipelineName predefined pipeline name, empty for dynamic pipelines.
+     * \param milliseconds setup time including the wait for a worker.
+     */
+    void recordSetupTime(const std::string &pipelineName, double milliseconds);
+    /**
+     * Get the expected setup time of a pipeline from recent setups.
+     *
+     * \param pipelineName predefined pipeline name, empty for dynamic pipelines.
+     * \return expected setup time in milliseconds, 0 if none was recorded.
+     */
+    double getExpectedSetupTime(const std::string &pipelineName);
+    /**
+     * Get current pool usage for reporting. Maximum wait is reset with each call.
+     *
+     * \return formatted usage.
+     */
+    std::string debugString();
+
+private:
+    static const size_t MAX_SETUP_TIME_ENTRIES;
+    static const double SETUP_TIME_WEIGHT;
+
+    struct PendingSetup
+    {
+        std::function<void()> setup;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<PendingSetup> pending;
+    std::vector<std::thread> threads;
+    unsigned int maxPending;
+    bool stopping;
+    unsigned int busy;
+    unsigned long completed;
+    unsigned long rejected;
+    double totalWaitMilliseconds;
+    double maxWaitMilliseconds;
+    // moving average of setup times per pipeline name
+    std::map<std::string, double> setupTimes;
+
+    void run();
+};
+
+#endif
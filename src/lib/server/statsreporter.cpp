@@ -0,0 +1,36 @@
+#include "statsreporter.h"
+#include "grunloop.h"
+
+StatsReporter::StatsReporter(std::shared_ptr<spdlog::logger> &logger, unsigned int intervalMilliseconds)
+{
+    this->logger = logger;
+    this->intervalMilliseconds = intervalMilliseconds;
+    this->timer = 0;
+}
+
+StatsReporter::~StatsReporter()
+{
+    if (this->timer)
+        g_source_remove(this->timer);
+}
+
+void StatsReporter::addSource(const std::string &name, const std::function<std::string()> &report)
+{
+    this->sources.push_back(std::make_pair(name, report));
+}
+
+void StatsReporter::start()
+{
+    // make sure we have a main loop
+    GRunLoop::main();
+    this->timer = g_timeout_add(this->intervalMilliseconds, reportCallback, this);
+}
+
+gboolean StatsReporter::reportCallback(gpointer user_data)
+{
+    auto reporter = static_cast<StatsReporter *>(user_data);
+    for(auto &source : reporter->sources)
+        reporter->logger->info("stats {0}: {1}", source.first, source.second());
+
+    return G_SOURCE_CONTINUE;
+}
@@ -0,0 +1,66 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __STATSREPORTER_H__
+#define __STATSREPORTER_H__
+
+#include <glib.h>
+#include <spdlog/spdlog.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
+/**
+ * Periodically logs server wide statistics from registered sources.
+ *
+ * Reports are produced on the main runloop.
+ */
+class StatsReporter
+{
+public:
+    /**
+     * Construct a new reporter.
+     *
+     * \param logger logger to report to.
+     * \param intervalMilliseconds reporting interval.
+     */
+    StatsReporter(std::shared_ptr<spdlog::logger> &logger, unsigned int intervalMilliseconds);
+    ~StatsReporter();
+
+    /**
+     * Add a statistics source.
+     *
+     * \param name name of the source.
+     * \param report function returning current statistics of the source.
+     */
+    void addSource(const std::string &name, const std::function<std::string()> &report);
+    /**
+     * Start reporting.
+     */
+    void start();
+
+private:
+    std::shared_ptr<spdlog::logger> logger;
+    unsigned int intervalMilliseconds;
+    std::vector<std::pair<std::string, std::function<std::string()>>> sources;
+    guint timer;
+
+    static gboolean reportCallback(gpointer user_data);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "streamregistry.h"
+#include "grunloop.h"
+
+#include <vector>
+
+using namespace gst_transformer::service;
+
+StreamRegistry::Registration::Registration(StreamRegistry *registry)
+{
+    this->registry = registry;
+    this->sessionId = 0;
+    this->start = std::chrono::steady_clock::now();
+}
+
+StreamRegistry::Registration::~Registration()
+{
+    std::lock_guard<std::mutex> lock(this->registry->lock);
+    this->registry->registrations.erase(this);
+}
+
+std::unique_ptr<StreamRegistry::Registration> StreamRegistry::add(
+    const std::string &requestId,
+    unsigned long sessionId,
+    const std::string &pipelineName,
+    const std::function<void(ActiveStream &)> &describe,
+    const std::function<void(const std::string &)> &cancel)
+{
+    auto registration = std::unique_ptr<Registration>(new Registration(this));
+    registration->requestId = requestId;
+    registration->sessionId = sessionId;
+    registration->pipelineName = pipelineName;
+    registration->describe = describe;
+    registration->cancel = cancel;
+
+    std::lock_guard<std::mutex> lock(this->lock);
+    this->registrations.insert(registration.get());
+    return registration;
+}
+
+void StreamRegistry::list(ListStreamsResponse &response)
+{
+    GRunLoop::main()->assertOnLoop();
+
+    std::vector<Registration *> registrations;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        registrations.assign(this->registrations.begin(), this->registrations.end());
+    }
+
+    // registrations are only removed on the runloop, describe them unlocked
+    auto now = std::chrono::steady_clock::now();
+    for(auto registration : registrations) {
+        auto stream = response.add_streams();
+        stream->set_request_id(registration->requestId);
+        stream->set_session_id(registration->sessionId);
+        stream->set_pipeline_name(registration->pipelineName);
+        stream->set_age_millis(std::chrono::duration_cast<std::chrono::milliseconds>(now - registration->start).count());
+        registration->describe(*stream);
+    }
+}
+
+unsigned int StreamRegistry::cancel(const std::string &requestId, unsigned long sessionId, const std::string &message)
+{
+    GRunLoop::main()->assertOnLoop();
+
+    std::vector<std::function<void(const std::string &)>> cancels;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        for(auto registration : this->registrations) {
+            if (registration->requestId == requestId && (!sessionId || registration->sessionId == sessionId))
+                cancels.push_back(registration->cancel);
+        }
+    }
+
+    // cancelling removes registrations, but not others of the same call
+    for(auto &cancel : cancels)
+        cancel(message);
+    return cancels.size();
+}
+
+void StreamRegistry::describePipeline(const Pipeline &pipeline, ActiveStream &stream)
+{
+    stream.set_input_bytes(pipeline.getProcessedInputBytes());
+    stream.set_output_bytes(pipeline.getProcessedOutputBytes());
+    stream.set_processed_time(pipeline.getProcessedTime());
+    stream.set_input_level_bytes(pipeline.getInputLevelBytes());
+}
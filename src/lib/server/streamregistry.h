@@ -0,0 +1,107 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __STREAMREGISTRY_H__
+#define __STREAMREGISTRY_H__
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "admin.pb.h"
+#include "pipeline.h"
+
+/**
+ * Registry of streams with running pipelines for the admin service.
+ *
+ * Streams may register from any thread, but must unregister on the main
+ * runloop, where they are described and cancelled.
+ */
+class StreamRegistry
+{
+public:
+    /**
+     * Registration of a single stream, removed when destroyed.
+     */
+    class Registration
+    {
+    public:
+        ~Registration();
+
+    private:
+        friend class StreamRegistry;
+
+        StreamRegistry *registry;
+        std::string requestId;
+        unsigned long sessionId;
+        std::string pipelineName;
+        std::chrono::steady_clock::time_point start;
+        std::function<void(gst_transformer::service::ActiveStream &)> describe;
+        std::function<void(const std::string &)> cancel;
+
+        Registration(StreamRegistry *registry);
+    };
+
+    /**
+     * Register a stream.
+     *
+     * \param requestId request ID of the call.
+     * \param sessionId session ID within the call, 0 for single stream calls.
+     * \param pipelineName predefined pipeline name, empty for dynamic pipelines.
+     * \param describe called on the runloop to fill in current stream counters.
+     * \param cancel called on the runloop to stop the stream with a message.
+     * \return registration, active until destroyed on the runloop.
+     */
+    std::unique_ptr<Registration> add(
+        const std::string &requestId,
+        unsigned long sessionId,
+        const std::string &pipelineName,
+        const std::function<void(gst_transformer::service::ActiveStream &)> &describe,
+        const std::function<void(const std::string &)> &cancel);
+    /**
+     * Describe all registered streams. Must be called on the runloop.
+     *
+     * \param response filled with the streams.
+     */
+    void list(gst_transformer::service::ListStreamsResponse &response);
+    /**
+     * Cancel registered streams. Must be called on the runloop.
+     *
+     * \param requestId request ID of the call.
+     * \param sessionId session to cancel, 0 for all streams of the call.
+     * \param message cancellation message.
+     * \return number of streams cancelled.
+     */
+    unsigned int cancel(const std::string &requestId, unsigned long sessionId, const std::string &message);
+
+    /**
+     * Fill in the counters of a stream kept by its pipeline.
+     *
+     * \param pipeline pipeline of the stream.
+     * \param stream stream to fill in.
+     */
+    static void describePipeline(const Pipeline &pipeline, gst_transformer::service::ActiveStream &stream);
+
+private:
+    // guards registrations added off the runloop
+    std::mutex lock;
+    std::set<Registration *> registrations;
+};
+
+#endif
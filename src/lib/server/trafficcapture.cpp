@@ -0,0 +1,184 @@
+#include "trafficcapture.h"
+
+#include <fmt/format.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/util/delimited_message_util.h>
+
+#include <stdexcept>
+
+using namespace gst_transformer::service;
+
+const unsigned long TrafficCapture::FNV_OFFSET_BASIS = 14695981039346656037UL;
+const size_t TrafficCapture::MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+TrafficCapture::Session::Session(TrafficCapture *capture, const std::string &requestId)
+{
+    this->capture = capture;
+    this->requestId = requestId;
+    this->start = std::chrono::steady_clock::now();
+    this->outputBytes = 0;
+    this->outputHash = FNV_OFFSET_BASIS;
+    this->dropped = false;
+}
+
+void TrafficCapture::Session::payload(const std::string &data)
+{
+    CaptureRecord record;
+    auto payload = record.mutable_payload();
+    payload->set_size(data.size());
+    if (!this->capture->sizesOnly)
+        payload->set_data(data);
+    this->write(record);
+}
+
+void TrafficCapture::Session::output(const std::string &data)
+{
+    this->outputBytes += data.size();
+    this->outputHash = TrafficCapture::hash(this->outputHash, data);
+}
+
+void TrafficCapture::Session::completed(TerminationReason reason, double processedTime)
+{
+    CaptureRecord record;
+    auto completed = record.mutable_completed();
+    completed->set_termination_reason(reason);
+    completed->set_processed_time(processedTime);
+    completed->set_output_bytes(this->outputBytes);
+    completed->set_output_hash(this->outputHash);
+    this->write(record);
+}
+
+void TrafficCapture::Session::write(CaptureRecord &record)
+{
+    if (this->dropped)
+        return;
+
+    record.set_request_id(this->requestId);
+    record.set_offset_micros(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - this->start).count());
+    if (!this->capture->enqueue(record)) {
+        // a request with missing records cannot be replayed faithfully
+        this->dropped = true;
+        this->capture->droppedSessions++;
+    }
+}
+
+TrafficCapture::TrafficCapture(std::shared_ptr<spdlog::logger> &logger, const std::string &path, double sampleRate, bool sizesOnly)
+    : randomSource(std::random_device()()), sampler(0.0, 1.0)
+{
+    if (sampleRate < 0 || sampleRate > 1)
+        throw std::invalid_argument(fmt::format("invalid capture sample rate {0}", sampleRate));
+
+    this->stream.open(path, std::ios::binary | std::ios::app);
+    if (this->stream.fail())
+        throw std::invalid_argument(fmt::format("unable to open capture file {0}", path));
+
+    this->logger = logger;
+    this->sampleRate = sampleRate;
+    this->sizesOnly = sizesOnly;
+    this->queuedBytes = 0;
+    this->stopping = false;
+    this->sessions = 0;
+    this->droppedSessions = 0;
+    this->writtenBytes = 0;
+    this->writer = std::thread([this] { this->writerLoop(); });
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    {
+        std::unique_lock<std::mutex> lock(this->lock);
+        this->stopping = true;
+        this->cond.notify_all();
+    }
+    this->writer.join();
+}
+
+std::unique_ptr<TrafficCapture::Session> TrafficCapture::begin(const std::string &requestId, const TransformConfig &config)
+{
+    {
+        std::unique_lock<std::mutex> lock(this->lock);
+        if (this->sampler(this->randomSource) >= this->sampleRate)
+            return nullptr;
+    }
+
+    this->sessions++;
+    std::unique_ptr<Session> session(new Session(this, requestId));
+    CaptureRecord record;
+    auto started = record.mutable_started();
+    started->set_start_micros(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    started->mutable_config()->CopyFrom(config);
+    session->write(record);
+
+    return session;
+}
+
+std::string TrafficCapture::debugString()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return fmt::format("sessions: {0}, dropped: {1}, writtenBytes: {2}, queuedBytes: {3}",
+        this->sessions.load(),
+        this->droppedSessions.load(),
+        this->writtenBytes.load(),
+        this->queuedBytes);
+}
+
+unsigned long TrafficCapture::hash(unsigned long hash, const std::string &data)
+{
+    for(auto c : data) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+bool TrafficCapture::enqueue(const CaptureRecord &record)
+{
+    std::string serialized;
+    {
+        google::protobuf::io::StringOutputStream output(&serialized);
+        google::protobuf::util::SerializeDelimitedToZeroCopyStream(record, &output);
+    }
+
+    std::unique_lock<std::mutex> lock(this->lock);
+    if (this->queuedBytes + serialized.size() > MAX_QUEUED_BYTES)
+        return false;
+
+    this->queuedBytes += serialized.size();
+    this->queue.push_back(std::move(serialized));
+    this->cond.notify_all();
+
+    return true;
+}
+
+void TrafficCapture::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (true) {
+        while (this->queue.empty() && !this->stopping)
+            this->cond.wait(lock);
+        if (this->queue.empty()) {
+            this->stream.flush();
+            return;
+        }
+
+        std::deque<std::string> records;
+        records.swap(this->queue);
+        lock.unlock();
+
+        size_t bytes = 0;
+        for(auto &record : records) {
+            this->stream.write(record.data(), record.size());
+            bytes += record.size();
+        }
+        this->stream.flush();
+        if (this->stream.fail())
+            this->logger->error("error writing capture file");
+        this->writtenBytes += bytes;
+
+        lock.lock();
+        this->queuedBytes -= bytes;
+    }
+}
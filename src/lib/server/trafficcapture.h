@@ -0,0 +1,149 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __TRAFFICCAPTURE_H__
+#define __TRAFFICCAPTURE_H__
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "trafficcapture.pb.h"
+
+/**
+ * Records sampled requests to a capture log for later replay: the config,
+ * the timed sequence of input payloads and a summary of the output.
+ *
+ * Records are written length delimited by a background thread so that
+ * request threads never wait on disk. When the writer falls behind, the
+ * requests that overflow it stop being captured and are left without a
+ * completed record.
+ */
+class TrafficCapture
+{
+public:
+    /**
+     * Capture of a single request.
+     */
+    class Session
+    {
+    public:
+        /**
+         * Record an input payload.
+         *
+         * \param data payload bytes.
+         */
+        void payload(const std::string &data);
+        /**
+         * Account for output sent back to the client.
+         *
+         * \param data output bytes.
+         */
+        void output(const std::string &data);
+        /**
+         * Record request completion.
+         *
+         * \param reason termination reason.
+         * \param processedTime seconds of processed media.
+         */
+        void completed(gst_transformer::service::TerminationReason reason, double processedTime);
+
+    private:
+        friend class TrafficCapture;
+
+        TrafficCapture *capture;
+        std::string requestId;
+        std::chrono::steady_clock::time_point start;
+        unsigned long outputBytes;
+        unsigned long outputHash;
+        bool dropped;
+
+        Session(TrafficCapture *capture, const std::string &requestId);
+        void write(gst_transformer::service::CaptureRecord &record);
+    };
+
+    /**
+     * Construct a new capture.
+     *
+     * \param logger logger to report errors to.
+     * \param path capture log file, appended to if it exists.
+     * \param sampleRate fraction of requests to capture, 0 to 1.
+     * \param sizesOnly capture payload sizes without their bytes.
+     */
+    TrafficCapture(std::shared_ptr<spdlog::logger> &logger, const std::string &path, double sampleRate, bool sizesOnly);
+    ~TrafficCapture();
+
+    /**
+     * Start capturing a request if it is sampled.
+     *
+     * \param requestId request ID.
+     * \param config request config.
+     * \return capture session, nullptr if the request is not sampled.
+     */
+    std::unique_ptr<Session> begin(const std::string &requestId, const gst_transformer::service::TransformConfig &config);
+    /**
+     * Get capture counters for reporting.
+     *
+     * \return counters string.
+     */
+    std::string debugString();
+
+    /**
+     * Fold data into a 64 bit FNV-1a hash.
+     *
+     * \param hash current hash, FNV_OFFSET_BASIS to start.
+     * \param data data to hash.
+     * \return updated hash.
+     */
+    static unsigned long hash(unsigned long hash, const std::string &data);
+
+    static const unsigned long FNV_OFFSET_BASIS;
+
+private:
+    static const size_t MAX_QUEUED_BYTES;
+
+    std::shared_ptr<spdlog::logger> logger;
+    std::ofstream stream;
+    double sampleRate;
+    bool sizesOnly;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<std::string> queue;
+    size_t queuedBytes;
+    bool stopping;
+    std::default_random_engine randomSource;
+    std::uniform_real_distribution<double> sampler;
+    std::thread writer;
+
+    std::atomic<unsigned long> sessions;
+    std::atomic<unsigned long> droppedSessions;
+    std::atomic<unsigned long> writtenBytes;
+
+    bool enqueue(const gst_transformer::service::CaptureRecord &record);
+    void writerLoop();
+};
+
+#endif
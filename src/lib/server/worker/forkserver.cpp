@@ -0,0 +1,135 @@
+#include "forkserver.h"
+
+#include <sys/socket.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <stdexcept>
+
+ForkServer *ForkServer::Shared = nullptr;
+
+void ForkServer::start(const std::function<void()> &prepare, const std::function<int(WorkerChannel &)> &workerMain)
+{
+    if (Shared)
+        throw std::logic_error("fork server already started");
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0)
+        throw std::runtime_error(fmt::format("unable to create fork server socket: {0}", strerror(errno)));
+
+    auto pid = fork();
+    if (pid < 0)
+        throw std::runtime_error(fmt::format("unable to fork fork server: {0}", strerror(errno)));
+
+    if (pid == 0) {
+        close(sockets[0]);
+        prepare();
+        serve(sockets[1], workerMain);
+        _exit(0);
+    }
+
+    close(sockets[1]);
+    Shared = new ForkServer(sockets[0], pid);
+}
+
+ForkServer * ForkServer::shared()
+{
+    return Shared;
+}
+
+ForkServer::ForkServer(int socket, pid_t pid)
+{
+    this->socket = socket;
+    this->pid = pid;
+}
+
+pid_t ForkServer::spawn(int workerSocket, int memory)
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    char byte = 0;
+    struct iovec iov = { &byte, sizeof(byte) };
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int fds[2] = { workerSocket, memory };
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(this->socket, &message, MSG_NOSIGNAL) < 0)
+        throw std::runtime_error(fmt::format("fork server is gone: {0}", strerror(errno)));
+
+    pid_t pid;
+    if (recv(this->socket, &pid, sizeof(pid), 0) != sizeof(pid))
+        throw std::runtime_error("fork server is gone");
+    if (pid < 0)
+        throw std::runtime_error("fork server unable to fork worker");
+
+    return pid;
+}
+
+void ForkServer::serve(int socket, const std::function<int(WorkerChannel &)> &workerMain)
+{
+    auto logger = spdlog::stderr_logger_mt("forkserver");
+    // workers are not waited for
+    signal(SIGCHLD, SIG_IGN);
+
+    while (true) {
+        char byte;
+        struct iovec iov = { &byte, sizeof(byte) };
+        char control[CMSG_SPACE(2 * sizeof(int))];
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        auto received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+        if (received < 0 && errno == EINTR)
+            continue;
+        // server is gone
+        if (received <= 0)
+            return;
+
+        auto cmsg = CMSG_FIRSTHDR(&message);
+        if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int)))
+            continue;
+        int fds[2];
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+        auto pid = fork();
+        if (pid < 0)
+            logger->error("unable to fork worker: {0}", strerror(errno));
+        if (pid == 0) {
+            close(socket);
+            signal(SIGCHLD, SIG_DFL);
+            int code = 1;
+            try {
+                WorkerChannel channel(fds[0], fds[1], true);
+                close(fds[1]);
+                code = workerMain(channel);
+            }
+            catch(std::exception &e) {
+                logger->error("worker {0} failed: {1}", getpid(), e.what());
+            }
+            _exit(code);
+        }
+
+        close(fds[0]);
+        close(fds[1]);
+        send(socket, &pid, sizeof(pid), MSG_NOSIGNAL);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __FORKSERVER_H__
+#define __FORKSERVER_H__
+
+#include <sys/types.h>
+#include <functional>
+#include <mutex>
+
+#include "workerchannel.h"
+
+/**
+ * Process that forks pipeline workers on behalf of the server.
+ *
+ * A multithreaded process cannot safely fork, so the fork server itself is
+ * forked while the server is still single threaded. It prepares once, for
+ * example by loading plugins, and each worker forked from it starts with
+ * that state already in place.
+ */
+class ForkServer
+{
+public:
+    /**
+     * Fork the shared fork server. Must be called before any thread is created.
+     *
+     * \param prepare function run once in the fork server before serving.
+     * \param workerMain function run in each worker process, returns the exit code.
+     */
+    static void start(const std::function<void()> &prepare, const std::function<int(WorkerChannel &)> &workerMain);
+    /**
+     * Get the shared fork server.
+     *
+     * \return fork server, null if it has not been started.
+     */
+    static ForkServer * shared();
+
+    /**
+     * Fork a new worker process.
+     *
+     * \param workerSocket worker end of the channel socket, closed by the caller afterwards.
+     * \param memory channel shared memory, closed by the caller afterwards.
+     * \return process ID of the worker.
+     */
+    pid_t spawn(int workerSocket, int memory);
+
+private:
+    static ForkServer *Shared;
+
+    int socket;
+    pid_t pid;
+    std::mutex lock;
+
+    ForkServer(int socket, pid_t pid);
+    static void serve(int socket, const std::function<int(WorkerChannel &)> &workerMain);
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "remotepipeline.h"
+#include "workerpool.h"
+#include "workerprocess.h"
+
+#include <string.h>
+#include <stdexcept>
+
+namespace gst_transformer {
+namespace service {
+
+RemotePipeline::RemotePipeline(WorkerPool *pool, const std::shared_ptr<WorkerConnection> &worker, uint64_t id)
+{
+    this->pool = pool;
+    this->worker = worker;
+    this->id = id;
+    this->created = false;
+    this->lost = false;
+    this->done = false;
+    this->terminationReason = PipelineTerminationReason::NONE;
+    this->processedInputBytes = 0;
+    this->processedOutputBytes = 0;
+    this->processedTime = 0;
+}
+
+RemotePipeline::~RemotePipeline()
+{
+    this->worker->channel->send(WorkerChannel::FrameType::DESTROY, this->id);
+    // no callbacks are invoked once released
+    this->pool->release(this->worker, this->id);
+}
+
+void RemotePipeline::create(const std::string &requestId, const TransformConfig &config)
+{
+    auto payload = requestId + config.SerializeAsString();
+    if (!this->worker->channel->send(WorkerChannel::FrameType::CREATE, this->id, payload.data(), payload.size(), requestId.size()))
+        throw std::runtime_error("unable to send pipeline to worker process");
+
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (!this->created && this->createError.empty() && !this->lost)
+        this->cond.wait(lock);
+
+    if (!this->createError.empty())
+        throw std::invalid_argument(this->createError);
+    if (!this->created)
+        throw std::runtime_error("worker process exited");
+}
+
+void RemotePipeline::start(const std::function<void(bool)> &termination)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        this->terminationCallback = termination;
+    }
+    this->worker->channel->send(WorkerChannel::FrameType::START, this->id);
+}
+
+void RemotePipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        this->terminationReason = PipelineTerminationReason::CANCELLED;
+    }
+    this->worker->channel->send(WorkerChannel::FrameType::STOP, this->id);
+}
+
+int RemotePipeline::addData(const char *buffer, int size)
+{
+    if (!this->worker->channel->send(WorkerChannel::FrameType::DATA, this->id, buffer, size))
+        return -1;
+
+    return size;
+}
+
+void RemotePipeline::endData()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        if (this->terminationReason == PipelineTerminationReason::NONE) {
+            this->terminationReason = PipelineTerminationReason::END_OF_STREAM;
+            this->terminationMessage = "end of stream";
+        }
+    }
+    this->worker->channel->send(WorkerChannel::FrameType::END, this->id);
+}
+
+void RemotePipeline::waitUntilCompleted()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (!this->done)
+        this->cond.wait(lock);
+}
+
+PipelineTerminationReason RemotePipeline::getTerminationReason() const
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    return this->terminationReason;
+}
+
+std::string RemotePipeline::getTerminationMessage() const
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    return this->terminationMessage;
+}
+
+void RemotePipeline::setSampleAvailableCallback(const std::function<void()> &callback)
+{
+    this->sampleAvailableCallback = callback;
+}
+
+void RemotePipeline::setNeedDataCallback(const std::function<void()> &callback)
+{
+    this->needDataCallback = callback;
+}
+
+void RemotePipeline::setEnoughDataCallback(const std::function<void()> &callback)
+{
+    this->enoughDataCallback = callback;
+}
+
+void RemotePipeline::setEOSCallback(const std::function<void()> &callback)
+{
+    this->eosCallback = callback;
+}
+
+std::vector<std::string> RemotePipeline::getPendingSample(int count)
+{
+    double endTime;
+    return this->getPendingSample(count, -1, endTime);
+}
+
+std::vector<std::string> RemotePipeline::getPendingSample(int count, double maxTime, double &endTime)
+{
+    std::vector<std::string> sampleBuffers;
+    unsigned long bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        while ((int)sampleBuffers.size() < count && !this->samples.empty()) {
+            auto &sample = this->samples.front();
+            if (maxTime >= 0 && sample.endTime > maxTime)
+                break;
+
+            endTime = sample.endTime;
+            bytes += sample.data.size();
+            sampleBuffers.emplace_back(std::move(sample.data));
+            this->samples.pop_front();
+        }
+        this->processedOutputBytes += bytes;
+    }
+
+    // let the worker send more output
+    if (bytes > 0)
+        this->worker->channel->send(WorkerChannel::FrameType::CONSUMED, this->id, nullptr, 0, bytes);
+
+    return sampleBuffers;
+}
+
+double RemotePipeline::getNextSampleTime()
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    if (this->samples.empty())
+        return -1;
+
+    return this->samples.front().endTime;
+}
+
+unsigned long RemotePipeline::getProcessedInputBytes() const
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    return this->processedInputBytes;
+}
+
+unsigned long RemotePipeline::getProcessedOutputBytes() const
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    return this->processedOutputBytes;
+}
+
+double RemotePipeline::getProcessedTime() const
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+    return this->processedTime;
+}
+
+unsigned long RemotePipeline::getInputLevelBytes() const
+{
+    // queued in the worker, not reported back
+    return 0;
+}
+
+void RemotePipeline::handleFrame(const WorkerChannel::Frame &frame)
+{
+    switch(frame.type) {
+        case WorkerChannel::FrameType::CREATED:
+        {
+            std::lock_guard<std::mutex> lock(this->lock);
+            this->created = true;
+            this->cond.notify_all();
+            break;
+        }
+
+        case WorkerChannel::FrameType::FAILED:
+        {
+            std::lock_guard<std::mutex> lock(this->lock);
+            this->createError = frame.payload.empty() ? "unknown worker error" : frame.payload;
+            this->cond.notify_all();
+            break;
+        }
+
+        case WorkerChannel::FrameType::SAMPLE:
+        {
+            bool notify;
+            {
+                std::lock_guard<std::mutex> lock(this->lock);
+                // same as batched notifications: only when the consumer has drained all samples
+                notify = this->samples.empty();
+                this->samples.push_back(PendingSample());
+                this->samples.back().data = frame.payload;
+                this->samples.back().endTime = frame.time;
+            }
+            if (notify && this->sampleAvailableCallback)
+                this->sampleAvailableCallback();
+            break;
+        }
+
+        case WorkerChannel::FrameType::NEED_DATA:
+            if (this->needDataCallback)
+                this->needDataCallback();
+            break;
+
+        case WorkerChannel::FrameType::ENOUGH_DATA:
+            if (this->enoughDataCallback)
+                this->enoughDataCallback();
+            break;
+
+        case WorkerChannel::FrameType::STATUS:
+        {
+            WorkerPipelineStatus status;
+            if (frame.payload.size() < sizeof(status))
+                break;
+            memcpy(&status, frame.payload.data(), sizeof(status));
+
+            std::lock_guard<std::mutex> lock(this->lock);
+            // a stop is applied right away, the worker reports it later
+            if (this->terminationReason != PipelineTerminationReason::CANCELLED) {
+                this->terminationReason = (PipelineTerminationReason)status.terminationReason;
+                this->terminationMessage = frame.payload.substr(sizeof(status));
+            }
+            this->processedInputBytes = status.processedInputBytes;
+            this->processedTime = status.processedTime;
+            break;
+        }
+
+        case WorkerChannel::FrameType::TERMINATED:
+        {
+            auto force = frame.argument != 0;
+            if (force) {
+                std::lock_guard<std::mutex> lock(this->lock);
+                this->done = true;
+                this->cond.notify_all();
+            }
+            if (this->terminationCallback)
+                this->terminationCallback(force);
+            break;
+        }
+
+        case WorkerChannel::FrameType::EOS:
+        {
+            if (this->eosCallback)
+                this->eosCallback();
+            std::lock_guard<std::mutex> lock(this->lock);
+            this->done = true;
+            this->cond.notify_all();
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void RemotePipeline::workerLost()
+{
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        this->lost = true;
+        this->done = true;
+        this->terminationReason = PipelineTerminationReason::INTERNAL_ERROR;
+        this->terminationMessage = "worker process exited";
+        started = (bool)this->terminationCallback;
+        this->cond.notify_all();
+    }
+
+    if (started)
+        this->terminationCallback(true);
+}
+
+}
+}
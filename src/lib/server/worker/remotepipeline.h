@@ -0,0 +1,108 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __REMOTEPIPELINE_H__
+#define __REMOTEPIPELINE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "pipeline.h"
+#include "gsttransformer.pb.h"
+#include "workerchannel.h"
+
+namespace gst_transformer {
+namespace service {
+
+class WorkerPool;
+struct WorkerConnection;
+
+/**
+ * A pipeline running in a worker process.
+ *
+ * Commands are sent to the worker over its channel and output samples are
+ * queued locally as they arrive. Callbacks are invoked on the worker's reader
+ * thread; the pipeline must not be destroyed from within them.
+ */
+class RemotePipeline : public Pipeline
+{
+public:
+    ~RemotePipeline();
+
+    void start(const std::function<void(bool)> &termination) override;
+    void stop() override;
+    int addData(const char *buffer, int size) override;
+    void endData() override;
+    void waitUntilCompleted() override;
+    PipelineTerminationReason getTerminationReason() const override;
+    std::string getTerminationMessage() const override;
+    void setSampleAvailableCallback(const std::function<void()> &callback) override;
+    void setNeedDataCallback(const std::function<void()> &callback) override;
+    void setEnoughDataCallback(const std::function<void()> &callback) override;
+    void setEOSCallback(const std::function<void()> &callback) override;
+    std::vector<std::string> getPendingSample(int count) override;
+    std::vector<std::string> getPendingSample(int count, double maxTime, double &endTime) override;
+    double getNextSampleTime() override;
+    unsigned long getProcessedInputBytes() const override;
+    unsigned long getProcessedOutputBytes() const override;
+    double getProcessedTime() const override;
+    unsigned long getInputLevelBytes() const override;
+
+private:
+    friend class WorkerPool;
+
+    struct PendingSample
+    {
+        std::string data;
+        double endTime;
+    };
+
+    WorkerPool *pool;
+    std::shared_ptr<WorkerConnection> worker;
+    uint64_t id;
+
+    mutable std::mutex lock;
+    std::condition_variable cond;
+    bool created;
+    std::string createError;
+    bool lost;
+    bool done;
+    std::deque<PendingSample> samples;
+    PipelineTerminationReason terminationReason;
+    std::string terminationMessage;
+    unsigned long processedInputBytes;
+    unsigned long processedOutputBytes;
+    double processedTime;
+
+    std::function<void(bool)> terminationCallback;
+    std::function<void()> sampleAvailableCallback;
+    std::function<void()> enoughDataCallback;
+    std::function<void()> needDataCallback;
+    std::function<void()> eosCallback;
+
+    RemotePipeline(WorkerPool *pool, const std::shared_ptr<WorkerConnection> &worker, uint64_t id);
+    void create(const std::string &requestId, const TransformConfig &config);
+    void handleFrame(const WorkerChannel::Frame &frame);
+    void workerLost();
+};
+
+}
+}
+
+#endif
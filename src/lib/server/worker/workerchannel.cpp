@@ -0,0 +1,194 @@
+#include "workerchannel.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <stdexcept>
+
+const size_t WorkerChannel::RING_BYTES = 4 * 1024 * 1024;
+const size_t WorkerChannel::MAX_SOCKET_PAYLOAD_BYTES = 64 * 1024 * 1024;
+const uint32_t WorkerChannel::FLAG_IN_RING = 1;
+
+void WorkerChannel::createDescriptors(int &serverSocket, int &workerSocket, int &memory)
+{
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+        throw std::runtime_error(fmt::format("unable to create worker socket: {0}", strerror(errno)));
+
+    memory = memfd_create("gsttransformer-worker", MFD_CLOEXEC);
+    if (memory < 0 || ftruncate(memory, 2 * (sizeof(Ring) + RING_BYTES)) < 0) {
+        auto message = fmt::format("unable to create worker shared memory: {0}", strerror(errno));
+        if (memory >= 0)
+            close(memory);
+        close(sockets[0]);
+        close(sockets[1]);
+        throw std::runtime_error(message);
+    }
+
+    serverSocket = sockets[0];
+    workerSocket = sockets[1];
+}
+
+WorkerChannel::WorkerChannel(int socket, int memory, bool worker)
+{
+    this->socket = socket;
+    this->memorySize = 2 * (sizeof(Ring) + RING_BYTES);
+    this->memory = mmap(NULL, this->memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if (this->memory == MAP_FAILED) {
+        close(socket);
+        throw std::runtime_error(fmt::format("unable to map worker shared memory: {0}", strerror(errno)));
+    }
+
+    // first ring carries server to worker, second worker to server.
+    // a fresh memfd is zero filled, so both rings start empty.
+    auto first = static_cast<char *>(this->memory);
+    auto second = first + sizeof(Ring) + RING_BYTES;
+    auto serverRing = reinterpret_cast<Ring *>(first);
+    auto workerRing = reinterpret_cast<Ring *>(second);
+    this->sendRing = worker ? workerRing : serverRing;
+    this->receiveRing = worker ? serverRing : workerRing;
+    this->sendData = reinterpret_cast<char *>(this->sendRing) + sizeof(Ring);
+    this->receiveData = reinterpret_cast<char *>(this->receiveRing) + sizeof(Ring);
+}
+
+WorkerChannel::~WorkerChannel()
+{
+    close(this->socket);
+    munmap(this->memory, this->memorySize);
+}
+
+bool WorkerChannel::send(FrameType type, uint64_t pipelineId, const char *data, size_t length, int64_t argument, double time)
+{
+    if (length > MAX_SOCKET_PAYLOAD_BYTES)
+        return false;
+
+    std::lock_guard<std::mutex> lock(this->sendLock);
+
+    Header header;
+    header.type = (uint32_t)type;
+    header.flags = 0;
+    header.pipelineId = pipelineId;
+    header.length = length;
+    header.argument = argument;
+    header.time = time;
+
+    // payload has to be in the ring before its header can be read
+    if (length > 0 && this->writeRing(data, length))
+        header.flags |= FLAG_IN_RING;
+    if (!this->writeFully(&header, sizeof(header)))
+        return false;
+    if (length > 0 && !(header.flags & FLAG_IN_RING))
+        return this->writeFully(data, length);
+
+    return true;
+}
+
+bool WorkerChannel::receive(Frame &frame)
+{
+    Header header;
+    if (!this->readFully(&header, sizeof(header)))
+        return false;
+
+    if (header.type > (uint32_t)FrameType::EOS) {
+        this->shutdown();
+        return false;
+    }
+    if (header.flags & FLAG_IN_RING) {
+        // the payload must be within what the other side has written to the ring
+        auto head = this->receiveRing->head.load(std::memory_order_acquire);
+        auto tail = this->receiveRing->tail.load(std::memory_order_relaxed);
+        if (header.length > RING_BYTES || header.length > head - tail) {
+            this->shutdown();
+            return false;
+        }
+    }
+    else if (header.length > MAX_SOCKET_PAYLOAD_BYTES) {
+        this->shutdown();
+        return false;
+    }
+
+    frame.type = (FrameType)header.type;
+    frame.pipelineId = header.pipelineId;
+    frame.argument = header.argument;
+    frame.time = header.time;
+    frame.payload.resize(header.length);
+    if (header.length == 0)
+        return true;
+
+    if (header.flags & FLAG_IN_RING) {
+        this->readRing(&frame.payload[0], header.length);
+        return true;
+    }
+    return this->readFully(&frame.payload[0], header.length);
+}
+
+void WorkerChannel::shutdown()
+{
+    ::shutdown(this->socket, SHUT_RDWR);
+}
+
+bool WorkerChannel::writeRing(const char *data, size_t length)
+{
+    // single writer under sendLock, single reader on the other side
+    auto head = this->sendRing->head.load(std::memory_order_relaxed);
+    auto tail = this->sendRing->tail.load(std::memory_order_acquire);
+    if (length > RING_BYTES - (head - tail))
+        return false;
+
+    auto offset = head % RING_BYTES;
+    auto first = std::min(length, RING_BYTES - offset);
+    memcpy(this->sendData + offset, data, first);
+    memcpy(this->sendData, data + first, length - first);
+    this->sendRing->head.store(head + length, std::memory_order_release);
+
+    return true;
+}
+
+void WorkerChannel::readRing(char *data, size_t length)
+{
+    // length was checked against head in receive()
+    auto tail = this->receiveRing->tail.load(std::memory_order_relaxed);
+
+    auto offset = tail % RING_BYTES;
+    auto first = std::min(length, RING_BYTES - offset);
+    memcpy(data, this->receiveData + offset, first);
+    memcpy(data + first, this->receiveData, length - first);
+    this->receiveRing->tail.store(tail + length, std::memory_order_release);
+}
+
+bool WorkerChannel::writeFully(const void *data, size_t length)
+{
+    auto bytes = static_cast<const char *>(data);
+    while (length > 0) {
+        auto written = ::send(this->socket, bytes, length, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += written;
+        length -= written;
+    }
+
+    return true;
+}
+
+bool WorkerChannel::readFully(void *data, size_t length)
+{
+    auto bytes = static_cast<char *>(data);
+    while (length > 0) {
+        auto count = ::recv(this->socket, bytes, length, 0);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        bytes += count;
+        length -= count;
+    }
+
+    return true;
+}
@@ -0,0 +1,153 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __WORKERCHANNEL_H__
+#define __WORKERCHANNEL_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Bidirectional frame transport between the server and a worker process.
+ *
+ * Frame headers go over a unix socket. Payloads are copied through a shared
+ * memory ring for each direction when they fit, or follow their header on
+ * the socket otherwise. Sending is thread safe; each side has a single reader.
+ */
+class WorkerChannel
+{
+public:
+    enum class FrameType : uint32_t
+    {
+        // server to worker
+        CREATE,
+        START,
+        DATA,
+        END,
+        STOP,
+        CONSUMED,
+        DESTROY,
+        // worker to server
+        CREATED,
+        FAILED,
+        SAMPLE,
+        NEED_DATA,
+        ENOUGH_DATA,
+        STATUS,
+        TERMINATED,
+        EOS
+    };
+
+    struct Frame
+    {
+        FrameType type;
+        uint64_t pipelineId;
+        // frame specific value, such as a byte count or a flag
+        int64_t argument;
+        // sample end time in seconds
+        double time;
+        std::string payload;
+    };
+
+    // size of the shared memory ring in each direction
+    static const size_t RING_BYTES;
+    // largest payload sent over the socket
+    static const size_t MAX_SOCKET_PAYLOAD_BYTES;
+
+    /**
+     * Create the descriptors of a new channel.
+     *
+     * \param serverSocket receives the server end of the socket.
+     * \param workerSocket receives the worker end of the socket.
+     * \param memory receives the shared memory backing both rings.
+     */
+    static void createDescriptors(int &serverSocket, int &workerSocket, int &memory);
+
+    /**
+     * Construct a channel end. Takes ownership of the socket, the memory
+     * descriptor is only used for mapping and can be closed afterwards.
+     *
+     * \param socket socket end of this side.
+     * \param memory shared memory created with createDescriptors().
+     * \param worker true for the worker side of the channel.
+     */
+    WorkerChannel(int socket, int memory, bool worker);
+    ~WorkerChannel();
+
+    /**
+     * Send a frame.
+     *
+     * \param type frame type.
+     * \param pipelineId pipeline the frame belongs to.
+     * \param data payload, may be null if length is 0.
+     * \param length payload length.
+     * \param argument frame specific value.
+     * \param time sample end time.
+     * \return false if the other side is gone or the payload is too large.
+     */
+    bool send(FrameType type, uint64_t pipelineId, const char *data = nullptr, size_t length = 0, int64_t argument = 0, double time = 0);
+    /**
+     * Receive the next frame, blocking until it arrives. A malformed frame
+     * shuts the channel down, the other side is not trusted.
+     *
+     * \param frame receives the frame.
+     * \return false if the other side is gone, the channel was shut down or
+     * the frame is malformed.
+     */
+    bool receive(Frame &frame);
+    /**
+     * Shut down the socket, unblocking the reader of both sides.
+     */
+    void shutdown();
+
+private:
+    static const uint32_t FLAG_IN_RING;
+
+    struct Header
+    {
+        uint32_t type;
+        uint32_t flags;
+        uint64_t pipelineId;
+        uint64_t length;
+        int64_t argument;
+        double time;
+    };
+
+    struct Ring
+    {
+        // bytes written and read since creation
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+    };
+
+    int socket;
+    void *memory;
+    size_t memorySize;
+    Ring *sendRing;
+    char *sendData;
+    Ring *receiveRing;
+    char *receiveData;
+    std::mutex sendLock;
+
+    bool writeRing(const char *data, size_t length);
+    void readRing(char *data, size_t length);
+    bool writeFully(const void *data, size_t length);
+    bool readFully(void *data, size_t length);
+};
+
+#endif
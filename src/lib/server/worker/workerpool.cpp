@@ -0,0 +1,232 @@
+#include "workerpool.h"
+
+#include <fmt/format.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <thread>
+
+namespace gst_transformer {
+namespace service {
+
+WorkerPool::WorkerPool(std::shared_ptr<spdlog::logger> logger, ForkServer *forkServer, unsigned int workers, unsigned int maxCalls)
+{
+    if (!forkServer)
+        throw std::logic_error("worker processes require the fork server to be started");
+
+    this->logger = logger;
+    this->forkServer = forkServer;
+    this->maxCalls = maxCalls;
+    this->nextPipelineId = 1;
+    this->readers = 0;
+    this->stopping = false;
+    this->spawned = 0;
+    this->crashed = 0;
+    this->recycled = 0;
+
+    for(unsigned int i=0; i<workers; i++)
+        this->spawn();
+}
+
+WorkerPool::~WorkerPool()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    this->stopping = true;
+    for(auto &worker : this->workers)
+        worker->channel->shutdown();
+    while (this->readers > 0)
+        this->readersCond.wait(lock);
+}
+
+std::unique_ptr<Pipeline> WorkerPool::create(const std::string &requestId, const TransformConfig &config)
+{
+    std::unique_ptr<RemotePipeline> pipeline;
+    auto replace = false;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        std::shared_ptr<WorkerConnection> selected;
+        size_t selectedCount = 0;
+        for(auto &worker : this->workers) {
+            if (worker->retiring)
+                continue;
+            std::lock_guard<std::mutex> workerLock(worker->lock);
+            if (worker->lost)
+                continue;
+            if (!selected || worker->pipelines.size() < selectedCount) {
+                selected = worker;
+                selectedCount = worker->pipelines.size();
+            }
+        }
+        if (!selected)
+            throw std::runtime_error("no worker process available");
+
+        pipeline.reset(new RemotePipeline(this, selected, this->nextPipelineId++));
+        {
+            std::lock_guard<std::mutex> workerLock(selected->lock);
+            selected->pipelines[pipeline->id] = pipeline.get();
+            // lost after it was selected, the reader thread already notified its pipelines
+            if (selected->lost)
+                pipeline->workerLost();
+        }
+        selected->calls++;
+        if (this->maxCalls && selected->calls >= this->maxCalls) {
+            // closed once its last pipeline is released
+            selected->retiring = true;
+            replace = true;
+        }
+    }
+
+    if (replace) {
+        try {
+            this->spawn();
+        }
+        catch(std::exception &e) {
+            this->logger->error("unable to spawn replacement worker: {0}", e.what());
+        }
+    }
+
+    pipeline->create(requestId, config);
+    return std::move(pipeline);
+}
+
+std::string WorkerPool::debugString()
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    size_t pipelines = 0;
+    for(auto &worker : this->workers) {
+        std::lock_guard<std::mutex> workerLock(worker->lock);
+        pipelines += worker->pipelines.size();
+    }
+
+    return fmt::format("workers: {0}, pipelines: {1}, spawned: {2}, crashed: {3}, recycled: {4}",
+        this->workers.size(),
+        pipelines,
+        this->spawned,
+        this->crashed,
+        this->recycled);
+}
+
+std::vector<pid_t> WorkerPool::getProcessIds()
+{
+    std::lock_guard<std::mutex> lock(this->lock);
+
+    std::vector<pid_t> pids;
+    for(auto &worker : this->workers)
+        pids.push_back(worker->pid);
+    return pids;
+}
+
+void WorkerPool::spawn()
+{
+    int serverSocket, workerSocket, memory;
+    WorkerChannel::createDescriptors(serverSocket, workerSocket, memory);
+
+    auto worker = std::make_shared<WorkerConnection>();
+    worker->lost = false;
+    worker->calls = 0;
+    worker->retiring = false;
+    try {
+        worker->pid = this->forkServer->spawn(workerSocket, memory);
+    }
+    catch(std::exception &e) {
+        close(serverSocket);
+        close(workerSocket);
+        close(memory);
+        throw;
+    }
+    close(workerSocket);
+
+    try {
+        // the worker sees the socket closed and exits if this fails
+        worker->channel.reset(new WorkerChannel(serverSocket, memory, false));
+    }
+    catch(std::exception &e) {
+        close(memory);
+        throw;
+    }
+    close(memory);
+
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        this->workers.push_back(worker);
+        this->readers++;
+        this->spawned++;
+    }
+    this->logger->info("spawned worker process {0}", worker->pid);
+
+    std::thread(&WorkerPool::read, this, worker).detach();
+}
+
+void WorkerPool::read(std::shared_ptr<WorkerConnection> worker)
+{
+    WorkerChannel::Frame frame;
+    while (worker->channel->receive(frame)) {
+        std::lock_guard<std::mutex> workerLock(worker->lock);
+        auto iterator = worker->pipelines.find(frame.pipelineId);
+        if (iterator != worker->pipelines.end())
+            iterator->second->handleFrame(frame);
+    }
+
+    size_t pipelines;
+    {
+        std::lock_guard<std::mutex> workerLock(worker->lock);
+        worker->lost = true;
+        pipelines = worker->pipelines.size();
+        // pipelines stay registered until released by their owners
+        for(auto &entry : worker->pipelines)
+            entry.second->workerLost();
+    }
+
+    auto replace = false;
+    {
+        std::lock_guard<std::mutex> lock(this->lock);
+        for(auto iterator = this->workers.begin(); iterator != this->workers.end(); iterator++) {
+            if (*iterator == worker) {
+                this->workers.erase(iterator);
+                break;
+            }
+        }
+        if (worker->retiring) {
+            this->recycled++;
+        }
+        else if (!this->stopping) {
+            this->crashed++;
+            replace = true;
+        }
+    }
+
+    if (replace) {
+        this->logger->warn("worker process {0} exited with {1} pipelines", worker->pid, pipelines);
+        try {
+            this->spawn();
+        }
+        catch(std::exception &e) {
+            this->logger->error("unable to spawn replacement worker: {0}", e.what());
+        }
+    }
+    else {
+        this->logger->info("worker process {0} closed", worker->pid);
+    }
+
+    std::lock_guard<std::mutex> lock(this->lock);
+    this->readers--;
+    this->readersCond.notify_all();
+}
+
+void WorkerPool::release(const std::shared_ptr<WorkerConnection> &worker, uint64_t pipelineId)
+{
+    bool empty;
+    {
+        std::lock_guard<std::mutex> workerLock(worker->lock);
+        worker->pipelines.erase(pipelineId);
+        empty = worker->pipelines.empty();
+    }
+
+    std::lock_guard<std::mutex> lock(this->lock);
+    // worker exits on its own once the channel is closed
+    if (worker->retiring && empty)
+        worker->channel->shutdown();
+}
+
+}
+}
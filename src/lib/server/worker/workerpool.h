@@ -0,0 +1,122 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+#include <sys/types.h>
+#include <spdlog/spdlog.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gsttransformer.pb.h"
+#include "forkserver.h"
+#include "remotepipeline.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Server side of one worker process.
+ */
+struct WorkerConnection
+{
+    pid_t pid;
+    std::unique_ptr<WorkerChannel> channel;
+    // guards pipelines and lost, held while frames are dispatched
+    std::mutex lock;
+    std::map<uint64_t, RemotePipeline *> pipelines;
+    bool lost;
+    // guarded by the pool lock
+    unsigned long calls;
+    bool retiring;
+};
+
+/**
+ * Pool of worker processes running pipelines out of the server process.
+ *
+ * A crashing pipeline takes down only the pipelines of its worker, which
+ * terminate with an internal error, and the worker is replaced. Workers are
+ * also recycled after a number of pipelines. New pipelines go to the worker
+ * with the fewest running.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * Construct a new pool and spawn its workers.
+     *
+     * \param logger logger to report worker changes to.
+     * \param forkServer fork server to spawn workers from.
+     * \param workers number of worker processes.
+     * \param maxCalls pipelines after which a worker is recycled, 0 for no limit.
+     */
+    WorkerPool(std::shared_ptr<spdlog::logger> logger, ForkServer *forkServer, unsigned int workers, unsigned int maxCalls);
+    /**
+     * Close all workers. Their pipelines are torn down by the workers.
+     */
+    ~WorkerPool();
+
+    /**
+     * Create a pipeline on a worker.
+     *
+     * \param requestId the request ID for logging.
+     * \param config request parameters.
+     * \return a pipeline ready to start.
+     */
+    std::unique_ptr<Pipeline> create(const std::string &requestId, const TransformConfig &config);
+    /**
+     * Get current pool usage for reporting.
+     *
+     * \return formatted usage.
+     */
+    std::string debugString();
+    /**
+     * Get the process IDs of the current workers.
+     *
+     * \return worker process IDs.
+     */
+    std::vector<pid_t> getProcessIds();
+
+private:
+    friend class RemotePipeline;
+
+    std::shared_ptr<spdlog::logger> logger;
+    ForkServer *forkServer;
+    unsigned int maxCalls;
+    std::mutex lock;
+    std::condition_variable readersCond;
+    std::vector<std::shared_ptr<WorkerConnection>> workers;
+    uint64_t nextPipelineId;
+    unsigned int readers;
+    bool stopping;
+    unsigned long spawned;
+    unsigned long crashed;
+    unsigned long recycled;
+
+    void spawn();
+    void read(std::shared_ptr<WorkerConnection> worker);
+    void release(const std::shared_ptr<WorkerConnection> &worker, uint64_t pipelineId);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "workerprocess.h"
+
+#include <gst/gst.h>
+#include <spdlog/sinks/stdout_sinks.h>
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "spillbuffer.h"
+#include "sharedtaskpool.h"
+#include "ingestbufferpool.h"
+
+namespace gst_transformer {
+namespace service {
+
+const unsigned long WorkerProcess::MAX_IN_FLIGHT_BYTES = 4 * 1024 * 1024;
+const unsigned int WorkerProcess::TEARDOWN_TIMEOUT_MILLIS = 5000;
+const unsigned int WorkerProcess::DEFAULT_MAX_IDLE_PIPELINES = 8;
+
+WorkerProcess::WorkerProcess(const ServiceParametersStruct &params, WorkerChannel &channel)
+    : channel(channel)
+{
+    this->logger = spdlog::stderr_logger_mt(fmt::format("workerprocess-{0}", getpid()));
+
+    // process wide settings are per worker, as applied by AsyncServiceImpl in the server
+    SpillBuffer::setTotalQuota(params.max_total_spill_bytes());
+    if (params.shared_task_pool())
+        SharedTaskPool::shared()->setMaxThreads(params.max_task_pool_threads());
+    if (params.pooled_input_buffers())
+        IngestBufferPool::shared()->configure(params.input_pool_max_bytes(), params.input_pool_huge_pages());
+
+    for(auto &pipeline : params.pipelines()) {
+        if (pipeline.second.reusable()) {
+            this->pipelinePool.reset(new PipelinePool(params.max_idle_pipelines() ? params.max_idle_pipelines() : DEFAULT_MAX_IDLE_PIPELINES));
+            break;
+        }
+    }
+    this->factory.reset(new ServerPipelineFactory(params, this->pipelinePool.get()));
+    // a stuck stop may be abandoned and its destroy run meanwhile, both hold the pipeline
+    auto logger = this->logger;
+    this->reaperPool.reset(new ReaperPool(1, TEARDOWN_TIMEOUT_MILLIS, [logger] {
+        // stuck pipelines cannot be freed in process, exit so that the server replaces this worker
+        logger->error("too many stuck pipeline teardowns, exiting");
+        logger->flush();
+        _exit(EXIT_FAILURE);
+    }));
+}
+
+int WorkerProcess::run()
+{
+    this->logger->info("worker started");
+
+    WorkerChannel::Frame frame;
+    while (this->channel.receive(frame)) {
+        if (frame.type == WorkerChannel::FrameType::CREATE) {
+            this->create(frame);
+            continue;
+        }
+
+        auto iterator = this->pipelines.find(frame.pipelineId);
+        if (iterator == this->pipelines.end())
+            continue;
+        auto hosted = iterator->second;
+
+        switch(frame.type) {
+            case WorkerChannel::FrameType::START:
+                this->start(hosted);
+                break;
+
+            case WorkerChannel::FrameType::DATA:
+                hosted->pipeline->addData(frame.payload.data(), frame.payload.size());
+                break;
+
+            case WorkerChannel::FrameType::END:
+                hosted->pipeline->endData();
+                break;
+
+            case WorkerChannel::FrameType::STOP:
+                // stopping waits for streaming threads, keep reading commands meanwhile
+                this->reaperPool->submit([hosted] {
+                    std::shared_ptr<Pipeline> pipeline;
+                    {
+                        std::lock_guard<std::recursive_mutex> lock(hosted->lock);
+                        pipeline = hosted->pipeline;
+                    }
+                    // already destroyed
+                    if (!pipeline)
+                        return;
+                    // not under lock, stopping waits for callbacks that take it
+                    pipeline->stop();
+                });
+                break;
+
+            case WorkerChannel::FrameType::CONSUMED:
+            {
+                {
+                    std::lock_guard<std::recursive_mutex> lock(hosted->lock);
+                    hosted->inFlightBytes -= std::min<unsigned long>(frame.argument, hosted->inFlightBytes);
+                }
+                this->pull(hosted.get());
+                break;
+            }
+
+            case WorkerChannel::FrameType::DESTROY:
+                this->pipelines.erase(iterator);
+                this->destroy(hosted);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    this->logger->info("server closed channel, exiting with {0} pipelines", this->pipelines.size());
+    for(auto &entry : this->pipelines)
+        this->destroy(entry.second);
+    this->pipelines.clear();
+    // queued teardowns complete before the reaper is gone
+    this->reaperPool.reset();
+
+    return 0;
+}
+
+void WorkerProcess::preload(const ServiceParametersStruct &params)
+{
+    auto logger = spdlog::stderr_logger_mt("workerpreload");
+    for(auto &pipeline : params.pipelines()) {
+        GError *error = NULL;
+        auto element = gst_parse_launch(pipeline.second.specs().c_str(), &error);
+        if (error) {
+            logger->warn("unable to preload pipeline {0}: {1}", pipeline.first, error->message);
+            g_error_free(error);
+        }
+        if (element)
+            gst_object_unref(element);
+    }
+    spdlog::drop("workerpreload");
+}
+
+void WorkerProcess::create(const WorkerChannel::Frame &frame)
+{
+    // payload is the request ID followed by the serialized config
+    auto requestId = frame.payload.substr(0, frame.argument);
+    TransformConfig config;
+    if (frame.argument < 0 || (size_t)frame.argument > frame.payload.size() || !config.ParseFromString(frame.payload.substr(frame.argument))) {
+        std::string message = "malformed create request";
+        this->channel.send(WorkerChannel::FrameType::FAILED, frame.pipelineId, message.data(), message.size());
+        return;
+    }
+
+    auto hosted = std::make_shared<HostedPipeline>();
+    hosted->id = frame.pipelineId;
+    hosted->inFlightBytes = 0;
+    hosted->eosPending = false;
+    hosted->eosSent = false;
+    try {
+        hosted->pipeline = this->factory->get(requestId, config);
+    }
+    catch(std::exception &e) {
+        std::string message = e.what();
+        this->channel.send(WorkerChannel::FrameType::FAILED, frame.pipelineId, message.data(), message.size());
+        return;
+    }
+
+    // hosted outlives its pipeline, see destroy()
+    auto raw = hosted.get();
+    hosted->pipeline->setSampleAvailableCallback([this, raw] {
+        this->pull(raw);
+    });
+    hosted->pipeline->setNeedDataCallback([this, raw] {
+        this->channel.send(WorkerChannel::FrameType::NEED_DATA, raw->id);
+    });
+    hosted->pipeline->setEnoughDataCallback([this, raw] {
+        this->channel.send(WorkerChannel::FrameType::ENOUGH_DATA, raw->id);
+    });
+    hosted->pipeline->setEOSCallback([this, raw] {
+        {
+            std::lock_guard<std::recursive_mutex> lock(raw->lock);
+            raw->eosPending = true;
+        }
+        this->pull(raw);
+    });
+
+    this->pipelines[frame.pipelineId] = hosted;
+    this->channel.send(WorkerChannel::FrameType::CREATED, frame.pipelineId);
+}
+
+void WorkerProcess::start(const std::shared_ptr<HostedPipeline> &hosted)
+{
+    auto raw = hosted.get();
+    hosted->pipeline->start([this, raw] (bool force) {
+        std::lock_guard<std::recursive_mutex> lock(raw->lock);
+        if (!raw->pipeline)
+            return;
+        this->sendStatus(raw);
+        this->channel.send(WorkerChannel::FrameType::TERMINATED, raw->id, nullptr, 0, force ? 1 : 0);
+    });
+}
+
+void WorkerProcess::destroy(const std::shared_ptr<HostedPipeline> &hosted)
+{
+    // callbacks may run until the pipeline is gone, the closure keeps hosted alive until then
+    auto kept = hosted;
+    this->reaperPool->submit([kept] {
+        // destroying the pipeline joins streaming threads whose callbacks still
+        // fire. nothing is sent for it anymore, and the callbacks find it gone.
+        // a stop still running keeps it alive and destroys it once done.
+        std::shared_ptr<Pipeline> pipeline;
+        {
+            std::lock_guard<std::recursive_mutex> lock(kept->lock);
+            kept->eosSent = true;
+            pipeline = std::move(kept->pipeline);
+        }
+        pipeline.reset();
+    });
+}
+
+void WorkerProcess::pull(HostedPipeline *hosted)
+{
+    std::lock_guard<std::recursive_mutex> lock(hosted->lock);
+    if (hosted->eosSent || !hosted->pipeline)
+        return;
+
+    // pull one at a time to send each sample with its own end time
+    while (hosted->inFlightBytes < MAX_IN_FLIGHT_BYTES) {
+        double endTime = -1;
+        auto samples = hosted->pipeline->getPendingSample(1, -1, endTime);
+        if (samples.empty()) {
+            // all output is sent, the server sees EOS after the last sample
+            if (hosted->eosPending) {
+                this->sendStatus(hosted);
+                this->channel.send(WorkerChannel::FrameType::EOS, hosted->id);
+                hosted->eosSent = true;
+            }
+            break;
+        }
+
+        hosted->inFlightBytes += samples[0].size();
+        this->channel.send(WorkerChannel::FrameType::SAMPLE, hosted->id, samples[0].data(), samples[0].size(), 0, endTime);
+    }
+}
+
+void WorkerProcess::sendStatus(HostedPipeline *hosted)
+{
+    WorkerPipelineStatus status;
+    status.terminationReason = (uint32_t)hosted->pipeline->getTerminationReason();
+    status.processedInputBytes = hosted->pipeline->getProcessedInputBytes();
+    status.processedOutputBytes = hosted->pipeline->getProcessedOutputBytes();
+    status.processedTime = hosted->pipeline->getProcessedTime();
+
+    std::string payload(reinterpret_cast<const char *>(&status), sizeof(status));
+    payload += hosted->pipeline->getTerminationMessage();
+    this->channel.send(WorkerChannel::FrameType::STATUS, hosted->id, payload.data(), payload.size());
+}
+
+}
+}
@@ -0,0 +1,114 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __WORKERPROCESS_H__
+#define __WORKERPROCESS_H__
+
+#include <spdlog/spdlog.h>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "serviceparameters.pb.h"
+#include "workerchannel.h"
+#include "../serverpipelinefactory.h"
+#include "../pipelinepool.h"
+#include "../reaperpool.h"
+
+namespace gst_transformer {
+namespace service {
+
+/**
+ * Pipeline status as sent in STATUS frames, followed by the termination message.
+ */
+struct WorkerPipelineStatus
+{
+    uint32_t terminationReason;
+    uint64_t processedInputBytes;
+    uint64_t processedOutputBytes;
+    double processedTime;
+};
+
+/**
+ * Runs pipelines inside a worker process on behalf of the server.
+ *
+ * Commands for all pipelines of the worker are read from the channel on the
+ * main thread. Output samples are sent as they become available, up to a
+ * window of bytes not yet consumed on the server side.
+ */
+class WorkerProcess
+{
+public:
+    /**
+     * Construct a new worker.
+     *
+     * \param params service parameters.
+     * \param channel channel to the server.
+     */
+    WorkerProcess(const ServiceParametersStruct &params, WorkerChannel &channel);
+
+    /**
+     * Serve pipelines until the server closes the channel.
+     *
+     * \return process exit code.
+     */
+    int run();
+
+    /**
+     * Load plugins of all predefined pipelines so that forked workers start
+     * with them in place.
+     *
+     * \param params service parameters.
+     */
+    static void preload(const ServiceParametersStruct &params);
+
+private:
+    static const unsigned long MAX_IN_FLIGHT_BYTES;
+    static const unsigned int TEARDOWN_TIMEOUT_MILLIS;
+    static const unsigned int DEFAULT_MAX_IDLE_PIPELINES;
+
+    struct HostedPipeline
+    {
+        uint64_t id;
+        // released under lock on destroy, callbacks find it gone while it tears down.
+        // shared with a pending stop, which may still run when destroy releases it
+        std::shared_ptr<Pipeline> pipeline;
+        // recursive, pulling output may terminate the pipeline and report its status
+        std::recursive_mutex lock;
+        // sample bytes sent and not yet consumed by the server
+        unsigned long inFlightBytes;
+        bool eosPending;
+        bool eosSent;
+    };
+
+    std::shared_ptr<spdlog::logger> logger;
+    WorkerChannel &channel;
+    std::unique_ptr<PipelinePool> pipelinePool;
+    std::unique_ptr<ServerPipelineFactory> factory;
+    std::unique_ptr<ReaperPool> reaperPool;
+    std::map<uint64_t, std::shared_ptr<HostedPipeline>> pipelines;
+
+    void create(const WorkerChannel::Frame &frame);
+    void start(const std::shared_ptr<HostedPipeline> &hosted);
+    void destroy(const std::shared_ptr<HostedPipeline> &hosted);
+    void pull(HostedPipeline *hosted);
+    void sendStatus(HostedPipeline *hosted);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "sharedtaskpool.h"
+
+#include <algorithm>
+#include <thread>
+#include <system_error>
+
+typedef struct {
+    GstTaskPool parent;
+} SharedGstTaskPool;
+
+typedef struct {
+    GstTaskPoolClass parent_class;
+} SharedGstTaskPoolClass;
+
+G_DEFINE_TYPE(SharedGstTaskPool, shared_gst_task_pool, GST_TYPE_TASK_POOL)
+
+static void shared_gst_task_pool_prepare(GstTaskPool *pool, GError **error)
+{
+    // threads are managed by SharedTaskPool
+}
+
+static void shared_gst_task_pool_cleanup(GstTaskPool *pool)
+{
+}
+
+static gpointer shared_gst_task_pool_push(GstTaskPool *pool, GstTaskPoolFunction func, gpointer user_data, GError **error)
+{
+    if (!SharedTaskPool::shared()->push(func, user_data))
+        g_set_error(error, GST_CORE_ERROR, GST_CORE_ERROR_FAILED, "shared task pool exhausted");
+
+    // tasks are joined by gst, no handle needed
+    return NULL;
+}
+
+static void shared_gst_task_pool_class_init(SharedGstTaskPoolClass *klass)
+{
+    auto poolClass = GST_TASK_POOL_CLASS(klass);
+    poolClass->prepare = shared_gst_task_pool_prepare;
+    poolClass->cleanup = shared_gst_task_pool_cleanup;
+    poolClass->push = shared_gst_task_pool_push;
+}
+
+static void shared_gst_task_pool_init(SharedGstTaskPool *pool)
+{
+}
+
+SharedTaskPool * SharedTaskPool::Shared = nullptr;
+std::mutex SharedTaskPool::SharedLock;
+
+const std::chrono::seconds SharedTaskPool::IDLE_TIMEOUT(30);
+
+SharedTaskPool::SharedTaskPool()
+{
+    this->taskPool = GST_TASK_POOL(g_object_new(shared_gst_task_pool_get_type(), NULL));
+    this->threadCount = 0;
+    this->idleCount = 0;
+    this->maxThreads = 0;
+    this->maxIdleThreads = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+SharedTaskPool * SharedTaskPool::shared()
+{
+    std::unique_lock<std::mutex> lock(SharedLock);
+    if (Shared == nullptr)
+        Shared = new SharedTaskPool();
+
+    return Shared;
+}
+
+GstTaskPool * SharedTaskPool::getTaskPool() const
+{
+    return this->taskPool;
+}
+
+void SharedTaskPool::setMaxThreads(unsigned int maxThreads)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    this->maxThreads = maxThreads;
+}
+
+unsigned int SharedTaskPool::getMaxThreads()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->maxThreads;
+}
+
+void SharedTaskPool::setMaxIdleThreads(unsigned int maxIdleThreads)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    this->maxIdleThreads = maxIdleThreads;
+}
+
+unsigned int SharedTaskPool::getMaxIdleThreads()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->maxIdleThreads;
+}
+
+unsigned int SharedTaskPool::getThreadCount()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->threadCount;
+}
+
+unsigned int SharedTaskPool::getBusyThreadCount()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->threadCount - this->idleCount;
+}
+
+unsigned int SharedTaskPool::getQueueDepth()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    return this->queue.size();
+}
+
+bool SharedTaskPool::push(GstTaskPoolFunction func, gpointer user_data)
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+
+    Job job;
+    job.func = func;
+    job.user_data = user_data;
+    this->queue.push_back(job);
+
+    // reuse an idle thread if one is not already claimed by a queued job
+    if (this->idleCount >= this->queue.size()) {
+        this->cond.notify_one();
+        return true;
+    }
+
+    if (this->maxThreads > 0 && this->threadCount >= this->maxThreads) {
+        this->queue.pop_back();
+        return false;
+    }
+
+    try {
+        std::thread([this] { this->run(); }).detach();
+    }
+    catch(std::system_error &e) {
+        this->queue.pop_back();
+        return false;
+    }
+    this->threadCount++;
+
+    return true;
+}
+
+void SharedTaskPool::run()
+{
+    std::unique_lock<std::mutex> lock(this->lock);
+    while (true) {
+        if (this->queue.empty()) {
+            this->idleCount++;
+            auto ready = this->cond.wait_for(lock, IDLE_TIMEOUT, [&] { return !this->queue.empty(); });
+            this->idleCount--;
+            if (!ready && this->idleCount >= this->maxIdleThreads)
+                break;
+            if (!ready)
+                continue;
+        }
+
+        auto job = this->queue.front();
+        this->queue.pop_front();
+
+        lock.unlock();
+        job.func(job.user_data);
+        lock.lock();
+    }
+
+    this->threadCount--;
+}
@@ -0,0 +1,120 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __SHAREDTASKPOOL_H__
+#define __SHAREDTASKPOOL_H__
+
+#include <gst/gst.h>
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/**
+ * Process wide pool of threads used to run streaming tasks of all pipelines.
+ *
+ * Gst tasks occupy their thread for as long as they are started, so the pool
+ * does not multiplex tasks over threads. Instead it keeps finished threads
+ * around to be reused by new tasks, and optionally bounds the total number
+ * of threads, failing to start tasks beyond that.
+ */
+class SharedTaskPool
+{
+public:
+    /**
+     * Get the shared pool instance.
+     *
+     * \return shared pool.
+     */
+    static SharedTaskPool * shared();
+
+    /**
+     * Get gst task pool to be set on pipeline tasks.
+     *
+     * \return gst task pool.
+     */
+    GstTaskPool * getTaskPool() const;
+
+    /**
+     * Set maximum number of threads in the pool.
+     *
+     * \param maxThreads maximum number of threads, 0 for unlimited.
+     */
+    void setMaxThreads(unsigned int maxThreads);
+    unsigned int getMaxThreads();
+    /**
+     * Set number of idle threads kept for reuse, defaults to number of cores.
+     *
+     * \param maxIdleThreads maximum number of idle threads.
+     */
+    void setMaxIdleThreads(unsigned int maxIdleThreads);
+    unsigned int getMaxIdleThreads();
+
+    /**
+     * Get number of threads currently in the pool.
+     *
+     * \return number of threads.
+     */
+    unsigned int getThreadCount();
+    /**
+     * Get number of threads currently running tasks.
+     *
+     * \return number of busy threads.
+     */
+    unsigned int getBusyThreadCount();
+    /**
+     * Get number of tasks waiting to be picked up by a thread.
+     *
+     * \return queue depth.
+     */
+    unsigned int getQueueDepth();
+
+    /**
+     * Run a function on a pool thread.
+     *
+     * \param func function to run.
+     * \param user_data function argument.
+     * \return false if the pool is exhausted.
+     */
+    bool push(GstTaskPoolFunction func, gpointer user_data);
+
+private:
+    static const std::chrono::seconds IDLE_TIMEOUT;
+
+    struct Job
+    {
+        GstTaskPoolFunction func;
+        gpointer user_data;
+    };
+
+    GstTaskPool *taskPool;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<Job> queue;
+    unsigned int threadCount;
+    unsigned int idleCount;
+    unsigned int maxThreads;
+    unsigned int maxIdleThreads;
+
+    SharedTaskPool();
+    void run();
+
+    static SharedTaskPool *Shared;
+    static std::mutex SharedLock;
+};
+
+#endif
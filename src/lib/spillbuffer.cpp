@@ -0,0 +1,146 @@
+#include "spillbuffer.h"
+
+#include <fmt/format.h>
+#include <glib.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+const size_t SpillBuffer::GROW_SIZE = 4 * 1024 * 1024;
+const size_t SpillBuffer::RECORD_HEADER_SIZE = sizeof(uint32_t) + sizeof(int64_t);
+
+std::atomic<unsigned long> SpillBuffer::TotalUsedBytes(0);
+std::atomic<unsigned long> SpillBuffer::TotalQuota(0);
+
+SpillBuffer::SpillBuffer(const std::string &directory, unsigned long quota)
+{
+    this->mapping = nullptr;
+    this->capacity = 0;
+    this->writeOffset = 0;
+    this->readOffset = 0;
+    this->quota = quota;
+
+    auto path = fmt::format("{0}/gsttransformer-spill-XXXXXX", directory.empty() ? g_get_tmp_dir() : directory);
+    this->fd = mkstemp(&path[0]);
+    if (this->fd == -1)
+        throw std::runtime_error(fmt::format("unable to create spill file {0}: {1}", path, strerror(errno)));
+    // file only needs to live as long as we keep it open
+    unlink(path.c_str());
+}
+
+SpillBuffer::~SpillBuffer()
+{
+    TotalUsedBytes.fetch_sub(this->writeOffset);
+    if (this->mapping)
+        munmap(this->mapping, this->capacity);
+    close(this->fd);
+}
+
+bool SpillBuffer::append(const char *data, size_t size, int64_t tag)
+{
+    auto recordSize = RECORD_HEADER_SIZE + size;
+    if (this->quota > 0 && this->writeOffset + recordSize > this->quota)
+        return false;
+
+    auto total = TotalUsedBytes.fetch_add(recordSize) + recordSize;
+    auto totalQuota = TotalQuota.load();
+    if (totalQuota > 0 && total > totalQuota) {
+        TotalUsedBytes.fetch_sub(recordSize);
+        return false;
+    }
+
+    if (this->writeOffset + recordSize > this->capacity) {
+        try {
+            this->grow(this->writeOffset + recordSize);
+        }
+        catch(...) {
+            TotalUsedBytes.fetch_sub(recordSize);
+            throw;
+        }
+    }
+
+    uint32_t length = size;
+    auto record = this->mapping + this->writeOffset;
+    memcpy(record, &length, sizeof(length));
+    memcpy(record + sizeof(length), &tag, sizeof(tag));
+    memcpy(record + RECORD_HEADER_SIZE, data, size);
+    this->writeOffset += recordSize;
+
+    return true;
+}
+
+bool SpillBuffer::read(std::string &record, int64_t *tag)
+{
+    if (this->empty())
+        return false;
+
+    uint32_t length;
+    auto header = this->mapping + this->readOffset;
+    memcpy(&length, header, sizeof(length));
+    if (tag)
+        memcpy(tag, header + sizeof(length), sizeof(*tag));
+    record.assign(header + RECORD_HEADER_SIZE, length);
+    this->readOffset += RECORD_HEADER_SIZE + length;
+
+    if (this->empty())
+        this->rewind();
+
+    return true;
+}
+
+bool SpillBuffer::empty() const
+{
+    return this->readOffset == this->writeOffset;
+}
+
+unsigned long SpillBuffer::getUsedBytes() const
+{
+    return this->writeOffset;
+}
+
+void SpillBuffer::setTotalQuota(unsigned long quota)
+{
+    TotalQuota = quota;
+}
+
+unsigned long SpillBuffer::getTotalUsedBytes()
+{
+    return TotalUsedBytes;
+}
+
+void SpillBuffer::grow(size_t required)
+{
+    auto newCapacity = std::max(this->capacity * 2, ((required / GROW_SIZE) + 1) * GROW_SIZE);
+    if (ftruncate(this->fd, newCapacity) == -1)
+        throw std::runtime_error(fmt::format("unable to grow spill file to {0}: {1}", newCapacity, strerror(errno)));
+
+    // keep the current mapping, and the records in it, until the new one is in place
+    auto mapping = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error(fmt::format("unable to map spill file: {0}", strerror(errno)));
+    madvise(mapping, newCapacity, MADV_SEQUENTIAL);
+    if (this->mapping)
+        munmap(this->mapping, this->capacity);
+
+    this->mapping = static_cast<char *>(mapping);
+    this->capacity = newCapacity;
+}
+
+void SpillBuffer::rewind()
+{
+    auto used = this->writeOffset;
+    TotalUsedBytes.fetch_sub(used);
+    this->writeOffset = 0;
+    this->readOffset = 0;
+    if (used > 0 && this->mapping) {
+        // release disk space consumed by already read records
+        if (ftruncate(this->fd, 0) == -1 || ftruncate(this->fd, this->capacity) == -1)
+            throw std::runtime_error(fmt::format("unable to rewind spill file: {0}", strerror(errno)));
+    }
+}
@@ -0,0 +1,105 @@
+/*
+
+Copyright 2018 technicianted
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+*/
+
+#ifndef __SPILLBUFFER_H__
+#define __SPILLBUFFER_H__
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * Append-only record buffer backed by a memory-mapped temporary file.
+ *
+ * Records are read back in the order they were appended. Once all records
+ * have been read, the file is rewound so that its space is reused.
+ *
+ * \notice this class is not thread safe.
+ */
+class SpillBuffer
+{
+public:
+    /**
+     * Create a new spill buffer.
+     *
+     * \param directory directory in which to create the temporary file.
+     * \param quota maximum number of bytes in the file, 0 for unlimited.
+     */
+    SpillBuffer(const std::string &directory, unsigned long quota);
+    ~SpillBuffer();
+
+    /**
+     * Append a record to the end of the buffer.
+     *
+     * \param data record data.
+     * \param size record size.
+     * \param tag value stored along with the record.
+     * \return false if the per buffer or total quota would be exceeded.
+     */
+    bool append(const char *data, size_t size, int64_t tag = 0);
+    /**
+     * Read the oldest record in the buffer.
+     *
+     * \param record string to receive the record.
+     * \param tag optional pointer to receive the record tag.
+     * \return false if the buffer is empty.
+     */
+    bool read(std::string &record, int64_t *tag = nullptr);
+    /**
+     * Check if there are no more records to read.
+     *
+     * \return true if buffer is empty.
+     */
+    bool empty() const;
+    /**
+     * Get number of bytes currently used by the buffer file.
+     *
+     * \return used bytes.
+     */
+    unsigned long getUsedBytes() const;
+
+    /**
+     * Set maximum number of bytes used by all spill buffers in the process.
+     *
+     * \param quota maximum number of bytes, 0 for unlimited.
+     */
+    static void setTotalQuota(unsigned long quota);
+    /**
+     * Get number of bytes currently used by all spill buffers in the process.
+     *
+     * \return used bytes.
+     */
+    static unsigned long getTotalUsedBytes();
+
+private:
+    static const size_t GROW_SIZE;
+    static const size_t RECORD_HEADER_SIZE;
+
+    int fd;
+    char *mapping;
+    size_t capacity;
+    size_t writeOffset;
+    size_t readOffset;
+    unsigned long quota;
+
+    void grow(size_t required);
+    void rewind();
+
+    static std::atomic<unsigned long> TotalUsedBytes;
+    static std::atomic<unsigned long> TotalQuota;
+};
+
+#endif
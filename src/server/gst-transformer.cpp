@@ -21,6 +21,7 @@ all copies or substantial portions of the Software.
 
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include <thread>
 
 #include <grpc/grpc.h>
@@ -28,10 +29,14 @@ all copies or substantial portions of the Software.
 #include <grpc++/server_builder.h>
 #include <grpc++/server_context.h>
 #include <grpc++/security/server_credentials.h>
+#include <grpc++/generic/async_generic_service.h>
 
 #include "servercli.h"
 #include "serviceparams.h"
 #include "server/async/asyncserviceimpl.h"
+#include "server/router/asyncrouterimpl.h"
+#include "server/worker/forkserver.h"
+#include "server/worker/workerprocess.h"
 
 using namespace gst_transformer::service;
 
@@ -44,11 +49,45 @@ void runAsyncServer(const std::string &endpoint, const ServiceParams &params)
     std::unique_ptr<::grpc::ServerCompletionQueue> completionQueue = builder.AddCompletionQueue();
     auto server = builder.BuildAndStart();
 
-    AsyncServiceImpl asyncService(&service, completionQueue.get(), params);
+    // admin calls can cancel any stream, only serve them on their own listen address
+    GstTransformerAdmin::AsyncService adminService;
+    std::unique_ptr<::grpc::ServerCompletionQueue> adminCompletionQueue;
+    std::unique_ptr<::grpc::Server> adminServer;
+    if (!params.admin_endpoint().empty()) {
+        ::grpc::ServerBuilder adminBuilder;
+        adminBuilder.AddListeningPort(params.admin_endpoint(), grpc::InsecureServerCredentials());
+        adminBuilder.RegisterService(&adminService);
+        adminCompletionQueue = adminBuilder.AddCompletionQueue();
+        adminServer = adminBuilder.BuildAndStart();
+        if (!adminServer)
+            throw std::runtime_error(fmt::format("unable to listen on admin endpoint {0}", params.admin_endpoint()));
+        std::cout << "Admin service listening on " << params.admin_endpoint() << std::endl;
+    }
+
+    AsyncServiceImpl asyncService(
+        &service,
+        adminServer ? &adminService : nullptr,
+        completionQueue.get(),
+        adminCompletionQueue.get(),
+        params);
     std::cout << "Async server listening on " << endpoint << std::endl;
     asyncService.start();
 }
 
+void runAsyncRouter(const std::string &endpoint, const ServiceParams &params)
+{
+    ::grpc::AsyncGenericService service;
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort(endpoint, grpc::InsecureServerCredentials());
+    builder.RegisterAsyncGenericService(&service);
+    std::unique_ptr<::grpc::ServerCompletionQueue> completionQueue = builder.AddCompletionQueue();
+    auto server = builder.BuildAndStart();
+
+    AsyncRouterImpl asyncRouter(&service, completionQueue.get(), params);
+    std::cout << "Async router listening on " << endpoint << std::endl;
+    asyncRouter.start();
+}
+
 int main(int argc, char **argv)
 {
     spdlog::set_pattern("%+ %t");
@@ -71,5 +110,21 @@ int main(int argc, char **argv)
         }
     }
 
+    if (params.router_backends_size()) {
+        runAsyncRouter(endpoint, params);
+        return 0;
+    }
+
+    // must be forked while the process is still single threaded
+    if (params.worker_processes()) {
+        ForkServer::start(
+            [&params] {
+                WorkerProcess::preload(params);
+            },
+            [&params] (WorkerChannel &channel) {
+                return WorkerProcess(params, channel).run();
+            });
+    }
+
     runAsyncServer(endpoint, params);
 }
@@ -47,6 +47,120 @@ void ServiceParams::loadFromJsonStream(std::istream &stream)
             if (pipelineOutputBuffer.find("max") != pipelineOutputBuffer.end())
                 this->set_max_pipeline_output_buffer(pipelineOutputBuffer.at("max").get<unsigned long>());
         }
+        if (limits.find("inputBufferBytes") != limits.end()) {
+            auto inputBufferBytes = limits.at("inputBufferBytes");
+            if (inputBufferBytes.find("max") != inputBufferBytes.end())
+                this->set_max_input_buffer_bytes(inputBufferBytes.at("max").get<unsigned long>());
+        }
+        if (limits.find("inputBufferMillis") != limits.end()) {
+            auto inputBufferMillis = limits.at("inputBufferMillis");
+            if (inputBufferMillis.find("max") != inputBufferMillis.end())
+                this->set_max_input_buffer_millis(inputBufferMillis.at("max").get<unsigned long>());
+        }
+        if (limits.find("outputSpill") != limits.end()) {
+            auto outputSpill = limits.at("outputSpill");
+            if (outputSpill.find("directory") != outputSpill.end())
+                this->set_spill_directory(outputSpill.at("directory").get<std::string>());
+            if (outputSpill.find("max") != outputSpill.end())
+                this->set_max_spill_bytes(outputSpill.at("max").get<unsigned long>());
+            if (outputSpill.find("maxTotal") != outputSpill.end())
+                this->set_max_total_spill_bytes(outputSpill.at("maxTotal").get<unsigned long>());
+            if (outputSpill.find("maxThreshold") != outputSpill.end())
+                this->set_max_spill_threshold_bytes(outputSpill.at("maxThreshold").get<unsigned int>());
+        }
+    }
+    if (j.find("pacing") != j.end()) {
+        auto pacing = j.at("pacing");
+        if (pacing.find("centralized") != pacing.end())
+            this->set_centralized_pacing(pacing.at("centralized"));
+        if (pacing.find("tickMillis") != pacing.end())
+            this->set_pacing_tick_millis(pacing.at("tickMillis").get<unsigned int>());
+        if (pacing.find("burstMillis") != pacing.end())
+            this->set_pacing_burst_millis(pacing.at("burstMillis").get<unsigned int>());
+    }
+    if (j.find("taskPool") != j.end()) {
+        auto taskPool = j.at("taskPool");
+        if (taskPool.find("shared") != taskPool.end())
+            this->set_shared_task_pool(taskPool.at("shared"));
+        if (taskPool.find("maxThreads") != taskPool.end())
+            this->set_max_task_pool_threads(taskPool.at("maxThreads").get<unsigned int>());
+    }
+    if (j.find("affinity") != j.end()) {
+        auto affinity = j.at("affinity");
+        if (affinity.find("controlCpus") != affinity.end())
+            this->set_control_cpus(affinity.at("controlCpus").get<std::string>());
+        if (affinity.find("numaSharding") != affinity.end())
+            this->set_numa_sharding(affinity.at("numaSharding"));
+    }
+    if (j.find("inputPool") != j.end()) {
+        auto inputPool = j.at("inputPool");
+        if (inputPool.find("enabled") != inputPool.end())
+            this->set_pooled_input_buffers(inputPool.at("enabled"));
+        if (inputPool.find("maxBytes") != inputPool.end())
+            this->set_input_pool_max_bytes(inputPool.at("maxBytes").get<unsigned long>());
+        if (inputPool.find("hugePages") != inputPool.end())
+            this->set_input_pool_huge_pages(inputPool.at("hugePages"));
+    }
+    if (j.find("capture") != j.end()) {
+        auto capture = j.at("capture");
+        if (capture.find("path") != capture.end())
+            this->set_capture_path(capture.at("path").get<std::string>());
+        if (capture.find("sampleRate") != capture.end())
+            this->set_capture_sample_rate(capture.at("sampleRate").get<double>());
+        if (capture.find("sizesOnly") != capture.end())
+            this->set_capture_sizes_only(capture.at("sizesOnly"));
+    }
+    if (j.find("setup") != j.end()) {
+        auto setup = j.at("setup");
+        if (setup.find("threads") != setup.end())
+            this->set_setup_threads(setup.at("threads").get<unsigned int>());
+        if (setup.find("maxPending") != setup.end())
+            this->set_max_pending_setups(setup.at("maxPending").get<unsigned int>());
+    }
+    if (j.find("teardown") != j.end()) {
+        auto teardown = j.at("teardown");
+        if (teardown.find("threads") != teardown.end())
+            this->set_teardown_threads(teardown.at("threads").get<unsigned int>());
+        if (teardown.find("timeoutMillis") != teardown.end())
+            this->set_teardown_timeout_millis(teardown.at("timeoutMillis").get<unsigned int>());
+    }
+    if (j.find("workers") != j.end()) {
+        auto workers = j.at("workers");
+        if (workers.find("processes") != workers.end())
+            this->set_worker_processes(workers.at("processes").get<unsigned int>());
+        if (workers.find("maxCalls") != workers.end())
+            this->set_max_worker_calls(workers.at("maxCalls").get<unsigned int>());
+    }
+    if (j.find("router") != j.end()) {
+        auto router = j.at("router");
+        if (router.find("backends") != router.end()) {
+            for(auto &backend : router.at("backends"))
+                this->add_router_backends(backend.get<std::string>());
+        }
+        if (router.find("affinitySlack") != router.end())
+            this->set_router_affinity_slack(router.at("affinitySlack").get<unsigned int>());
+    }
+    if (j.find("load") != j.end()) {
+        auto load = j.at("load");
+        if (load.find("sampleMillis") != load.end())
+            this->set_load_sample_millis(load.at("sampleMillis").get<unsigned int>());
+        if (load.find("maxStreams") != load.end())
+            this->set_max_load_streams(load.at("maxStreams").get<unsigned int>());
+    }
+    if (j.find("admin") != j.end()) {
+        auto admin = j.at("admin");
+        if (admin.find("endpoint") != admin.end())
+            this->set_admin_endpoint(admin.at("endpoint").get<std::string>());
+    }
+    if (j.find("pipelinePool") != j.end()) {
+        auto pipelinePool = j.at("pipelinePool");
+        if (pipelinePool.find("maxIdle") != pipelinePool.end())
+            this->set_max_idle_pipelines(pipelinePool.at("maxIdle").get<unsigned int>());
+    }
+    if (j.find("stats") != j.end()) {
+        auto stats = j.at("stats");
+        if (stats.find("intervalMillis") != stats.end())
+            this->set_stats_interval_millis(stats.at("intervalMillis").get<unsigned int>());
     }
     if (j.find("pipelines") != j.end()) {
         auto pipelines = j.at("pipelines");
@@ -55,6 +169,8 @@ void ServiceParams::loadFromJsonStream(std::istream &stream)
             PipelineStruct entry;
             entry.set_id(pipeline.at("id").get<std::string>());
             entry.set_specs(pipeline.at("specs").get<std::string>());
+            if (pipeline.find("reusable") != pipeline.end())
+                entry.set_reusable(pipeline.at("reusable"));
             (*this->mutable_pipelines())[entry.id()] = entry;
         }
     }